@@ -0,0 +1,123 @@
+#include "ability_script.h"
+#include <new>
+
+// =========================================
+// ScriptFramePool
+// =========================================
+
+ScriptFramePool::ScriptFramePool() {
+    for (int i = 0; i < CLASS_COUNT; i++) free_lists[i] = nullptr;
+}
+
+ScriptFramePool::~ScriptFramePool() {
+    for (char* c : chunks) ::operator delete(c);
+}
+
+void ScriptFramePool::refill(int cls) {
+    std::size_t frame_bytes = (cls + 1) * CLASS_BYTES;
+    char* chunk = (char*)::operator new(frame_bytes * FRAMES_PER_CHUNK);
+    chunks.push_back(chunk);
+    for (int i = 0; i < FRAMES_PER_CHUNK; i++) {
+        FreeNode* node = (FreeNode*)(chunk + i * frame_bytes);
+        node->next = free_lists[cls];
+        free_lists[cls] = node;
+    }
+}
+
+void* ScriptFramePool::allocate(std::size_t n) {
+    std::size_t total = n + HEADER;
+    int cls = (int)((total + CLASS_BYTES - 1) / CLASS_BYTES) - 1;
+
+    char* raw;
+    if (cls >= CLASS_COUNT) {
+        raw = (char*)::operator new(total);
+        *(ScriptFramePool**)raw = nullptr; // 标记为系统分配
+    } else {
+        if (!free_lists[cls]) refill(cls);
+        FreeNode* node = free_lists[cls];
+        free_lists[cls] = node->next;
+        raw = (char*)node;
+        *(ScriptFramePool**)raw = this;
+    }
+    return raw + HEADER;
+}
+
+void ScriptFramePool::release(void* p, std::size_t n) {
+    char* raw = (char*)p - HEADER;
+    ScriptFramePool* owner = *(ScriptFramePool**)raw;
+    if (!owner) {
+        ::operator delete(raw);
+        return;
+    }
+    int cls = (int)((n + HEADER + CLASS_BYTES - 1) / CLASS_BYTES) - 1;
+    FreeNode* node = (FreeNode*)raw;
+    node->next = owner->free_lists[cls];
+    owner->free_lists[cls] = node;
+}
+
+// =========================================
+// ScriptWait
+// =========================================
+
+bool ScriptWait::await_ready() const noexcept {
+    return false; // 即使已到点也挂起，统一由时间轮在下一帧恢复
+}
+
+void ScriptWait::await_suspend(std::coroutine_handle<> h) {
+    sched->park(h, due);
+}
+
+long long ScriptWait::await_resume() const noexcept {
+    return sched->current_time;
+}
+
+// =========================================
+// ScriptScheduler
+// =========================================
+
+ScriptScheduler::ScriptScheduler(TimerWheel* wheel, int timer_kind)
+    : wheel(wheel), timer_kind(timer_kind), current_time(0) {}
+
+ScriptScheduler::~ScriptScheduler() {
+    clear();
+}
+
+void ScriptScheduler::start(AbilityScript script, long long now) {
+    current_time = now;
+    script.release().resume();
+}
+
+void ScriptScheduler::park(std::coroutine_handle<> h, long long due) {
+    int slot;
+    if (!free_slots.empty()) {
+        slot = free_slots.back();
+        free_slots.pop_back();
+    } else {
+        slot = parked.size();
+        parked.push_back(Parked{ nullptr, 0 });
+    }
+    parked[slot].handle = h;
+    parked[slot].due = due;
+    wheel->schedule(due, timer_kind, slot);
+}
+
+void ScriptScheduler::resume(int slot, long long due, long long now) {
+    if (slot < 0 || slot >= (int)parked.size()) return;
+    Parked& p = parked[slot];
+    if (!p.handle || p.due != due) return; // 已被 clear 或槽位已复用
+
+    std::coroutine_handle<> h = p.handle;
+    p.handle = nullptr;
+    free_slots.push_back(slot);
+
+    current_time = now;
+    h.resume();
+}
+
+void ScriptScheduler::clear() {
+    for (auto& p : parked) {
+        if (p.handle) p.handle.destroy();
+    }
+    parked.clear();
+    free_slots.clear();
+}
@@ -0,0 +1,133 @@
+#ifndef ABILITY_SCRIPT_H
+#define ABILITY_SCRIPT_H
+
+#include <coroutine>
+#include <cstddef>
+#include <vector>
+#include "timer_wheel.h"
+
+// ==========================================
+// 技能脚本 (C++20 协程)
+// 多段技能写成顺序代码："等 500ms -> 生成第二段 -> 等 1 秒 -> 结算伤害"，
+// 挂起时登记到房间时间轮，只在真正到点时才被恢复执行。
+// 编译需要 -std=c++20。
+// ==========================================
+
+// --------------------------------------------------------
+// 协程帧内存池：按 64 字节分级的空闲链表，整块申请、房间销毁时一起释放
+// --------------------------------------------------------
+class ScriptFramePool {
+public:
+    ScriptFramePool();
+    ~ScriptFramePool();
+
+    void* allocate(std::size_t n);
+    static void release(void* p, std::size_t n);
+
+private:
+    static const std::size_t HEADER = 16;     // 帧前面记录所属内存池，保持 16 字节对齐
+    static const std::size_t CLASS_BYTES = 64;
+    static const int CLASS_COUNT = 16;        // 最大 1024 字节，更大的直接走系统分配
+    static const int FRAMES_PER_CHUNK = 16;
+
+    struct FreeNode { FreeNode* next; };
+
+    FreeNode* free_lists[CLASS_COUNT];
+    std::vector<char*> chunks;
+
+    void refill(int cls);
+};
+
+// --------------------------------------------------------
+// 脚本句柄：函数返回后处于挂起状态，交给 ScriptScheduler::start 才开始执行
+// --------------------------------------------------------
+struct AbilityScript {
+    struct promise_type {
+        // 脚本必须是房间的成员函数，帧从房间的内存池分配
+        template <typename Room, typename... Args>
+        static void* operator new(std::size_t n, Room& room, Args&&...) {
+            return room.script_frames().allocate(n);
+        }
+        static void operator delete(void* p, std::size_t n) {
+            ScriptFramePool::release(p, n);
+        }
+
+        AbilityScript get_return_object() {
+            return AbilityScript(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; } // 执行完自动销毁帧
+        void return_void() {}
+        void unhandled_exception() { throw; }
+    };
+
+    explicit AbilityScript(std::coroutine_handle<promise_type> h) : handle(h) {}
+    AbilityScript(AbilityScript&& o) noexcept : handle(o.handle) { o.handle = nullptr; }
+    AbilityScript(const AbilityScript&) = delete;
+    AbilityScript& operator=(const AbilityScript&) = delete;
+    ~AbilityScript() { if (handle) handle.destroy(); }
+
+    std::coroutine_handle<promise_type> release() {
+        std::coroutine_handle<promise_type> h = handle;
+        handle = nullptr;
+        return h;
+    }
+
+private:
+    std::coroutine_handle<promise_type> handle;
+};
+
+class ScriptScheduler;
+
+// co_await 的等待对象，恢复后返回当前时间 (毫秒)
+struct ScriptWait {
+    ScriptScheduler* sched;
+    long long due;
+
+    bool await_ready() const noexcept;
+    void await_suspend(std::coroutine_handle<> h);
+    long long await_resume() const noexcept;
+};
+
+// --------------------------------------------------------
+// 脚本调度器：记录挂起中的脚本，由房间时间轮驱动恢复
+// --------------------------------------------------------
+class ScriptScheduler {
+public:
+    ScriptScheduler(TimerWheel* wheel, int timer_kind);
+    ~ScriptScheduler();
+
+    ScriptFramePool& frames() { return pool; }
+
+    // 立即执行脚本直到第一次挂起
+    void start(AbilityScript script, long long now);
+
+    // 时间轮事件到期时调用 (slot 为事件 id)
+    void resume(int slot, long long due, long long now);
+
+    // 销毁所有挂起中的脚本 (重新开局时)
+    void clear();
+
+    ScriptWait wait_until(long long due) { return ScriptWait{ this, due }; }
+    long long now() const { return current_time; }
+    int active_count() const { return (int)parked.size() - (int)free_slots.size(); }
+
+private:
+    friend struct ScriptWait;
+
+    struct Parked {
+        std::coroutine_handle<> handle;
+        long long due;
+    };
+
+    ScriptFramePool pool;   // 必须最先构造、最后析构
+    TimerWheel* wheel;
+    int timer_kind;
+    long long current_time;
+    std::vector<Parked> parked;
+    std::vector<int> free_slots;
+
+    void park(std::coroutine_handle<> h, long long due);
+};
+
+#endif
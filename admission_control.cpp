@@ -0,0 +1,124 @@
+#include "admission_control.h"
+#include <cstring>
+#include <iostream>
+
+static const int CLASS_RATE[ADMIT_CLASSES]  = { ADMIT_GAME_RATE,  ADMIT_LOBBY_RATE,  ADMIT_LOGIN_RATE };
+static const int CLASS_BURST[ADMIT_CLASSES] = { ADMIT_GAME_BURST, ADMIT_LOBBY_BURST, ADMIT_LOGIN_BURST };
+static const char* CLASS_NAMES[ADMIT_CLASSES] = { "game", "lobby", "login" };
+
+void AdmitBucket::reset(int burst, long long now) {
+    tokens = burst * 1000;
+    last_ms = now;
+}
+
+bool AdmitBucket::take(int rate, int burst, long long now) {
+    long long elapsed = now - last_ms;
+    last_ms = now;
+    if (elapsed > 0) {
+        long long refill = (long long)tokens + elapsed * rate;
+        long long cap = (long long)burst * 1000;
+        tokens = (int)(refill > cap ? cap : refill);
+    }
+    if (tokens < 1000) return false;
+    tokens -= 1000;
+    return true;
+}
+
+AdmissionControl::AdmissionControl(int tick_ms, long long now)
+    : pending(0), reactor_pending(0), tick_ms(tick_ms), load_x8(0), overload(false),
+      next_report(now + ADMIT_REPORT_MS), rejected_conns(0), rejected_logins(0) {
+    memset(throttled, 0, sizeof(throttled));
+    memset(shed, 0, sizeof(shed));
+}
+
+bool AdmissionControl::admit_connection() const {
+    return !overload && pending + reactor_pending < ADMIT_MAX_PENDING;
+}
+
+void AdmissionControl::add(int fd, long long now) {
+    Conn c;
+    for (int i = 0; i < ADMIT_CLASSES; i++) c.buckets[i].reset(CLASS_BURST[i], now);
+    c.authed = false;
+    auto res = conns.insert({ fd, c });
+    if (!res.second) {
+        if (res.first->second.authed) pending++;
+        res.first->second = c;
+    } else {
+        pending++;
+    }
+}
+
+void AdmissionControl::remove(int fd) {
+    auto it = conns.find(fd);
+    if (it == conns.end()) return;
+    if (!it->second.authed) pending--;
+    conns.erase(it);
+}
+
+void AdmissionControl::on_authed(int fd) {
+    auto it = conns.find(fd);
+    if (it == conns.end() || it->second.authed) return;
+    it->second.authed = true;
+    pending--;
+}
+
+bool AdmissionControl::authed(int fd) const {
+    auto it = conns.find(fd);
+    return it != conns.end() && it->second.authed;
+}
+
+int AdmissionControl::check(int fd, int cls, long long now) {
+    auto it = conns.find(fd);
+    if (it == conns.end()) return ADMIT_PASS;
+
+    // 过载时只保对局输入
+    if (overload && cls != ADMIT_CLASS_GAME) {
+        shed[cls]++;
+        return ADMIT_SHED;
+    }
+
+    if (!it->second.buckets[cls].take(CLASS_RATE[cls], CLASS_BURST[cls], now)) {
+        throttled[cls]++;
+        return ADMIT_THROTTLE;
+    }
+    return ADMIT_PASS;
+}
+
+void AdmissionControl::on_tick(long long late_ms, long long work_ms, long long now) {
+    int cost = (int)(late_ms + work_ms);
+    if (cost < 0) cost = 0;
+    load_x8 += cost - load_x8 / 8;
+
+    int load = load_x8 / 8;
+    if (!overload && load * 100 > tick_ms * ADMIT_OVERLOAD_ENTER_PCT) {
+        overload = true;
+        std::cout << "[Admission] Overloaded (tick load " << load << "ms / " << tick_ms
+                  << "ms), shedding lobby and login traffic." << std::endl;
+    } else if (overload && load * 100 < tick_ms * ADMIT_OVERLOAD_LEAVE_PCT) {
+        overload = false;
+        std::cout << "[Admission] Load back to " << load << "ms, accepting lobby traffic again." << std::endl;
+    }
+
+    if (now >= next_report) {
+        report();
+        next_report = now + ADMIT_REPORT_MS;
+    }
+}
+
+// 本周期有丢弃/拒绝时打印一次，然后清零
+void AdmissionControl::report() {
+    unsigned long long total = rejected_conns + rejected_logins;
+    for (int i = 0; i < ADMIT_CLASSES; i++) total += throttled[i] + shed[i];
+    if (total > 0) {
+        std::cout << "[Admission] " << pending + reactor_pending << " pending conns | rejected " << rejected_conns << " conns, "
+                  << rejected_logins << " logins";
+        for (int i = 0; i < ADMIT_CLASSES; i++) {
+            if (throttled[i] + shed[i] == 0) continue;
+            std::cout << " | " << CLASS_NAMES[i] << ": " << throttled[i] << " throttled, " << shed[i] << " shed";
+        }
+        std::cout << std::endl;
+    }
+    memset(throttled, 0, sizeof(throttled));
+    memset(shed, 0, sizeof(shed));
+    rejected_conns = rejected_logins = 0;
+}
@@ -0,0 +1,101 @@
+#ifndef ADMISSION_CONTROL_H
+#define ADMISSION_CONTROL_H
+
+#include <unordered_map>
+
+#define ADMIT_MAX_PENDING     1024 // 同时处于握手/登录阶段的连接上限
+#define ADMIT_MAX_AUTH_QUEUE  1024 // 排队等认证线程的登录/注册请求上限
+#define ADMIT_REPORT_MS       10000
+
+// 各类包的令牌桶：每秒补充多少个，最多攒多少个
+#define ADMIT_GAME_RATE    100
+#define ADMIT_GAME_BURST   200
+#define ADMIT_LOBBY_RATE   20
+#define ADMIT_LOBBY_BURST  40
+#define ADMIT_LOGIN_RATE   2
+#define ADMIT_LOGIN_BURST  4
+
+// 过载判定：逻辑帧平均晚到 + 执行的时间超过帧间隔的 80% 进入过载，降到 50% 以下恢复
+#define ADMIT_OVERLOAD_ENTER_PCT  80
+#define ADMIT_OVERLOAD_LEAVE_PCT  50
+
+// 包的优先级分类 (数值越小越优先)
+#define ADMIT_CLASS_GAME   0  // 对局输入、PONG
+#define ADMIT_CLASS_LOBBY  1  // 大厅/房间控制、观战、换传输通道
+#define ADMIT_CLASS_LOGIN  2  // 登录/注册
+#define ADMIT_CLASSES      3
+
+// check() 的结果
+#define ADMIT_PASS      0
+#define ADMIT_THROTTLE  1  // 超过该连接的速率，直接丢弃
+#define ADMIT_SHED      2  // 服务器过载，回一个"忙"再丢弃
+
+// 令牌桶：令牌以千分之一个为单位，按毫秒补充，避免浮点
+// (接入 reactor 线程里各连接的登录限速也用它)
+struct AdmitBucket {
+    int tokens;
+    long long last_ms;
+
+    void reset(int burst, long long now);
+    bool take(int rate, int burst, long long now); // 够一个令牌就扣掉并返回 true
+};
+
+// --------------------------------------------------------
+// 准入控制
+// 过载时保住进行中的对局：新连接和登录数量封顶，每条连接按包的类别限速，
+// 逻辑帧赶不上时大厅/登录请求直接回"忙"，对局输入照常处理。
+// 连接阶段 (是否已登录) 也记在这里，用来统计握手中的连接数。
+// --------------------------------------------------------
+class AdmissionControl {
+public:
+    AdmissionControl(int tick_ms, long long now);
+
+    // 新连接能否接入 (过载或握手中的连接太多时拒绝)
+    bool admit_connection() const;
+    void add(int fd, long long now);
+    void remove(int fd);
+    void on_authed(int fd);
+    bool authed(int fd) const;
+
+    // 一个包能否处理；cls 为 ADMIT_CLASS_*，返回 ADMIT_*
+    int check(int fd, int cls, long long now);
+
+    // 每个逻辑帧报告：比预定时间晚了多少、执行用了多久 (毫秒)
+    void on_tick(long long late_ms, long long work_ms, long long now);
+    bool overloaded() const { return overload; }
+
+    int pending_conns() const { return pending; }
+    // 接入 reactor 手里还没交过来的连接 (同样在握手/登录阶段)，计入上限和统计
+    void set_reactor_pending(int n) { reactor_pending = n; }
+
+    // 拒绝新连接 / 认证队列满时记一笔，统计里一起打印
+    void count_rejected_connection(unsigned long long n = 1) { rejected_conns += n; }
+    void count_rejected_login() { rejected_logins++; }
+    // reactor 线程里限速/回"忙"的包，汇总进同一份统计
+    void count_dropped(int cls, unsigned long long n_throttled, unsigned long long n_shed) {
+        throttled[cls] += n_throttled;
+        shed[cls] += n_shed;
+    }
+
+private:
+    struct Conn {
+        AdmitBucket buckets[ADMIT_CLASSES];
+        bool authed;
+    };
+    std::unordered_map<int, Conn> conns;
+    int pending;  // 尚未登录的连接数
+    int reactor_pending;
+
+    int tick_ms;
+    int load_x8;  // 每帧 (晚到 + 执行) 时间的滑动平均，x8 定点
+    bool overload;
+
+    long long next_report;
+    unsigned long long throttled[ADMIT_CLASSES];
+    unsigned long long shed[ADMIT_CLASSES];
+    unsigned long long rejected_conns, rejected_logins;
+
+    void report();
+};
+
+#endif
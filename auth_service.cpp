@@ -0,0 +1,73 @@
+#include "auth_service.h"
+#include "protocol.h"
+#include <cstring>
+#include <cstdio>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+AuthService::AuthService(UserManager* um, int n_workers) : user_mgr(um), stopping(false) {
+    efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (efd < 0) perror("[Auth] eventfd failed");
+    if (n_workers < 1) n_workers = 1;
+    for (int i = 0; i < n_workers; i++) workers.emplace_back(&AuthService::worker_loop, this);
+}
+
+AuthService::~AuthService() {
+    {
+        std::lock_guard<std::mutex> lock(req_mtx);
+        stopping = true;
+    }
+    req_cv.notify_all();
+    for (auto& t : workers) t.join();
+    if (efd >= 0) close(efd);
+}
+
+void AuthService::submit(const AuthRequest& req) {
+    {
+        std::lock_guard<std::mutex> lock(req_mtx);
+        requests.push_back(req);
+    }
+    req_cv.notify_one();
+}
+
+void AuthService::drain(std::vector<AuthResult>& out) {
+    uint64_t cnt;
+    while (read(efd, &cnt, sizeof(cnt)) > 0) {} // 清空计数，多次通知合并处理
+
+    std::lock_guard<std::mutex> lock(done_mtx);
+    out.insert(out.end(), done.begin(), done.end());
+    done.clear();
+}
+
+void AuthService::worker_loop() {
+    while (true) {
+        AuthRequest req;
+        {
+            std::unique_lock<std::mutex> lock(req_mtx);
+            req_cv.wait(lock, [this] { return stopping || !requests.empty(); });
+            if (stopping && requests.empty()) return;
+            req = requests.front();
+            requests.pop_front();
+        }
+
+        // 防止客户端发来没有结尾的字符串
+        std::string username(req.username, strnlen(req.username, sizeof(req.username)));
+        std::string password(req.password, strnlen(req.password, sizeof(req.password)));
+
+        AuthResult res;
+        memset(&res, 0, sizeof(res));
+        res.fd = req.fd;
+        res.gen = req.gen;
+        res.type = req.type;
+        strncpy(res.username, username.c_str(), sizeof(res.username) - 1);
+        if (req.type == TYPE_REG_REQ) res.result = user_mgr->register_user(username, password);
+        else res.result = user_mgr->check_password(username, password);
+
+        {
+            std::lock_guard<std::mutex> lock(done_mtx);
+            done.push_back(res);
+        }
+        uint64_t one = 1;
+        if (write(efd, &one, sizeof(one)) < 0) perror("[Auth] eventfd write failed");
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef AUTH_SERVICE_H
+#define AUTH_SERVICE_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "user_manager.h"
+
+#define AUTH_WORKERS 2   // 登录/注册工作线程数
+
+// 登录/注册请求 (gen 为连接代号，防止 fd 被复用后把结果发给新连接)
+struct AuthRequest {
+    int fd;
+    unsigned int gen;
+    int type;            // TYPE_LOGIN_REQ / TYPE_REG_REQ
+    char username[32];
+    char password[32];
+};
+
+struct AuthResult {
+    int fd;
+    unsigned int gen;
+    int type;            // 原请求类型
+    int result;          // RET_*
+    char username[32];
+};
+
+// --------------------------------------------------------
+// 认证服务：账号校验/注册在工作线程完成，结果经 eventfd 通知回 epoll 主循环。
+// 工作线程只做校验 (以后的密码哈希、存储 I/O 都在这里)，
+// "标记在线" 仍由主循环完成，与断线处理保持同一线程、不会乱序。
+// --------------------------------------------------------
+class AuthService {
+public:
+    AuthService(UserManager* um, int n_workers);
+    ~AuthService();
+
+    // 注册到 epoll 的通知描述符 (有完成结果时可读)
+    int event_fd() const { return efd; }
+
+    void submit(const AuthRequest& req);
+
+    // 主循环在 event_fd 可读时调用，取出所有已完成的结果
+    void drain(std::vector<AuthResult>& out);
+
+private:
+    UserManager* user_mgr;
+    int efd;
+
+    std::mutex req_mtx;
+    std::condition_variable req_cv;
+    std::deque<AuthRequest> requests;
+    bool stopping;
+
+    std::mutex done_mtx;
+    std::vector<AuthResult> done;
+
+    std::vector<std::thread> workers;
+
+    void worker_loop();
+};
+
+#endif
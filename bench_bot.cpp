@@ -0,0 +1,296 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "protocol.h"
+#include "shm_transport.h"
+#include "udp_transport.h"
+
+// ==========================================
+// 压测机器人 (C++)
+// 一批机器人注册 -> 登录 -> 匹配 -> 选英雄 -> 持续移动/攻击，统计服务器下发的帧数和字节数。
+// 可以选择传输方式，用来对比 TCP / Unix socket / 共享内存环下服务器的模拟与编解码开销：
+//   ./bench_bot --bots 10 --seconds 10                  (TCP 127.0.0.1:8888)
+//   ./bench_bot --unix /tmp/moba.sock                   (服务器需带 --unix)
+//   ./bench_bot --unix /tmp/moba.sock --shm
+//   ./bench_bot --udp --udp-sim 5/60/20                 (战斗流量走 UDP，并模拟弱网)
+// 编译: g++ -std=c++20 -O2 -o bench_bot bench_bot.cpp shm_transport.cpp udp_transport.cpp
+// ==========================================
+
+static long long now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct Bot {
+    int sock;
+    ShmChannel* shm;
+    std::string name;
+    std::vector<char> buf;
+    bool in_game;
+    bool picked;
+    long long frames;
+    long long bytes;
+    UdpSession* udp;
+    int udp_sock;
+
+    void send(const void* data, size_t len) {
+        if (shm) shm->write(data, len);
+        else if (write(sock, data, len) < 0) {}
+    }
+
+    // 战斗输入：UDP 就绪后移动/攻击走不可靠输入
+    void send_game(const GamePacket& pkt) {
+        if (udp && udp->has_received() && udp->send_input(&pkt, sizeof(pkt))) return;
+        send(&pkt, sizeof(pkt));
+    }
+
+    // 读出所有可读数据；返回 false 表示连接断开
+    bool pump() {
+        char tmp[65536];
+        while (true) {
+            ssize_t n = shm ? (ssize_t)shm->read(tmp, sizeof(tmp)) : read(sock, tmp, sizeof(tmp));
+            if (n > 0) { buf.insert(buf.end(), tmp, tmp + n); bytes += n; continue; }
+            if (shm || (n < 0 && errno == EAGAIN)) break;
+            return false;
+        }
+        return true;
+    }
+};
+
+static size_t packet_len(int type) {
+    switch (type) {
+        case TYPE_LOGIN_RESP: case TYPE_REG_RESP: return sizeof(LoginResponsePacket);
+        case TYPE_TRANSPORT_UDP: return sizeof(TransportUdpPacket);
+        case TYPE_ROOM_LIST_RESP: return sizeof(RoomListPacket);
+        case TYPE_ROOM_PAGE_RESP: return sizeof(RoomPagePacket);
+        case TYPE_ROOM_DELTA: return sizeof(RoomDeltaPacket);
+        case TYPE_ROOM_UPDATE: return sizeof(RoomStatePacket);
+        case TYPE_GAME_OVER: return sizeof(GameOverPacket);
+        case TYPE_GAME_START: case TYPE_FRAME: case TYPE_UPDATE: case TYPE_EFFECT:
+        case TYPE_SKILL_U: case TYPE_SKILL_I: return sizeof(GamePacket);
+        default: return 0;
+    }
+}
+
+static UdpLinkSim udp_sim;
+static sockaddr_in server_addr;
+
+static void udp_setup(Bot& b, const TransportUdpPacket* pkt) {
+    if (pkt->result != RET_SUCCESS || b.udp) return;
+    b.udp_sock = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in addr = server_addr;
+    addr.sin_port = htons(pkt->port);
+    connect(b.udp_sock, (sockaddr*)&addr, sizeof(addr));
+    int s = b.udp_sock;
+    b.udp = new UdpSession(pkt->conn_id, pkt->token, [s, addr](const char* data, size_t len) {
+        udp_sim.send(s, data, len, (const sockaddr*)&addr, sizeof(addr));
+    });
+    b.udp->send_hello();
+}
+
+static void handle_packet(Bot& b, int type, const char* p) {
+    if (type == TYPE_TRANSPORT_UDP) {
+        udp_setup(b, (const TransportUdpPacket*)p);
+    } else if (type == TYPE_ROOM_UPDATE) {
+        const RoomStatePacket* st = (const RoomStatePacket*)p;
+        if (st->status == ROOM_STATUS_PICKING && !b.picked) {
+            GamePacket sel;
+            memset(&sel, 0, sizeof(sel));
+            sel.type = TYPE_SELECT;
+            sel.input = HERO_WARRIOR + rand() % 3;
+            b.send(&sel, sizeof(sel));
+            b.picked = true;
+        }
+    } else if (type == TYPE_GAME_START) {
+        b.in_game = true;
+    } else if (type == TYPE_FRAME) {
+        b.frames++;
+    } else if (type == TYPE_GAME_OVER) {
+        b.in_game = false;
+    }
+}
+
+static void handle_packets(Bot& b) {
+    size_t ptr = 0;
+    while (b.buf.size() - ptr >= 4) {
+        int type = *(int*)(b.buf.data() + ptr);
+        size_t len = packet_len(type);
+        if (len == 0) { ptr = b.buf.size(); break; } // 不认识的包，丢弃缓冲
+        if (b.buf.size() - ptr < len) break;
+        handle_packet(b, type, b.buf.data() + ptr);
+        ptr += len;
+    }
+    b.buf.erase(b.buf.begin(), b.buf.begin() + ptr);
+}
+
+// UDP 收到的每条消息都由完整的包组成
+static void pump_udp(Bot& b, long long now) {
+    if (!b.udp) return;
+    char buf[2048];
+    ssize_t n;
+    while ((n = recv(b.udp_sock, buf, sizeof(buf), MSG_DONTWAIT)) > 0) {
+        b.bytes += n;
+        b.udp->on_datagram(buf, n, now, [&b](int kind, const char* data, size_t len) {
+            (void)kind;
+            size_t off = 0;
+            while (off + sizeof(int) <= len) {
+                int type = *(const int*)(data + off);
+                size_t pkt_len = packet_len(type);
+                if (pkt_len == 0 || off + pkt_len > len) break;
+                handle_packet(b, type, data + off);
+                off += pkt_len;
+            }
+        });
+    }
+    if (!b.udp->has_received()) b.udp->send_hello(); // 握手包丢了就一直重发
+    b.udp->flush(now);
+}
+
+static int connect_tcp(const char* host, int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(port);
+    sa.sin_addr.s_addr = inet_addr(host);
+    if (connect(fd, (sockaddr*)&sa, sizeof(sa)) < 0) { close(fd); return -1; }
+    int flag = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+    return fd;
+}
+
+int main(int argc, char** argv) {
+    const char* host = "127.0.0.1";
+    int port = 8888;
+    const char* unix_path = nullptr;
+    bool use_shm = false;
+    bool use_udp = false;
+    int bot_count = 10;
+    int seconds = 10;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--unix") && i + 1 < argc) unix_path = argv[++i];
+        else if (!strcmp(argv[i], "--shm")) use_shm = true;
+        else if (!strcmp(argv[i], "--udp")) use_udp = true;
+        else if (!strcmp(argv[i], "--udp-sim") && i + 1 < argc) udp_sim.parse(argv[++i]);
+        else if (!strcmp(argv[i], "--port") && i + 1 < argc) port = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--bots") && i + 1 < argc) bot_count = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seconds") && i + 1 < argc) seconds = atoi(argv[++i]);
+    }
+    if (use_shm && !unix_path) {
+        std::cout << "--shm requires --unix" << std::endl;
+        return -1;
+    }
+    if (use_udp && unix_path) {
+        std::cout << "--udp requires tcp" << std::endl;
+        return -1;
+    }
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_addr.s_addr = inet_addr(host);
+
+    srand(getpid());
+    std::vector<Bot> bots(bot_count);
+    for (int i = 0; i < bot_count; i++) {
+        Bot& b = bots[i];
+        b.sock = unix_path ? unix_connect(unix_path) : connect_tcp(host, port);
+        if (b.sock < 0) { std::cout << "connect failed" << std::endl; return -1; }
+        b.shm = nullptr;
+        if (use_shm) {
+            b.shm = shm_upgrade(b.sock); // 升级握手是阻塞的，之后 socket 只用来维持连接
+            if (!b.shm) { std::cout << "shm upgrade failed" << std::endl; return -1; }
+        }
+        fcntl(b.sock, F_SETFL, fcntl(b.sock, F_GETFL, 0) | O_NONBLOCK);
+        b.name = "bot" + std::to_string(getpid() % 10000) + "_" + std::to_string(i);
+        b.in_game = b.picked = false;
+        b.frames = b.bytes = 0;
+        b.udp = nullptr;
+        b.udp_sock = -1;
+
+        LoginPacket lp;
+        memset(&lp, 0, sizeof(lp));
+        strncpy(lp.username, b.name.c_str(), 31);
+        strcpy(lp.password, "bench");
+        lp.type = TYPE_REG_REQ;
+        b.send(&lp, sizeof(lp));
+        lp.type = TYPE_LOGIN_REQ;
+        b.send(&lp, sizeof(lp));
+        if (use_udp) {
+            int t = TYPE_TRANSPORT_UDP; // 服务器在登录结果出来后才解析它
+            b.send(&t, sizeof(t));
+        }
+        int match = TYPE_MATCH_REQ;
+        b.send(&match, sizeof(match));
+    }
+
+    const char* mode = use_shm ? "shm" : (unix_path ? "unix" : (use_udp ? "udp" : "tcp"));
+    std::cout << "[Bench] " << bot_count << " bots over " << mode << ", waiting for match..." << std::endl;
+
+    long long start = now_ms();
+    long long game_start = 0;
+    long long last_input = 0;
+    while (true) {
+        long long now = now_ms();
+        int playing = 0;
+        for (Bot& b : bots) {
+            if (!b.pump()) { std::cout << "[Bench] " << b.name << " disconnected" << std::endl; return -1; }
+            handle_packets(b);
+            pump_udp(b, now);
+            if (b.in_game) playing++;
+        }
+
+        if (!game_start && playing == bot_count) {
+            game_start = now;
+            for (Bot& b : bots) { b.frames = 0; b.bytes = 0; }
+            std::cout << "[Bench] All bots in game after " << (now - start) << " ms" << std::endl;
+        }
+        if (game_start && now - last_input >= 100) {
+            for (Bot& b : bots) {
+                GamePacket mv;
+                memset(&mv, 0, sizeof(mv));
+                mv.type = TYPE_MOVE;
+                mv.x = rand() % 3 - 1;
+                mv.y = rand() % 3 - 1;
+                b.send_game(mv);
+                mv.type = TYPE_ATTACK;
+                b.send_game(mv);
+            }
+            last_input = now;
+        }
+        udp_sim.pump();
+        if (game_start && now - game_start >= seconds * 1000) break;
+        if (!game_start && now - start > 30000) { std::cout << "[Bench] Match timeout" << std::endl; return -1; }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    long long frames = 0, bytes = 0;
+    for (Bot& b : bots) { frames += b.frames; bytes += b.bytes; }
+    double secs = seconds;
+    std::cout << "[Bench] " << mode << ": " << frames / secs / bot_count << " frames/s per bot, "
+              << bytes / secs / 1024 / 1024 << " MB/s received" << std::endl;
+    if (use_udp) {
+        int ready = 0, rtt = 0;
+        for (Bot& b : bots) if (b.udp && b.udp->has_received()) { ready++; rtt += b.udp->rtt_ms(); }
+        std::cout << "[Bench] udp: " << ready << "/" << bot_count << " bots on UDP, avg rtt "
+                  << (ready ? rtt / ready : 0) << " ms" << std::endl;
+    }
+
+    for (Bot& b : bots) {
+        delete b.shm;
+        delete b.udp;
+        if (b.udp_sock >= 0) close(b.udp_sock);
+        close(b.sock);
+    }
+    return 0;
+}
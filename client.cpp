@@ -11,9 +11,14 @@
 #include <cmath>
 #include <chrono> 
 #include <algorithm>
+#include <deque>
+#include <unordered_set>
 
 #include "protocol.h"
 #include "map.h" 
+#include "udp_transport.h"
+#include "game_room.h"
+#include "net_io.h"
 
 // ==========================================
 // 1. 全局状态管理 (AppContext)
@@ -29,6 +34,20 @@ enum AppState {
     STATE_SETTLEMENT      // 结算页面
 };
 
+// [新增] 已在本地预测、还没被服务器确认的一次移动
+struct PendingMove {
+    int seq;
+    int dx, dy;
+    long long time;
+};
+
+// [新增] 插值缓冲里的一整帧，按服务器时间戳排列
+struct SnapshotFrame {
+    int server_ms;
+    std::vector<GamePacket> entities;
+    std::vector<GamePacket> effects;
+};
+
 struct AppContext {
     AppState state;
     int sock;
@@ -40,7 +59,14 @@ struct AppContext {
     
     // Lobby & Room
     std::vector<RoomInfo> room_list; 
+    int lobby_page;        // [新增] 房间目录分页/过滤
+    int lobby_filter;
+    int lobby_total_pages;
+    int lobby_total_rooms;
     bool is_matching;
+    long long busy_until;  // [新增] 服务器回了"忙"，大厅底栏提示到这个时间
+    int lobby_prompt;      // [新增] 正在输入的房间号：0 无，'j' 加入，'o' 观战
+    char prompt_buf[32];
     RoomStatePacket current_room; 
     int my_slot_idx; 
 
@@ -56,6 +82,16 @@ struct AppContext {
     std::vector<GamePacket> pending_world_state;  
     std::vector<GamePacket> pending_effects_state;
 
+    // [新增] 插值：画面按服务器时间落后 INTERP_DELAY_MS，world_state/effects_state 每次绘制前从这里算出来
+    std::deque<SnapshotFrame> snapshots;
+    long long clock_offset;   // 本地时间 - 服务器时间 (取到达最早的那一帧，即网络延迟最小的估计)
+    bool has_clock;
+    int view_server_ms;       // 当前画面对应的服务器时间，随普攻发出，服务器据此做延迟补偿
+
+    // [新增] 服务器 PING 里带来的延迟统计 (-1 表示还没有)
+    int ping_ms, ping_jitter_ms;
+    int room_p95_ms, global_p95_ms;
+
     GamePacket my_hero_status;
     bool has_hero_data;
     
@@ -79,9 +115,31 @@ struct AppContext {
     int stuck_frames;
     long long last_auto_move_time;
 
+    // [新增] 客户端预测：移动按下就在本地生效；快照带回已执行的序号后，从权威位置重放未确认的移动
+    int move_seq;
+    std::deque<PendingMove> pending_moves;
+
+    // [新增] 观战中：不发操作，镜头用 WASD 自由移动
+    bool spectating;
+
+    // [新增] 帧同步 (启动参数 --lockstep)：本地跑一份 GameRoom，服务器只发输入
+    bool want_lockstep;
+    GameRoom* replica;
+    int replica_fd;     // 自己在服务器上的 fd，副本发给它的包就是本地画面
+    std::vector<std::string> early_lockstep; // 开局包走 UDP 时可能比帧同步包晚到，先到的攒在这里
+
     // 结算相关
     GameOverPacket game_result;
     long long game_over_time;
+
+    // [新增] UDP 战斗通道 (启动参数 --udp)
+    sockaddr_in server_addr;
+    bool want_udp;
+    int udp_sock;
+    UdpSession* udp;
+    UdpLinkSim udp_sim;
+    bool udp_ready;
+    long long udp_last_hello;
 };
 
 // 全局上下文实例
@@ -89,6 +147,10 @@ AppContext ctx;
 
 const int UI_TOP_H = 1;
 const int UI_BOT_H = 6;
+const int PREDICT_MOVE_TIMEOUT_MS = 1000; // UDP 上丢了的移动永远等不到确认，超时后不再重放
+const int INTERP_DELAY_MS = 66;           // 约两个服务器帧，中间丢一帧或到得不匀也有两端可插
+const int EXTRAPOLATE_MAX_MS = 100;       // 缓冲断流时最多按速度外推这么久，之后停在原地等
+const size_t SNAPSHOT_BUFFER_MAX = 32;
 
 // ==========================================
 // 2. 辅助工具
@@ -99,16 +161,150 @@ long long get_ms() {
     return std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count();
 }
 
+// [新增] 拉取当前页并订阅，之后该页的变化由服务器推送 (TYPE_ROOM_DELTA)
+void request_room_page() {
+    RoomPageRequest req = { TYPE_ROOM_PAGE_REQ, ctx.lobby_filter, ctx.lobby_page, 1 };
+    write(ctx.sock, &req, sizeof(req));
+}
+
+// [新增] 退出观战
+void send_spectate_stop() {
+    SpectatePacket pkt; memset(&pkt, 0, sizeof(pkt));
+    pkt.type = TYPE_SPECTATE;
+    write(ctx.sock, &pkt, sizeof(pkt));
+    ctx.spectating = false;
+}
+
+void apply_room_delta(const RoomDeltaPacket* d) {
+    for (int i = 0; i < d->count && i < ROOM_DELTA_MAX; i++) {
+        const RoomDeltaEntry& e = d->entries[i];
+        auto it = ctx.room_list.begin();
+        while (it != ctx.room_list.end() && it->room_id != e.info.room_id) ++it;
+        if (e.op == ROOM_DELTA_REMOVE) {
+            if (it != ctx.room_list.end()) ctx.room_list.erase(it);
+        } else if (it != ctx.room_list.end()) {
+            *it = e.info;
+        } else {
+            ctx.room_list.push_back(e.info);
+        }
+    }
+    std::sort(ctx.room_list.begin(), ctx.room_list.end(),
+              [](const RoomInfo& a, const RoomInfo& b) { return a.room_id < b.room_id; });
+    ctx.lobby_total_pages = d->total_pages;
+    ctx.lobby_total_rooms = d->total_rooms;
+}
+
 void add_log(const std::string& msg) {
     ctx.logs.push_back(msg);
     if(ctx.logs.size() > 5) ctx.logs.erase(ctx.logs.begin());
 }
 
+// =========================================
+// [新增] UDP 战斗通道
+// 登录后申请，收到 conn_id/token 后从 UDP socket 发 HELLO，服务器回包即就绪。
+// 就绪后移动/攻击走冗余的不可靠输入，购买/技能走可靠通道；快照和开局/结算从 UDP 回来。
+// 长时间收不到 UDP 数据报就退回 TCP (服务器那边同样会退回)。
+// =========================================
+
+void udp_request() {
+    if (!ctx.want_udp || ctx.udp) return;
+    int t = TYPE_TRANSPORT_UDP;
+    write(ctx.sock, &t, sizeof(t));
+}
+
+// [新增] 登录后回一个序号为 0 的 PONG，声明本客户端参与延迟测量
+void ping_optin() {
+    PingPacket pkt; memset(&pkt, 0, sizeof(pkt));
+    pkt.type = TYPE_PONG;
+    pkt.client_ms = get_ms();
+    write(ctx.sock, &pkt, sizeof(pkt));
+    ctx.ping_ms = ctx.ping_jitter_ms = ctx.room_p95_ms = ctx.global_p95_ms = -1;
+}
+
+void udp_setup(const TransportUdpPacket* pkt) {
+    if (pkt->result != RET_SUCCESS || ctx.udp) return;
+    int s = socket(AF_INET, SOCK_DGRAM, 0);
+    if (s < 0) return;
+    sockaddr_in addr = ctx.server_addr;
+    addr.sin_port = htons(pkt->port);
+    connect(s, (sockaddr*)&addr, sizeof(addr)); // 只收服务器的数据报
+
+    ctx.udp_sock = s;
+    ctx.udp = new UdpSession(pkt->conn_id, pkt->token, [addr](const char* data, size_t len) {
+        ctx.udp_sim.send(ctx.udp_sock, data, len, (const sockaddr*)&addr, sizeof(addr));
+    });
+    ctx.udp_last_hello = 0;
+}
+
+void handle_packet(int type, void* pdata);
+size_t packet_length(int type);
+size_t packet_size_at(const char* p, size_t avail);
+
+void udp_poll() {
+    if (!ctx.udp) return;
+    long long now = get_ms();
+    char buf[2048];
+    ssize_t n;
+    while ((n = recv(ctx.udp_sock, buf, sizeof(buf), MSG_DONTWAIT)) > 0) {
+        ctx.udp->on_datagram(buf, n, now, [](int kind, const char* data, size_t len) {
+            (void)kind;
+            // 每条消息 (快照/可靠消息) 都由完整的包组成
+            size_t off = 0;
+            while (off + sizeof(int) <= len) {
+                int type = *(const int*)(data + off);
+                size_t pkt_len = packet_size_at(data + off, len - off);
+                if (pkt_len == 0 || off + pkt_len > len) break;
+                handle_packet(type, (void*)(data + off));
+                off += pkt_len;
+            }
+        });
+    }
+
+    bool ready = ctx.udp->has_received() && now - ctx.udp->last_recv_ms() <= UDP_TIMEOUT_MS;
+    if (ready != ctx.udp_ready) {
+        ctx.udp_ready = ready;
+        add_log(ready ? "[NET] UDP channel ready" : "[NET] UDP lost, back to TCP");
+    }
+    if (!ready && now - ctx.udp_last_hello >= 200) {
+        ctx.udp->send_hello();
+        ctx.udp_last_hello = now;
+    }
+    ctx.udp->flush(now);
+    ctx.udp_sim.pump();
+}
+
+// 战斗中的操作：UDP 就绪时移动/攻击走不可靠输入，购买/技能走可靠通道，否则照旧走 TCP
+void send_game(const GamePacket& pkt) {
+    if (ctx.udp_ready) {
+        bool input = (pkt.type == TYPE_MOVE || pkt.type == TYPE_ATTACK);
+        bool ok = input ? ctx.udp->send_input(&pkt, sizeof(pkt)) : ctx.udp->send_reliable(&pkt, sizeof(pkt));
+        if (ok) return;
+    }
+    write(ctx.sock, &pkt, sizeof(pkt));
+}
+
 bool is_walkable(int x, int y) {
     if (x < 0 || x >= MAP_SIZE || y < 0 || y >= MAP_SIZE) return false;
     return (ctx.game_map[y][x] != TILE_WALL);
 }
 
+// [新增] 与 GameRoom::is_blocked_by_tower 同样的规则；快照里只有活着的塔，塔格子上找得到塔就是挡路
+bool predict_blocked(int x, int y) {
+    if (!is_walkable(x, y)) return true;
+    int t = ctx.game_map[y][x];
+    if ((t >= 11 && t <= 23) || t == TILE_BASE) {
+        for (const auto& p : ctx.world_state) {
+            if (p.id >= TOWER_ID_START && p.id < MINION_ID_START && p.x == x && p.y == y) return p.hp > 0;
+        }
+    }
+    return false;
+}
+
+void predict_step(int& x, int& y, int dx, int dy) {
+    int nx = x + dx, ny = y + dy;
+    if (!predict_blocked(nx, ny)) { x = nx; y = ny; }
+}
+
 void update_camera(int hx, int hy) {
     ctx.view_w = COLS / 2;
     ctx.view_h = LINES - UI_TOP_H - UI_BOT_H;
@@ -122,6 +318,126 @@ void update_camera(int hx, int hy) {
     if (ctx.cam_y > MAP_SIZE - ctx.view_h) ctx.cam_y = MAP_SIZE - ctx.view_h;
 }
 
+// [新增] 移动带上序号发出去，同时在本地先走一步 (画面和镜头都取自己那条实体)
+void send_move(int dx, int dy) {
+    GamePacket mv; memset(&mv, 0, sizeof(mv));
+    mv.type = TYPE_MOVE; mv.x = dx; mv.y = dy;
+    if (ctx.has_hero_data) {
+        mv.extra = ++ctx.move_seq;
+        ctx.pending_moves.push_back({mv.extra, dx, dy, get_ms()});
+
+        int x = ctx.my_hero_status.x, y = ctx.my_hero_status.y;
+        predict_step(x, y, dx, dy);
+        ctx.my_hero_status.x = x; ctx.my_hero_status.y = y;
+        for (auto& p : ctx.world_state) {
+            if (p.id == ctx.my_id) { p.x = x; p.y = y; break; }
+        }
+        update_camera(x, y);
+    }
+    send_game(mv);
+}
+
+// [新增] 收到权威位置：丢掉已确认 (或超时) 的移动，剩下的在权威位置上重放一遍
+void reconcile_hero(GamePacket& me) {
+    long long now = get_ms();
+    while (!ctx.pending_moves.empty() &&
+           (ctx.pending_moves.front().seq <= me.extra || now - ctx.pending_moves.front().time > PREDICT_MOVE_TIMEOUT_MS)) {
+        ctx.pending_moves.pop_front();
+    }
+    for (const auto& m : ctx.pending_moves) predict_step(me.x, me.y, m.dx, m.dy);
+}
+
+void clear_snapshots() {
+    ctx.snapshots.clear();
+    ctx.has_clock = false;
+    ctx.view_server_ms = 0;
+}
+
+// [新增] 收到一整帧：进插值缓冲，并用它校准本地与服务器的时间差
+// [修改] partial 为服务器降级后的部分帧：这帧没带的实体沿用上一帧
+void push_snapshot(int server_ms, bool partial) {
+    long long now = get_ms();
+    if (!ctx.snapshots.empty() && server_ms <= ctx.snapshots.back().server_ms) {
+        if (server_ms > ctx.snapshots.back().server_ms - 1000) {
+            // 乱序到达的旧帧：丢掉它攒下的实体/特效，否则会混进下一帧
+            ctx.pending_world_state.clear();
+            ctx.pending_effects_state.clear();
+            return;
+        }
+        clear_snapshots();                                              // 时间倒退很多：换了一局
+    }
+    long long sample = now - server_ms;
+    // 时间差只往小里跟 (到得越早越接近真实的单程延迟)，偏离太多 (如延迟观战切换) 时重新取
+    if (!ctx.has_clock || sample < ctx.clock_offset || sample - ctx.clock_offset > 1000) ctx.clock_offset = sample;
+    ctx.has_clock = true;
+
+    SnapshotFrame f;
+    f.server_ms = server_ms;
+    f.entities.swap(ctx.pending_world_state);
+    f.effects.swap(ctx.pending_effects_state);
+    if (partial && !ctx.snapshots.empty()) {
+        std::unordered_set<int> present;
+        for (const auto& e : f.entities) present.insert(e.id);
+        for (const auto& e : ctx.snapshots.back().entities) {
+            if (!present.count(e.id)) f.entities.push_back(e);
+        }
+    }
+    ctx.snapshots.push_back(std::move(f));
+    if (ctx.snapshots.size() > SNAPSHOT_BUFFER_MAX) ctx.snapshots.pop_front();
+}
+
+// 两帧之间相距太远的 (复活、闪现) 直接跳过去，不插值
+static int blend(int from, int to, float t) {
+    if (abs(to - from) > 3) return (t < 1.0f) ? from : to;
+    return from + (int)lroundf((to - from) * t);
+}
+
+// [新增] 按 "现在 - 延迟" 的服务器时间算出要画的一帧：落在两帧之间就插值，缓冲见底就有限外推
+void update_interpolation() {
+    if (ctx.snapshots.empty()) return;
+    long long render_ms = get_ms() - ctx.clock_offset - INTERP_DELAY_MS;
+    while (ctx.snapshots.size() > 2 && ctx.snapshots[1].server_ms <= render_ms) ctx.snapshots.pop_front();
+    ctx.view_server_ms = (int)std::max(0LL, std::min(render_ms, (long long)ctx.snapshots.back().server_ms));
+
+    const SnapshotFrame* base = &ctx.snapshots.front();
+    const SnapshotFrame* other = nullptr;
+    float t = 0;
+    if (ctx.snapshots.size() >= 2) {
+        const SnapshotFrame& a = ctx.snapshots[0];
+        const SnapshotFrame& b = ctx.snapshots[1];
+        if (render_ms < b.server_ms) {
+            other = &b;
+            if (render_ms > a.server_ms) t = (float)(render_ms - a.server_ms) / (b.server_ms - a.server_ms);
+        } else {
+            // 外推：从最新一帧沿 a->b 的速度往前走，最多 EXTRAPOLATE_MAX_MS
+            base = &b;
+            other = &a;
+            long long ahead = std::min<long long>(render_ms - b.server_ms, EXTRAPOLATE_MAX_MS);
+            t = -(float)ahead / (b.server_ms - a.server_ms);
+        }
+    }
+
+    ctx.world_state = base->entities;
+    ctx.effects_state = base->effects;
+    if (other && t != 0) {
+        for (auto& e : ctx.world_state) {
+            for (const auto& o : other->entities) {
+                if (o.id != e.id) continue;
+                e.x = blend(e.x, o.x, t);
+                e.y = blend(e.y, o.y, t);
+                break;
+            }
+        }
+    }
+
+    // 自己的英雄不等插值，用最新的预测位置
+    if (!ctx.has_hero_data) return;
+    for (auto& e : ctx.world_state) {
+        if (e.id == ctx.my_id) { e = ctx.my_hero_status; return; }
+    }
+    ctx.world_state.push_back(ctx.my_hero_status);
+}
+
 // 获取装备中文名
 const char* get_item_name(int id) {
     switch(id) {
@@ -165,6 +481,9 @@ void draw_login() {
 void draw_lobby() {
     erase();
     mvprintw(1, 2, "Welcome, %s!  [Lobby]", ctx.username.c_str());
+    const char* filter_names[ROOM_FILTER_COUNT] = { "All", "Open", "Playing" };
+    mvprintw(1, COLS - 40, "Filter: %-8s Page %d/%d (%d rooms)", filter_names[ctx.lobby_filter],
+             ctx.lobby_page + 1, ctx.lobby_total_pages > 0 ? ctx.lobby_total_pages : 1, ctx.lobby_total_rooms);
     mvhline(2, 0, ACS_HLINE, COLS);
     mvprintw(4, 4, "ID   Owner           Players   Status");
     for (size_t i = 0; i < ctx.room_list.size(); i++) {
@@ -175,8 +494,33 @@ void draw_lobby() {
     int by = LINES - 4;
     attron(A_BOLD);
     if (ctx.is_matching) { attron(COLOR_PAIR(2) | A_BLINK); mvprintw(by, 2, ">>> MATCHING... <<<"); attroff(COLOR_PAIR(2) | A_BLINK); }
-    else mvprintw(by, 2, "[C] Create   [J] Join ID   [M] Match   [R] Refresh   [Q] Quit");
+    else if (get_ms() < ctx.busy_until) { attron(COLOR_PAIR(2)); mvprintw(by, 2, "Server busy, please try again"); attroff(COLOR_PAIR(2)); }
+    else mvprintw(by, 2, "[C] Create   [J] Join ID   [O] Watch ID   [M] Match   [N/P] Page   [F] Filter   [R] Refresh   [Q] Quit");
     attroff(A_BOLD);
+    if (ctx.lobby_prompt != 0) {
+        mvprintw(LINES-2, 2, "%s%s", ctx.lobby_prompt == 'j' ? "Enter Room ID: " : "Watch Room ID [delay sec]: ", ctx.prompt_buf);
+    }
+}
+
+// [修改] 房间号输入框：回车提交，ESC 取消
+void submit_lobby_prompt() {
+    const char* buf = ctx.prompt_buf;
+    if (ctx.lobby_prompt == 'j') {
+        // 只有输入有效数字才发送请求
+        if (strlen(buf) > 0) {
+            RoomControlPacket pkt = { TYPE_JOIN_ROOM, atoi(buf), 0, 0 };
+            write(ctx.sock, &pkt, sizeof(pkt));
+        }
+    } else if (ctx.lobby_prompt == 'o') {
+        // [新增] 观战: "房间号 [延迟秒数]"
+        SpectatePacket pkt; memset(&pkt, 0, sizeof(pkt));
+        pkt.type = TYPE_SPECTATE;
+        if (sscanf(buf, "%d %d", &pkt.room_id, &pkt.delay_sec) >= 1 && pkt.room_id > 0) {
+            write(ctx.sock, &pkt, sizeof(pkt));
+        }
+    }
+    ctx.lobby_prompt = 0;
+    curs_set(0);
 }
 
 void draw_room() {
@@ -619,7 +963,8 @@ void draw_game_ui() {
     // 时间与金币
     int m = ctx.game_time / 60; int s = ctx.game_time % 60;
     attron(COLOR_PAIR(10) | A_BOLD); 
-    mvprintw(0, 2, "Time: %02d:%02d   Gold: %d", m, s, ctx.my_gold); 
+    if (ctx.spectating) mvprintw(0, 2, "Time: %02d:%02d   SPECTATING", m, s);
+    else mvprintw(0, 2, "Time: %02d:%02d   Gold: %d", m, s, ctx.my_gold); 
     attroff(COLOR_PAIR(10) | A_BOLD);
     
     // 击杀比分板
@@ -631,6 +976,17 @@ void draw_game_ui() {
     mvprintw(0, score_x, "%s", score_buf);
     attroff(COLOR_PAIR(10) | A_BOLD);
 
+    // [新增] 延迟：本连接的平滑 RTT ± 抖动，后面是本房间的 95 分位
+    attron(COLOR_PAIR(10));
+    if (ctx.ping_ms >= 0) {
+        char ping_buf[48];
+        if (ctx.room_p95_ms >= 0) snprintf(ping_buf, 48, "Ping %dms +-%d (p95 %d)", ctx.ping_ms, ctx.ping_jitter_ms, ctx.room_p95_ms);
+        else snprintf(ping_buf, 48, "Ping %dms +-%d", ctx.ping_ms, ctx.ping_jitter_ms);
+        int ping_x = W - 17 - (int)strlen(ping_buf);
+        if (ping_x > score_x + (int)strlen(score_buf)) mvprintw(0, ping_x, "%s", ping_buf); // 窄终端放不下就不画
+    }
+    attroff(COLOR_PAIR(10));
+
     // 退出提示
     attron(COLOR_PAIR(10));
     mvprintw(0, W - 15, "[Q] QUIT"); 
@@ -808,6 +1164,248 @@ void draw_settlement() {
 // 5. 核心网络处理
 // ==========================================
 
+// 按类型取包长，未知类型返回 0
+size_t packet_length(int type) {
+    if (type == TYPE_LOGIN_RESP || type == TYPE_REG_RESP) return sizeof(LoginResponsePacket);
+    else if (type == TYPE_TRANSPORT_UDP) return sizeof(TransportUdpPacket);
+    else if (type == TYPE_ROOM_LIST_RESP) return sizeof(RoomListPacket);
+    else if (type == TYPE_ROOM_PAGE_RESP) return sizeof(RoomPagePacket);
+    else if (type == TYPE_ROOM_DELTA) return sizeof(RoomDeltaPacket);
+    else if (type == TYPE_SPECTATE) return sizeof(SpectatePacket);
+    else if (type == TYPE_PING) return sizeof(PingPacket);
+    else if (type == TYPE_LOCKSTEP_START) return sizeof(LockstepStartPacket);
+    else if (type == TYPE_LOCKSTEP_TICK) return sizeof(LockstepTickPacket); // 只是包头，整包长度见 packet_size_at
+    else if (type == TYPE_ROOM_UPDATE) return sizeof(RoomStatePacket);
+    else if (type == TYPE_GAME_START || type == TYPE_FRAME || type == TYPE_UPDATE || type == TYPE_EFFECT || type == TYPE_SKILL_U || type == TYPE_SKILL_I) return sizeof(GamePacket);
+    else if (type == TYPE_GAME_OVER) return sizeof(GameOverPacket);
+    else if (type >= 10 && type <= 51) return sizeof(int); 
+    return 0;
+}
+
+// [新增] 变长包 (帧同步输入包) 的长度要看包头里的条数；包头没收全时先按包头长度等待
+size_t packet_size_at(const char* p, size_t avail) {
+    int type = *(const int*)p;
+    if (type != TYPE_LOCKSTEP_TICK) return packet_length(type);
+    if (avail < sizeof(LockstepTickPacket)) return sizeof(LockstepTickPacket);
+    const LockstepTickPacket* hdr = (const LockstepTickPacket*)p;
+    if (hdr->count < 0 || hdr->count > LOCKSTEP_MAX_ENTRIES) return 0;
+    return lockstep_tick_size(hdr->count);
+}
+
+// [新增] 本地副本发给自己的包 (整帧快照、结算) 直接当作服务器来的包处理
+void deliver_local(const char* data, size_t len) {
+    size_t off = 0;
+    while (off + sizeof(int) <= len) {
+        size_t pkt_len = packet_size_at(data + off, len - off);
+        if (pkt_len == 0 || off + pkt_len > len) break;
+        handle_packet(*(const int*)(data + off), (void*)(data + off));
+        off += pkt_len;
+    }
+}
+
+// [新增] 本地模拟跟服务器对不上 (帧号断档或哈希不同)：丢掉副本，请服务器改发快照
+void lockstep_fallback(int tick) {
+    GamePacket pkt; memset(&pkt, 0, sizeof(pkt));
+    pkt.type = TYPE_LOCKSTEP_DESYNC;
+    write(ctx.sock, &pkt, sizeof(pkt));
+    delete ctx.replica;
+    ctx.replica = nullptr;
+    add_log("[SYNC] Desync at tick " + std::to_string(tick) + ", using snapshots");
+}
+
+// [修改] 单个包的处理从 process_network 拆出来，TCP 字节流和 UDP 消息共用
+void handle_packet(int type, void* pdata) {
+    if (type == TYPE_TRANSPORT_UDP) {
+        udp_setup((TransportUdpPacket*)pdata);
+        return;
+    }
+    if (type == TYPE_PING) {
+        // [新增] 原样回给服务器，顺便记下它算好的延迟
+        PingPacket* pkt = (PingPacket*)pdata;
+        ctx.ping_ms = pkt->rtt_ms; ctx.ping_jitter_ms = pkt->jitter_ms;
+        ctx.room_p95_ms = pkt->room_p95_ms; ctx.global_p95_ms = pkt->global_p95_ms;
+        PingPacket pong = *pkt;
+        pong.type = TYPE_PONG;
+        pong.client_ms = get_ms();
+        write(ctx.sock, &pong, sizeof(pong));
+        return;
+    }
+    if (type == TYPE_SERVER_BUSY) {
+        // [新增] 服务器过载，刚才的大厅请求被丢弃
+        ctx.is_matching = false;
+        ctx.busy_until = get_ms() + 3000;
+        add_log("[SERVER] Busy, please try again");
+        return;
+    }
+
+    if (ctx.state == STATE_LOGIN) {
+        if (type == TYPE_LOGIN_RESP || type == TYPE_REG_RESP) {
+            LoginResponsePacket* pkt = (LoginResponsePacket*)pdata;
+            if (pkt->result == RET_SUCCESS) {
+                ctx.state = STATE_LOBBY; ctx.my_id = pkt->user_id; ctx.username = ctx.input_user; 
+                request_room_page();
+                udp_request();
+                ping_optin();
+            } else if (pkt->result == RET_FAIL_BUSY) snprintf(ctx.login_msg, 64, "Server busy, try again later");
+            else snprintf(ctx.login_msg, 64, "Error Code: %d", pkt->result);
+        }
+    } 
+    else if (ctx.state == STATE_LOBBY) {
+        if (type == TYPE_ROOM_LIST_RESP) {
+            RoomListPacket* l = (RoomListPacket*)pdata; 
+            ctx.room_list.clear(); for(int i=0; i<l->count; i++) ctx.room_list.push_back(l->rooms[i]); 
+        }
+        else if (type == TYPE_ROOM_PAGE_RESP) {
+            RoomPagePacket* pg = (RoomPagePacket*)pdata;
+            ctx.lobby_page = pg->page; ctx.lobby_filter = pg->filter;
+            ctx.lobby_total_pages = pg->total_pages; ctx.lobby_total_rooms = pg->total_rooms;
+            ctx.room_list.clear(); for(int i=0; i<pg->count; i++) ctx.room_list.push_back(pg->rooms[i]);
+        }
+        else if (type == TYPE_ROOM_DELTA) {
+            apply_room_delta((RoomDeltaPacket*)pdata);
+        }
+        else if (type == TYPE_SPECTATE) {
+            // [新增] 观战应答：成功就直接进战斗画面，等服务器转发房间的帧
+            SpectatePacket* sp = (SpectatePacket*)pdata;
+            if (sp->result == RET_SUCCESS && sp->room_id != 0) {
+                ctx.state = STATE_GAME; MapGenerator::init(ctx.game_map);
+                ctx.spectating = true; ctx.my_id = -1; ctx.has_hero_data = false;
+                ctx.my_gold = 0; ctx.show_shop = false; ctx.is_auto_moving = false;
+                memset(ctx.my_items, 0, sizeof(ctx.my_items));
+                ctx.team1_score = 0; ctx.team2_score = 0;
+                ctx.world_state.clear(); ctx.effects_state.clear();
+                ctx.pending_world_state.clear(); ctx.pending_effects_state.clear();
+                clear_snapshots();
+                update_camera(MAP_SIZE / 2, MAP_SIZE / 2);
+                add_log("[WATCH] Room " + std::to_string(sp->room_id) + ", delay " + std::to_string(sp->delay_sec) + "s");
+            }
+        }
+        else if (type == TYPE_ROOM_UPDATE) {
+            ctx.current_room = *(RoomStatePacket*)pdata; 
+            if (ctx.current_room.status == ROOM_STATUS_PICKING) ctx.state = STATE_PICK;
+            else ctx.state = STATE_ROOM;
+            ctx.is_matching = false; 
+        }
+    } 
+    else if (ctx.state == STATE_ROOM || ctx.state == STATE_PICK) {
+        if (type == TYPE_ROOM_UPDATE) { 
+            ctx.current_room = *(RoomStatePacket*)pdata; 
+            ctx.my_slot_idx = -1; 
+            for(int i=0; i<10; i++) if(ctx.current_room.slots[i].is_taken && strcmp(ctx.current_room.slots[i].name, ctx.username.c_str())==0) ctx.my_slot_idx=i;
+            
+            // 状态跳转
+            if (ctx.current_room.status == ROOM_STATUS_PICKING) ctx.state = STATE_PICK;
+            else if (ctx.current_room.status == ROOM_STATUS_WAITING) ctx.state = STATE_ROOM;
+        } 
+        else if (type == TYPE_GAME_START) {
+            ctx.state = STATE_GAME; MapGenerator::init(ctx.game_map); 
+            GamePacket* gp = (GamePacket*)pdata; ctx.my_id = gp->id; update_camera(0,0); 
+            // 重置游戏数据
+            ctx.my_gold = 0; 
+            ctx.show_shop = false;
+            memset(ctx.my_items, 0, sizeof(ctx.my_items));
+            ctx.team1_score = 0; 
+            ctx.team2_score = 0;
+            ctx.has_hero_data = false;
+            ctx.move_seq = 0; // 服务器开局时也从 0 算
+            ctx.pending_moves.clear();
+            clear_snapshots();
+
+            // [新增] 开局前先到的帧同步包按原顺序补处理
+            std::vector<std::string> early;
+            early.swap(ctx.early_lockstep);
+            for (const std::string& e : early) handle_packet(*(const int*)e.data(), (void*)e.data());
+        }
+        else if ((type == TYPE_LOCKSTEP_START || type == TYPE_LOCKSTEP_TICK) && ctx.want_lockstep) {
+            size_t len = (type == TYPE_LOCKSTEP_START) ? sizeof(LockstepStartPacket)
+                                                       : lockstep_tick_size(((LockstepTickPacket*)pdata)->count);
+            ctx.early_lockstep.emplace_back((const char*)pdata, len);
+        }
+        else if (type == TYPE_ROOM_LIST_RESP) {
+            ctx.early_lockstep.clear();
+            ctx.state = STATE_LOBBY; RoomListPacket* l = (RoomListPacket*)pdata; 
+            ctx.room_list.clear(); for(int i=0; i<l->count; i++) ctx.room_list.push_back(l->rooms[i]); 
+        }
+    } 
+    else if (ctx.state == STATE_GAME) {
+        GamePacket* pkt = (GamePacket*)pdata;
+        if (type == TYPE_FRAME) { 
+            ctx.game_time = pkt->extra; 
+            push_snapshot(pkt->input, pkt->id != 0);
+            ctx.has_hero_data = false;
+            
+            int old_x = ctx.my_hero_status.x; 
+            int old_y = ctx.my_hero_status.y;
+            
+            for(const auto& latest : ctx.snapshots.back().entities) {
+                if (latest.id == ctx.my_id) { 
+                    GamePacket p = latest;
+                    reconcile_hero(p);
+                    ctx.my_hero_status = p; ctx.has_hero_data = true; 
+                    
+                    int dist_sq = (p.x - old_x)*(p.x - old_x) + (p.y - old_y)*(p.y - old_y);
+                    if (dist_sq > 200) { 
+                        ctx.is_auto_moving = false;
+                        update_camera(p.x, p.y);
+                    } else {
+                        update_camera(p.x, p.y); 
+                    }
+                    break; 
+                }
+            }
+        }
+        else if (type == TYPE_UPDATE) { 
+            ctx.pending_world_state.push_back(*pkt); 
+            if (ctx.spectating) {
+                ctx.team1_score = pkt->team1_score;
+                ctx.team2_score = pkt->team2_score;
+            }
+            else if (pkt->id == ctx.my_id) {
+                ctx.my_gold = pkt->gold;
+                memcpy(ctx.my_items, pkt->items, sizeof(ctx.my_items));
+                ctx.team1_score = pkt->team1_score;
+                ctx.team2_score = pkt->team2_score;
+            }
+        }
+        else if (type == TYPE_EFFECT) { ctx.pending_effects_state.push_back(*pkt); }
+        else if (type == TYPE_LOCKSTEP_START && ctx.want_lockstep && !ctx.replica) {
+            // [新增] 按服务器的开局参数在本地开一局，之后的画面都由它产生
+            LockstepStartPacket* sp = (LockstepStartPacket*)pdata;
+            std::cout.setstate(std::ios_base::badbit); // 房间逻辑的日志不能打到 curses 屏幕上
+            ctx.replica = new GameRoom(sp->room_id, "");
+            ctx.replica_fd = sp->self_fd;
+            ctx.replica->start_lockstep_replica(*sp);
+            add_log("[SYNC] Lockstep on, " + std::to_string(sp->player_count) + " players");
+            // 副本开好了才让服务器停发快照
+            GamePacket ready; memset(&ready, 0, sizeof(ready));
+            ready.type = TYPE_LOCKSTEP_READY;
+            write(ctx.sock, &ready, sizeof(ready));
+        }
+        else if (type == TYPE_LOCKSTEP_TICK && ctx.replica) {
+            LockstepTickPacket* hdr = (LockstepTickPacket*)pdata;
+            bool ok = ctx.replica->apply_lockstep_tick(*hdr, (const LockstepInput*)(hdr + 1));
+            if (ok && hdr->has_hash && ctx.replica->state_hash() != hdr->hash) ok = false;
+            if (!ok) lockstep_fallback(hdr->tick);
+        }
+        else if (type == TYPE_SPECTATE && ctx.spectating) {
+            // [新增] 观看的房间已关闭
+            ctx.spectating = false;
+            ctx.state = STATE_LOBBY;
+            request_room_page();
+        }
+        else if (type == TYPE_GAME_OVER) { 
+            GameOverPacket* gp = (GameOverPacket*)pdata;
+            ctx.game_result = *gp;
+            ctx.state = STATE_GAME_OVER_ANIM;
+            ctx.game_over_time = get_ms();
+            // 清理战斗数据
+            ctx.world_state.clear();
+            ctx.effects_state.clear();
+            clear_snapshots();
+        }
+    }
+}
+
 void process_network() {
     static char buf[10240]; 
     static int buf_len = 0; 
@@ -818,112 +1416,11 @@ void process_network() {
     while (ptr < buf_len) {
         if (buf_len - ptr < 4) break; 
         int type = *(int*)(buf + ptr);
-        size_t pkt_len = 0;
-
-        if (type == TYPE_LOGIN_RESP || type == TYPE_REG_RESP) pkt_len = sizeof(LoginResponsePacket);
-        else if (type == TYPE_ROOM_LIST_RESP) pkt_len = sizeof(RoomListPacket);
-        else if (type == TYPE_ROOM_UPDATE) pkt_len = sizeof(RoomStatePacket);
-        else if (type == TYPE_GAME_START || type == TYPE_FRAME || type == TYPE_UPDATE || type == TYPE_EFFECT || type == TYPE_SKILL_U || type == TYPE_SKILL_I) pkt_len = sizeof(GamePacket);
-        else if (type == TYPE_GAME_OVER) pkt_len = sizeof(GameOverPacket);
-        else if (type >= 10 && type <= 51) pkt_len = sizeof(int); 
+        size_t pkt_len = packet_size_at(buf + ptr, buf_len - ptr);
         
         if (pkt_len == 0) { ptr = buf_len; break; } 
         if (buf_len - ptr < pkt_len) break; 
-        void* pdata = buf + ptr;
-
-        if (ctx.state == STATE_LOGIN) {
-            if (type == TYPE_LOGIN_RESP || type == TYPE_REG_RESP) {
-                LoginResponsePacket* pkt = (LoginResponsePacket*)pdata;
-                if (pkt->result == RET_SUCCESS) {
-                    ctx.state = STATE_LOBBY; ctx.my_id = pkt->user_id; ctx.username = ctx.input_user; 
-                    int t = TYPE_ROOM_LIST_REQ; write(ctx.sock, &t, sizeof(t));
-                } else snprintf(ctx.login_msg, 64, "Error Code: %d", pkt->result);
-            }
-        } 
-        else if (ctx.state == STATE_LOBBY) {
-            if (type == TYPE_ROOM_LIST_RESP) {
-                RoomListPacket* l = (RoomListPacket*)pdata; 
-                ctx.room_list.clear(); for(int i=0; i<l->count; i++) ctx.room_list.push_back(l->rooms[i]); 
-            }
-            else if (type == TYPE_ROOM_UPDATE) {
-                ctx.current_room = *(RoomStatePacket*)pdata; 
-                if (ctx.current_room.status == ROOM_STATUS_PICKING) ctx.state = STATE_PICK;
-                else ctx.state = STATE_ROOM;
-                ctx.is_matching = false; 
-            }
-        } 
-        else if (ctx.state == STATE_ROOM || ctx.state == STATE_PICK) {
-            if (type == TYPE_ROOM_UPDATE) { 
-                ctx.current_room = *(RoomStatePacket*)pdata; 
-                ctx.my_slot_idx = -1; 
-                for(int i=0; i<10; i++) if(ctx.current_room.slots[i].is_taken && strcmp(ctx.current_room.slots[i].name, ctx.username.c_str())==0) ctx.my_slot_idx=i;
-                
-                // 状态跳转
-                if (ctx.current_room.status == ROOM_STATUS_PICKING) ctx.state = STATE_PICK;
-                else if (ctx.current_room.status == ROOM_STATUS_WAITING) ctx.state = STATE_ROOM;
-            } 
-            else if (type == TYPE_GAME_START) {
-                ctx.state = STATE_GAME; MapGenerator::init(ctx.game_map); 
-                GamePacket* gp = (GamePacket*)pdata; ctx.my_id = gp->id; update_camera(0,0); 
-                // 重置游戏数据
-                ctx.my_gold = 0; 
-                ctx.show_shop = false;
-                memset(ctx.my_items, 0, sizeof(ctx.my_items));
-                ctx.team1_score = 0; 
-                ctx.team2_score = 0;
-            }
-            else if (type == TYPE_ROOM_LIST_RESP) {
-                ctx.state = STATE_LOBBY; RoomListPacket* l = (RoomListPacket*)pdata; 
-                ctx.room_list.clear(); for(int i=0; i<l->count; i++) ctx.room_list.push_back(l->rooms[i]); 
-            }
-        } 
-        else if (ctx.state == STATE_GAME) {
-            GamePacket* pkt = (GamePacket*)pdata;
-            if (type == TYPE_FRAME) { 
-                ctx.game_time = pkt->extra; 
-                ctx.world_state = ctx.pending_world_state; 
-                ctx.effects_state = ctx.pending_effects_state;
-                ctx.has_hero_data = false;
-                
-                int old_x = ctx.my_hero_status.x; 
-                int old_y = ctx.my_hero_status.y;
-                
-                for(const auto& p : ctx.world_state) {
-                    if (p.id == ctx.my_id) { 
-                        ctx.my_hero_status = p; ctx.has_hero_data = true; 
-                        
-                        int dist_sq = (p.x - old_x)*(p.x - old_x) + (p.y - old_y)*(p.y - old_y);
-                        if (dist_sq > 200) { 
-                            ctx.is_auto_moving = false;
-                            update_camera(p.x, p.y);
-                        } else {
-                            update_camera(p.x, p.y); 
-                        }
-                        break; 
-                    }
-                }
-                ctx.pending_world_state.clear(); ctx.pending_effects_state.clear();
-            }
-            else if (type == TYPE_UPDATE) { 
-                ctx.pending_world_state.push_back(*pkt); 
-                if (pkt->id == ctx.my_id) {
-                    ctx.my_gold = pkt->gold;
-                    memcpy(ctx.my_items, pkt->items, sizeof(ctx.my_items));
-                    ctx.team1_score = pkt->team1_score;
-                    ctx.team2_score = pkt->team2_score;
-                }
-            }
-            else if (type == TYPE_EFFECT) { ctx.pending_effects_state.push_back(*pkt); }
-            else if (type == TYPE_GAME_OVER) { 
-                GameOverPacket* gp = (GameOverPacket*)pdata;
-                ctx.game_result = *gp;
-                ctx.state = STATE_GAME_OVER_ANIM;
-                ctx.game_over_time = get_ms();
-                // 清理战斗数据
-                ctx.world_state.clear();
-                ctx.effects_state.clear();
-            }
-        }
+        handle_packet(type, buf + ptr);
         ptr += pkt_len;
     }
     if (ptr > 0) {
@@ -954,7 +1451,7 @@ void update_auto_move() {
     else { mdy = (diff_y > 0) ? 1 : -1; if (!is_walkable(mx, my+mdy)) { mdy=0; mdx=(diff_x>0)?1:-1; } }
     
     if (mdx != 0 || mdy != 0) {
-        GamePacket mv = {TYPE_MOVE, 0, mdx, mdy}; write(ctx.sock, &mv, sizeof(mv));
+        send_move(mdx, mdy);
     }
 }
 
@@ -995,32 +1492,25 @@ void handle_inputs() {
     // 2. 大厅界面输入
     // ==========================================
     else if (ctx.state == STATE_LOBBY && !ctx.is_matching) {
-        if (ch == 'c' || ch == 'C') { 
+        if (ctx.lobby_prompt != 0) {
+            // [修改] 输入房间号时逐字符读，不再阻塞等 getnstr：主循环照常收包、回 PING，
+            // 否则输入超过几秒就会被服务器按心跳超时断开
+            char* buf = ctx.prompt_buf;
+            size_t len = strlen(buf);
+            size_t max_len = (ctx.lobby_prompt == 'j') ? 10 : 20;
+            if (ch == '\n') submit_lobby_prompt();
+            else if (ch == 27) { ctx.lobby_prompt = 0; curs_set(0); }
+            else if (ch == KEY_BACKSPACE || ch == 127) { if (len > 0) buf[len-1] = '\0'; }
+            else if (ch >= 32 && ch <= 126 && len < max_len) { buf[len] = (char)ch; buf[len+1] = '\0'; }
+        }
+        else if (ch == 'c' || ch == 'C') { 
             int t = TYPE_CREATE_ROOM; 
             write(ctx.sock, &t, sizeof(t)); 
         }
-        else if (ch == 'j' || ch == 'J') { 
-            // [修复] 切换为阻塞模式等待用户输入
-            timeout(-1); 
-            
-            echo(); 
-            curs_set(1); 
-            mvprintw(LINES-2, 2, "Enter Room ID: "); 
-            
-            char buf[16] = {0}; 
-            getnstr(buf, 10); // 现在这里会暂停等待用户输入了
-            
-            noecho(); 
-            curs_set(0);
-            
-            // [修复] 恢复非阻塞模式
-            timeout(0); 
-
-            // 只有输入有效数字才发送请求
-            if (strlen(buf) > 0) {
-                RoomControlPacket pkt = { TYPE_JOIN_ROOM, atoi(buf), 0, 0 }; 
-                write(ctx.sock, &pkt, sizeof(pkt));
-            }
+        else if (ch == 'j' || ch == 'J' || ch == 'o' || ch == 'O') {
+            ctx.lobby_prompt = (ch == 'j' || ch == 'J') ? 'j' : 'o';
+            memset(ctx.prompt_buf, 0, sizeof(ctx.prompt_buf));
+            curs_set(1);
         }
         else if (ch == 'm' || ch == 'M') { 
             int t = TYPE_MATCH_REQ; 
@@ -1028,8 +1518,18 @@ void handle_inputs() {
             ctx.is_matching = true; 
         }
         else if (ch == 'r' || ch == 'R') { 
-            int t = TYPE_ROOM_LIST_REQ; 
-            write(ctx.sock, &t, sizeof(t)); 
+            request_room_page(); 
+        }
+        else if (ch == 'n' || ch == 'N') {
+            if (ctx.lobby_page + 1 < ctx.lobby_total_pages) { ctx.lobby_page++; request_room_page(); }
+        }
+        else if (ch == 'p' || ch == 'P') {
+            if (ctx.lobby_page > 0) { ctx.lobby_page--; request_room_page(); }
+        }
+        else if (ch == 'f' || ch == 'F') {
+            ctx.lobby_filter = (ctx.lobby_filter + 1) % ROOM_FILTER_COUNT;
+            ctx.lobby_page = 0;
+            request_room_page();
         }
     } 
     // ==========================================
@@ -1042,8 +1542,7 @@ void handle_inputs() {
             int t = TYPE_LEAVE_ROOM; 
             write(ctx.sock, &t, sizeof(t)); 
             ctx.state = STATE_LOBBY; 
-            int r = TYPE_ROOM_LIST_REQ; 
-            write(ctx.sock, &r, sizeof(r)); 
+            request_room_page(); 
         }
         else if (ch == 'r' || ch == 'R') { 
             if(!owner) { 
@@ -1088,12 +1587,26 @@ void handle_inputs() {
             GamePacket pkt; memset(&pkt, 0, sizeof(pkt));
             pkt.type = TYPE_SELECT; 
             pkt.input = hid;
+            if (ctx.want_lockstep) pkt.extra = LOCKSTEP_CAPABLE;
             write(ctx.sock, &pkt, sizeof(pkt));
         }
     }
     // ==========================================
     // 5. 游戏战斗中输入
     // ==========================================
+    else if (ctx.state == STATE_GAME && ctx.spectating) {
+        // [新增] 观战：WASD 平移镜头，Q 退出观战
+        if (ch == 'w' || ch == 's' || ch == 'a' || ch == 'd') {
+            int dx=0, dy=0;
+            if(ch=='w') dy=-4; else if(ch=='s') dy=4; else if(ch=='a') dx=-4; else dx=4;
+            update_camera(ctx.cam_x + ctx.view_w / 2 + dx, ctx.cam_y + ctx.view_h / 2 + dy);
+        }
+        else if (ch == 'q' || ch == 'Q') {
+            send_spectate_stop();
+            ctx.state = STATE_LOBBY;
+            request_room_page();
+        }
+    }
     else if (ctx.state == STATE_GAME) {
         // 商店开关
         if (ch == 'b' || ch == 'B') {
@@ -1113,7 +1626,7 @@ void handle_inputs() {
                 GamePacket pkt; memset(&pkt, 0, sizeof(pkt));
                 pkt.type = TYPE_BUY_ITEM;
                 pkt.input = buy_id;
-                write(ctx.sock, &pkt, sizeof(pkt));
+                send_game(pkt);
             }
         }
 
@@ -1122,26 +1635,27 @@ void handle_inputs() {
             ctx.is_auto_moving = false;
             int dx=0, dy=0; 
             if(ch=='w') dy=-1; if(ch=='s') dy=1; if(ch=='a') dx=-1; if(ch=='d') dx=1;
-            GamePacket mv = {TYPE_MOVE, 0, dx, dy}; 
-            write(ctx.sock, &mv, sizeof(mv));
+            send_move(dx, dy);
         } 
         else if (ch == 'j' || ch == 'J') { 
-            GamePacket att = {TYPE_ATTACK}; 
-            write(ctx.sock, &att, sizeof(att)); 
+            GamePacket att; memset(&att, 0, sizeof(att));
+            att.type = TYPE_ATTACK;
+            att.extra = ctx.view_server_ms;
+            send_game(att); 
         }
         else if (ch == 'k' || ch == 'K') { 
             GamePacket spl = {TYPE_SPELL}; 
-            write(ctx.sock, &spl, sizeof(spl)); 
+            send_game(spl); 
         }
         else if (ch == 'u' || ch == 'U') { 
             GamePacket pkt; memset(&pkt, 0, sizeof(pkt)); 
             pkt.type = TYPE_SKILL_U; 
-            write(ctx.sock, &pkt, sizeof(pkt)); 
+            send_game(pkt); 
         }
         else if (ch == 'i' || ch == 'I') { 
             GamePacket pkt; memset(&pkt, 0, sizeof(pkt)); 
             pkt.type = TYPE_SKILL_I; 
-            write(ctx.sock, &pkt, sizeof(pkt)); 
+            send_game(pkt); 
         }
         else if (ch == KEY_MOUSE) {
             MEVENT e; 
@@ -1164,8 +1678,8 @@ void handle_inputs() {
     else if (ctx.state == STATE_SETTLEMENT) {
         if (ch == '\n') {
             // 结算页面回车回大厅
-            int t = TYPE_ROOM_LIST_REQ;
-            write(ctx.sock, &t, sizeof(t));
+            if (ctx.spectating) send_spectate_stop();
+            request_room_page();
             ctx.state = STATE_LOBBY;
         }
     }
@@ -1180,9 +1694,24 @@ int main(int argc, char* argv[]) {
     MapGenerator::init(ctx.game_map); 
 
     // === 支持命令行传入 IP ===
+    // 用法: ./client [IP] [--udp] [--udp-sim 丢包%/延迟ms/抖动ms] [--lockstep]
+    // 编译: g++ -std=c++20 -o client client.cpp udp_transport.cpp game_room.cpp position_history.cpp snapshot_qos.cpp thread_pool.cpp
+    //       timer_wheel.cpp ability_script.cpp net_io.cpp shm_transport.cpp -lncurses -pthread  (帧同步要在本地跑 GameRoom)
     const char* server_ip = "127.0.0.1"; 
-    if (argc > 1) {
-        server_ip = argv[1]; 
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--udp") == 0) ctx.want_udp = true;
+        else if (strcmp(argv[i], "--lockstep") == 0) ctx.want_lockstep = true;
+        else if (strcmp(argv[i], "--udp-sim") == 0 && i + 1 < argc) ctx.udp_sim.parse(argv[++i]);
+        else server_ip = argv[i]; 
+    }
+
+    // [新增] 帧同步时本地副本的发送只有发给自己的才有用，其余丢弃
+    if (ctx.want_lockstep) {
+        set_net_send_hook([](int fd, const void* buf, size_t len, int delivery) -> ssize_t {
+            (void)delivery;
+            if (ctx.replica && fd == ctx.replica_fd) deliver_local((const char*)buf, len);
+            return (ssize_t)len;
+        });
     }
     
     std::cout << "Connecting to server at " << server_ip << "..." << std::endl;
@@ -1203,6 +1732,8 @@ int main(int argc, char* argv[]) {
         return -1;
     }
 
+    ctx.server_addr = s_addr;
+
     int flag = 1; 
     setsockopt(ctx.sock, IPPROTO_TCP, TCP_NODELAY, (char *)&flag, sizeof(int));
 
@@ -1260,9 +1791,13 @@ int main(int argc, char* argv[]) {
 
     while (true) {
         process_network(); 
+        udp_poll();
         handle_inputs();   
         
-        if (ctx.state == STATE_GAME) update_auto_move(); 
+        if (ctx.state == STATE_GAME) { update_auto_move(); update_interpolation(); }
+
+        // [新增] 对局结束后释放本地副本 (不能在副本自己的 update_logic 里删)
+        if (ctx.replica && ctx.state != STATE_GAME) { delete ctx.replica; ctx.replica = nullptr; }
 
         if (ctx.state == STATE_LOGIN) draw_login();
         else if (ctx.state == STATE_LOBBY) draw_lobby();
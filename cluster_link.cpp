@@ -0,0 +1,150 @@
+#include "cluster_link.h"
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <cstdlib>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+ClusterLink::ClusterLink(int sock) : sock(sock), out_off(0) {
+    int flag = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag)); // Unix socket 上会失败，忽略
+}
+
+ClusterLink::~ClusterLink() {
+    close(sock);
+}
+
+void ClusterLink::send(int kind, int room_id, int client_fd, const void* payload, int len) {
+    ClusterFrame hdr = { kind, len, room_id, client_fd };
+    const char* h = (const char*)&hdr;
+    out_buf.insert(out_buf.end(), h, h + sizeof(hdr));
+    if (len > 0) out_buf.insert(out_buf.end(), (const char*)payload, (const char*)payload + len);
+}
+
+bool ClusterLink::flush() {
+    while (out_off < out_buf.size()) {
+        ssize_t n = write(sock, out_buf.data() + out_off, out_buf.size() - out_off);
+        if (n > 0) { out_off += n; continue; }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        return false;
+    }
+    if (out_off == out_buf.size()) {
+        out_buf.clear();
+        out_off = 0;
+    } else if (out_off > 0 && out_off * 2 > out_buf.size()) {
+        out_buf.erase(out_buf.begin(), out_buf.begin() + out_off);
+        out_off = 0;
+    }
+    return out_buf.size() - out_off <= CLUSTER_MAX_BACKLOG;
+}
+
+bool ClusterLink::receive(const std::function<void(const ClusterFrame&, const char*)>& handler) {
+    char chunk[65536];
+    bool alive = true;
+    while (true) {
+        ssize_t n = read(sock, chunk, sizeof(chunk));
+        if (n > 0) { in_buf.insert(in_buf.end(), chunk, chunk + n); continue; }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        alive = false; // 0: 对端关闭
+        break;
+    }
+
+    size_t ptr = 0;
+    while (in_buf.size() - ptr >= sizeof(ClusterFrame)) {
+        ClusterFrame hdr;
+        memcpy(&hdr, in_buf.data() + ptr, sizeof(hdr));
+        if (hdr.len < 0 || hdr.len > CLUSTER_MAX_FRAME) {
+            std::cout << "[Cluster] Bad frame (kind " << hdr.kind << ", len " << hdr.len << "), dropping link." << std::endl;
+            return false;
+        }
+        if (in_buf.size() - ptr < sizeof(hdr) + hdr.len) break;
+        handler(hdr, in_buf.data() + ptr + sizeof(hdr));
+        ptr += sizeof(hdr) + hdr.len;
+    }
+    if (ptr > 0) in_buf.erase(in_buf.begin(), in_buf.begin() + ptr);
+    return alive;
+}
+
+// =========================================
+// 地址解析
+// =========================================
+
+static int make_unix_addr(const std::string& path, sockaddr_un& sa) {
+    memset(&sa, 0, sizeof(sa));
+    sa.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(sa.sun_path)) return -1;
+    strcpy(sa.sun_path, path.c_str());
+    return 0;
+}
+
+static void split_host_port(const std::string& addr, std::string& host, int& port) {
+    size_t colon = addr.rfind(':');
+    if (colon == std::string::npos) {
+        host = "";
+        port = atoi(addr.c_str());
+    } else {
+        host = addr.substr(0, colon);
+        port = atoi(addr.c_str() + colon + 1);
+    }
+}
+
+static void set_nonblock(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+int cluster_listen(const std::string& addr) {
+    int fd;
+    if (addr.compare(0, 5, "unix:") == 0) {
+        sockaddr_un sa;
+        if (make_unix_addr(addr.substr(5), sa) < 0) return -1;
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        unlink(sa.sun_path); // 清理上次异常退出留下的 socket 文件
+        if (bind(fd, (sockaddr*)&sa, sizeof(sa)) < 0) { perror("cluster bind"); close(fd); return -1; }
+    } else {
+        std::string host; int port;
+        split_host_port(addr, host, port);
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        int opt = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+        sockaddr_in sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sin_family = AF_INET;
+        sa.sin_port = htons(port);
+        sa.sin_addr.s_addr = host.empty() ? INADDR_ANY : inet_addr(host.c_str());
+        if (bind(fd, (sockaddr*)&sa, sizeof(sa)) < 0) { perror("cluster bind"); close(fd); return -1; }
+    }
+    if (listen(fd, 16) < 0) { perror("cluster listen"); close(fd); return -1; }
+    set_nonblock(fd);
+    return fd;
+}
+
+// 连接用阻塞方式完成 (启动阶段)，成功后再切换为非阻塞
+int cluster_connect(const std::string& addr) {
+    int fd;
+    if (addr.compare(0, 5, "unix:") == 0) {
+        sockaddr_un sa;
+        if (make_unix_addr(addr.substr(5), sa) < 0) return -1;
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (connect(fd, (sockaddr*)&sa, sizeof(sa)) < 0) { close(fd); return -1; }
+    } else {
+        std::string host; int port;
+        split_host_port(addr, host, port);
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sin_family = AF_INET;
+        sa.sin_port = htons(port);
+        sa.sin_addr.s_addr = inet_addr(host.empty() ? "127.0.0.1" : host.c_str());
+        if (connect(fd, (sockaddr*)&sa, sizeof(sa)) < 0) { close(fd); return -1; }
+    }
+    set_nonblock(fd);
+    return fd;
+}
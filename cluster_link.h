@@ -0,0 +1,87 @@
+#ifndef CLUSTER_LINK_H
+#define CLUSTER_LINK_H
+
+#include <string>
+#include <vector>
+#include <functional>
+
+// ==========================================
+// 网关 <-> 房间服务器 内部协议
+// 每帧 16 字节头 + len 字节负载，同一条连接上按顺序处理。
+// 地址格式: "unix:/tmp/moba_room1.sock" / "10.0.0.2:9001" / "9001" (本机)
+// ==========================================
+
+struct ClusterFrame {
+    int kind;
+    int len;        // 负载字节数
+    int room_id;
+    int client_fd;  // 网关侧的客户端 fd (房间服务器只把它当作玩家标识)
+};
+
+// --- 网关 -> 房间服务器 ---
+#define CMD_CREATE_ROOM    1   // 负载: ClusterCreateRoom
+#define CMD_JOIN_ROOM      2   // 负载: ClusterJoinRoom
+#define CMD_LEAVE_ROOM     3
+#define CMD_START_GAME     4
+#define CMD_ROOM_CONTROL   5   // 负载: RoomControlPacket
+#define CMD_GAME_PACKET    6   // 负载: GamePacket
+#define CMD_WATCH_ROOM     7   // [新增] 负载: int 1=有人观战 / 0=没人了
+
+// --- 房间服务器 -> 网关 ---
+#define EVT_CLIENT_DATA    101 // 负载: 原样转发给 client_fd 的字节
+#define EVT_JOIN_RESULT    102 // 负载: int ok
+#define EVT_ROOM_INFO      103 // 负载: RoomInfo
+#define EVT_ROOM_CLOSED    104
+#define EVT_GAME_OVER      105 // 负载: GameOverPacket
+#define EVT_LOAD           106 // 负载: ClusterLoad
+#define EVT_CLIENT_SNAPSHOT 107 // 负载: 一帧快照，同 EVT_CLIENT_DATA 但允许丢弃 (见 net_io.h NET_SNAPSHOT)
+#define EVT_ROOM_FRAME     108 // [新增] 负载: 被观战房间的一帧 (每帧一份，由网关分发给观众)
+
+#define CLUSTER_MAX_FRAME      (256 * 1024)
+#define CLUSTER_MAX_BACKLOG    (64 * 1024 * 1024) // 对端长期不读，超过后视为断开
+
+struct ClusterCreateRoom {
+    char owner_name[32];
+};
+
+struct ClusterJoinRoom {
+    char name[32];
+    int slot;   // -1: 自动分配
+    int ready;
+};
+
+// 房间服务器每秒上报一次负载，网关据此挑选新房间放在哪台
+struct ClusterLoad {
+    int rooms;
+    int players;
+    int tick_us;    // 最近一秒平均每帧耗时
+};
+
+// --------------------------------------------------------
+// 一条非阻塞内部连接：发送先进缓冲，由主循环 flush 批量写出
+// --------------------------------------------------------
+class ClusterLink {
+public:
+    explicit ClusterLink(int sock);
+    ~ClusterLink();
+
+    int fd() const { return sock; }
+
+    void send(int kind, int room_id, int client_fd, const void* payload, int len);
+    bool flush();   // false: 连接已断或积压过多
+
+    // 读出所有可读数据并逐帧回调；对端关闭或数据非法返回 false
+    bool receive(const std::function<void(const ClusterFrame&, const char*)>& handler);
+
+private:
+    int sock;
+    std::vector<char> in_buf;
+    std::vector<char> out_buf;
+    size_t out_off;
+};
+
+// 监听 / 连接内部地址，返回非阻塞 socket，失败返回 -1
+int cluster_listen(const std::string& addr);
+int cluster_connect(const std::string& addr);
+
+#endif
@@ -0,0 +1,79 @@
+#include "epoll_backend.h"
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+EpollBackend::EpollBackend() {
+    epfd = epoll_create1(0);
+}
+
+EpollBackend::~EpollBackend() {
+    close(epfd);
+}
+
+void EpollBackend::add(int fd, int kind, unsigned events) {
+    epoll_event ev;
+    ev.events = events;
+    ev.data.fd = fd;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+    kinds[fd] = kind;
+}
+
+// 可读时一直 accept 到 EAGAIN，监听 socket 必须是非阻塞的
+void EpollBackend::add_listener(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    add(fd, FD_LISTENER, EPOLLIN);
+}
+void EpollBackend::add_stream(int fd) { add(fd, FD_STREAM, EPOLLIN | EPOLLET); }
+void EpollBackend::add_watch(int fd) { add(fd, FD_WATCH, EPOLLIN); }
+
+void EpollBackend::remove(int fd) {
+    epoll_ctl(epfd, EPOLL_CTL_DEL, fd, NULL);
+    kinds.erase(fd);
+}
+
+void EpollBackend::poll(int timeout_ms) {
+    epoll_event events[EPOLL_MAX_EVENTS];
+    int n = epoll_wait(epfd, events, EPOLL_MAX_EVENTS, timeout_ms);
+
+    for (int i = 0; i < n; i++) {
+        int fd = events[i].data.fd;
+        auto it = kinds.find(fd);
+        if (it == kinds.end()) continue; // 本批次前面的事件里已被移除
+
+        if (it->second == FD_LISTENER) {
+            while (true) {
+                int client_fd = accept4(fd, NULL, NULL, SOCK_NONBLOCK);
+                if (client_fd < 0) break;
+                handlers.on_accept(fd, client_fd);
+            }
+        } else if (it->second == FD_WATCH) {
+            handlers.on_readable(fd);
+        } else {
+            read_stream(fd);
+        }
+    }
+}
+
+// 边沿触发：必须一直读到 EAGAIN，否则剩下的数据要等下一次有新数据才会被读到
+void EpollBackend::read_stream(int fd) {
+    char recv_buf[16384];
+    while (true) {
+        ssize_t n_read = read(fd, recv_buf, sizeof(recv_buf));
+        if (n_read > 0) {
+            handlers.on_data(fd, recv_buf, (int)n_read);
+            if (!kinds.count(fd)) return; // 回调里被移除 (关闭或交给别的线程)，剩下的数据不能再读走
+            continue;
+        }
+        if (n_read < 0 && errno == EINTR) continue;
+        if (n_read < 0 && errno == EAGAIN) return;
+        handlers.on_closed(fd);
+        return;
+    }
+}
+
+ssize_t EpollBackend::send(int fd, const void* buf, size_t len) {
+    return write(fd, buf, len);
+}
@@ -0,0 +1,36 @@
+#ifndef EPOLL_BACKEND_H
+#define EPOLL_BACKEND_H
+
+#include <unordered_map>
+#include "io_backend.h"
+
+#define EPOLL_MAX_EVENTS 1000
+
+// 原来的 epoll 主循环：监听/其它 fd 水平触发，客户端连接边沿触发并一直读到 EAGAIN
+class EpollBackend : public IoBackend {
+public:
+    EpollBackend();
+    ~EpollBackend();
+    const char* name() const override { return "epoll"; }
+
+    void add_listener(int fd) override;
+    void add_stream(int fd) override;
+    void add_watch(int fd) override;
+    void remove(int fd) override;
+
+    void poll(int timeout_ms) override;
+
+    ssize_t send(int fd, const void* buf, size_t len) override;
+    void flush() override {}
+
+private:
+    enum { FD_LISTENER, FD_STREAM, FD_WATCH };
+
+    int epfd;
+    std::unordered_map<int, int> kinds;
+
+    void add(int fd, int kind, unsigned events);
+    void read_stream(int fd);
+};
+
+#endif
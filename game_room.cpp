@@ -1,5 +1,7 @@
 #include "game_room.h"
 #include "map.h"
+#include "thread_pool.h"
+#include "net_io.h"
 #include <cmath>
 #include <cstring>
 #include <algorithm>
@@ -20,6 +22,18 @@ static int dist_sq(int x1, int y1, int x2, int y2) {
     return (x1 - x2) * (x1 - x2) + (y1 - y2) * (y1 - y2);
 }
 
+// [新增] 房间内的随机数不用全局 rand()：帧同步时服务器和客户端副本必须抽到同样的数
+static int lcg_next(unsigned int& state) {
+    state = state * 1103515245u + 12345u;
+    return (int)((state >> 16) & 0x7fff);
+}
+
+#define UNIT_TEMPLATE_SEED 20240601u // 野怪布局用固定种子，所有进程生成同一套
+
+static bool lockstep_enabled = false;
+
+void GameRoom::set_lockstep_enabled(bool on) { lockstep_enabled = on; }
+
 // 英雄属性表
 struct HeroData { int base_hp, range, dmg; };
 static std::map<int, HeroData> HERO_DB = {
@@ -38,9 +52,35 @@ static const std::vector<Pt> PATH_BOT = { {22, 128}, {128, 128},{128, 22} };
 // GameRoom 生命周期管理
 // =========================================
 
-GameRoom::GameRoom(int id, const std::string& owner_name) {
+GameRoom::GameRoom(int id, const std::string& owner_name)
+    : frame_arena(frame_buffer, sizeof(frame_buffer)), info_version(0), state_dirty(false),
+      players(&entity_pool), minions(&entity_pool), towers(&entity_pool), jungle_mobs(&entity_pool),
+      active_effects(&entity_pool), hero_spells(&entity_pool),
+      scripts(&timers, TIMER_SCRIPT) {
+    this->tower_id_counter = TOWER_ID_START;
+    this->jungle_id_counter = JUNGLE_ID_START;
+    this->boss_id_counter = BOSS_ID_START;
+
+    // 地图是确定性的，只生成一次，之后每个房间直接拷贝
+    static int map_template[MAP_SIZE][MAP_SIZE];
+    static bool map_ready = false;
+    if (!map_ready) {
+        MapGenerator::init(map_template);
+        map_ready = true;
+    }
+    memcpy(this->game_map, map_template, sizeof(this->game_map));
+
+    build_unit_templates();
+    reset(id, owner_name);
+}
+
+// [新增] 把房间恢复到刚创建时的状态，供 RoomManager 的房间池复用
+// 地图和开局单位模板保持不变，只清空玩家与对局数据
+void GameRoom::reset(int id, const std::string& owner_name) {
     this->room_id = id;
     this->status = ROOM_STATUS_WAITING;
+    this->info_version++;
+    this->state_dirty = false;
     this->game_start_time = 0;
     this->wave_count = 0;
     this->last_spawn_minute = -1;
@@ -50,12 +90,27 @@ GameRoom::GameRoom(int id, const std::string& owner_name) {
     this->team2_kills = 0;
 
     this->global_id_counter = 1;
-    this->tower_id_counter = TOWER_ID_START;
     this->minion_id_counter = MINION_ID_START;
-    this->jungle_id_counter = JUNGLE_ID_START;
-    this->boss_id_counter = BOSS_ID_START;
-    
-    MapGenerator::init(this->game_map);
+
+    this->lockstep = false;
+    this->replica = false;
+    this->lockstep_tick = 0;
+    this->lockstep_seed = 0;
+    this->rng_state = 1;
+    lockstep_left.clear();
+    lockstep_inputs.clear();
+
+    scripts.clear();
+    timers.reset(0);
+    history.clear();
+    qos.reset();
+    players.clear();
+    minions.clear();
+    towers.clear();
+    jungle_mobs.clear();
+    active_effects.clear();
+    hero_spells.clear();
+    awake_jungle.clear();
 }
 
 GameRoom::~GameRoom() {
@@ -77,6 +132,9 @@ bool GameRoom::add_player(int fd, const std::string& name) {
     p.is_ready = false;
     p.is_playing = false;
     p.hero_id = 0; // 未选
+    p.lockstep_capable = false;
+    p.lockstep_synced = false;
+    p.lockstep_pending = false;
     
     // 自动分配空闲座位
     std::vector<int> taken_slots;
@@ -89,11 +147,21 @@ bool GameRoom::add_player(int fd, const std::string& name) {
     
     p.color = (p.room_slot < 5) ? 1 : 2;
     players[fd] = p;
+    info_version++;
     return true;
 }
 
 void GameRoom::remove_player(int fd) {
-    if (players.count(fd)) players.erase(fd);
+    if (!players.erase(fd)) return;
+    info_version++;
+
+    // [新增] 帧同步：离开也算一条输入，客户端副本在下一帧开头删掉该玩家；他还没执行的输入作废
+    if (lockstep && status == ROOM_STATUS_PLAYING) {
+        lockstep_inputs.erase(std::remove_if(lockstep_inputs.begin(), lockstep_inputs.end(),
+                                             [fd](const LockstepInput& in) { return in.fd == fd; }),
+                              lockstep_inputs.end());
+        lockstep_left.push_back(fd);
+    }
 }
 
 void GameRoom::set_ready(int fd, bool ready) {
@@ -108,6 +176,7 @@ void GameRoom::change_slot(int fd, int target_slot) {
     }
     players[fd].room_slot = target_slot;
     players[fd].color = (target_slot < 5) ? 1 : 2;
+    info_version++; // 房主按最小座位号算，换座可能换房主
 }
 
 // 开始游戏 -> 进入选人阶段 (ROOM_STATUS_PICKING)
@@ -115,24 +184,47 @@ bool GameRoom::start_game(int fd_requester) {
     if (status != ROOM_STATUS_WAITING) return false;
     
     status = ROOM_STATUS_PICKING; // 进入选人
+    info_version++;
     
     // 重置所有人的选择
     for(auto& pair : players) {
         pair.second.hero_id = 0; 
     }
     
-    // 广播状态更新
-    RoomStatePacket pkt = get_room_state_packet();
-    for(auto& pair : players) {
-        write(pair.first, &pkt, sizeof(pkt));
-    }
+    // 广播状态更新 (下一帧统一发送)
+    state_dirty = true;
     return true;
 }
 
 // 真正开始战斗的初始化
 void GameRoom::start_battle() {
     status = ROOM_STATUS_PLAYING; 
-    game_start_time = get_current_ms();
+    info_version++;
+
+    // [新增] 帧同步：时间从第 0 帧算起，随机数用本局种子 (副本的种子来自开局包)
+    // 没有玩家支持时照常按实时模式跑
+    bool any_capable = false;
+    for (auto& pair : players) any_capable = any_capable || pair.second.lockstep_capable;
+    lockstep = replica || (lockstep_enabled && any_capable);
+    lockstep_tick = 0;
+    lockstep_left.clear();
+    lockstep_inputs.clear();
+    if (!replica) lockstep_seed = (unsigned int)get_current_ms() ^ ((unsigned int)room_id * 2654435761u);
+    rng_state = lockstep_seed;
+    game_start_time = clock_ms();
+
+    // 上一局残留的兵线/特效清掉，保证每局开局状态只取决于玩家和种子
+    minions.clear();
+    active_effects.clear();
+    minion_id_counter = MINION_ID_START;
+    wave_count = 0;
+    last_spawn_minute = -1;
+
+    // 时间轮从开局时刻重新计时
+    timers.reset(game_start_time);
+    history.clear();
+    qos.reset();
+    awake_jungle.clear();
     
     // 重置比分
     team1_kills = 0;
@@ -140,6 +232,7 @@ void GameRoom::start_battle() {
 
     init_map_and_units(); 
     hero_spells.clear(); // 清空遗留技能
+    scripts.clear();
     
     for(auto& pair : players) {
         PlayerState& p = pair.second;
@@ -170,6 +263,9 @@ void GameRoom::start_battle() {
         p.hp = p.max_hp;
         p.x = (p.color == 1) ? 22 : 128;
         p.y = (p.color == 1) ? 128 : 22;
+        p.last_move_seq = 0;
+        p.qos_level = 0;
+        p.qos_calm = 0;
         
         // [新增] 初始化朝向与技能CD
         p.dir_x = 0; 
@@ -179,11 +275,15 @@ void GameRoom::start_battle() {
 
         p.last_aggressive_time = 0;
         p.visual_end_time = 0;
+
+        p.lockstep_synced = false;
+        p.lockstep_pending = lockstep && !replica && p.lockstep_capable;
     }
 }
 
 RoomInfo GameRoom::get_room_info() {
     RoomInfo info;
+    memset(&info, 0, sizeof(info)); // 目录按字节比较是否变化，未用到的名字字节也要清零
     info.room_id = room_id;
     info.player_count = players.size();
     info.max_player = 10;
@@ -299,6 +399,10 @@ void GameRoom::handle_buy_item(int fd, int item_id) {
 
     if (p.gold >= cost) {
         p.gold -= cost;
+        // 第一件霸者重装：开始预约被动回血
+        if (item_id == ITEM_REGEN_ARMOR && !has_item(p, ITEM_REGEN_ARMOR)) {
+            timers.schedule(clock_ms(), TIMER_PLAYER_REGEN, fd);
+        }
         p.inventory.push_back(item_id);
         
         // 重新计算血量上限，并增加血量
@@ -319,27 +423,47 @@ void GameRoom::handle_game_packet(int fd, const GamePacket& pkt) {
     if (players.count(fd) == 0) return;
     PlayerState& p = players[fd];
 
+    // [新增] 客户端副本与服务器对不上：本局剩下的时间改发快照给他
+    if (pkt.type == TYPE_LOCKSTEP_READY) {
+        if (p.lockstep_pending) {
+            p.lockstep_pending = false;
+            p.lockstep_synced = true;
+        }
+        return;
+    }
+    if (pkt.type == TYPE_LOCKSTEP_DESYNC) {
+        p.lockstep_pending = false;
+        if (p.lockstep_synced) {
+            p.lockstep_synced = false;
+            std::cout << "[Room " << room_id << "] Player " << p.name << " desynced at tick " << lockstep_tick
+                      << ", falling back to snapshots." << std::endl;
+        }
+        return;
+    }
+
     // === 阶段1：选人 ===
     if (status == ROOM_STATUS_PICKING) { 
         if (pkt.type == TYPE_SELECT) {
             if (HERO_DB.count(pkt.input)) {
                 p.hero_id = pkt.input;
+                p.lockstep_capable = (pkt.extra == LOCKSTEP_CAPABLE);
                 std::cout << "[ROOM] Player " << p.name << " selected " << p.hero_id << std::endl;
 
-                RoomStatePacket state = get_room_state_packet();
-                for(auto& pair : players) write(pair.first, &state, sizeof(state));
+                state_dirty = true;
 
                 bool all_selected = true;
                 for(auto& pair : players) if(pair.second.hero_id == 0) all_selected = false;
                 
                 if(all_selected) {
+                    flush_room_state(); // 最后一次选人结果要先于开局包送达
                     start_battle(); 
                     GamePacket start_pkt; memset(&start_pkt, 0, sizeof(start_pkt));
                     start_pkt.type = TYPE_GAME_START;
                     for(auto& pair : players) {
                         start_pkt.id = pair.second.id;
-                        write(pair.first, &start_pkt, sizeof(start_pkt));
+                        net_send(pair.first, &start_pkt, sizeof(start_pkt));
                     }
+                    if (lockstep) send_lockstep_start();
                 }
             }
         }
@@ -348,101 +472,107 @@ void GameRoom::handle_game_packet(int fd, const GamePacket& pkt) {
 
     // === 阶段2：战斗 ===
     if (status == ROOM_STATUS_PLAYING && p.is_playing) { 
-        long long now = get_current_ms();
+        // [新增] 帧同步：输入攒到下一帧开头统一执行，并原样转发给客户端副本
+        if (lockstep) queue_lockstep_input(fd, pkt);
+        else apply_game_input(fd, pkt);
+    }
+}
 
-        if (pkt.type == TYPE_MOVE) {
-            int dx = pkt.x; int dy = pkt.y;
-            if (dx < -1) dx = -1; if (dx > 1) dx = 1;
-            if (dy < -1) dy = -1; if (dy > 1) dy = 1;
-            
-            // [新增] 更新玩家朝向
-            if (dx != 0 || dy != 0) {
-                p.dir_x = dx;
-                p.dir_y = dy;
-            }
+// 战斗中的一条操作 (实时模式收到就执行；帧同步模式在帧开头按顺序执行)
+void GameRoom::apply_game_input(int fd, const GamePacket& pkt) {
+    if (players.count(fd) == 0) return;
+    PlayerState& p = players[fd];
+    if (!p.is_playing) return;
+    long long now = clock_ms();
 
-            int nx = p.x + dx; int ny = p.y + dy;
-            if (!is_blocked_by_tower(nx, ny)) { 
-                p.x = nx; p.y = ny; 
-            }
-        }
-        else if (pkt.type == TYPE_ATTACK) {
-            handle_attack_logic(fd);
-        }
-        else if (pkt.type == TYPE_SPELL) {
-            // 通用回血
-            p.hp += 100; 
-            if(p.hp > p.max_hp) p.hp = p.max_hp;
+    if (pkt.type == TYPE_MOVE) {
+        int dx = pkt.x; int dy = pkt.y;
+        if (dx < -1) dx = -1; if (dx > 1) dx = 1;
+        if (dy < -1) dy = -1; if (dy > 1) dy = 1;
+        
+        // [新增] 更新玩家朝向
+        if (dx != 0 || dy != 0) {
+            p.dir_x = dx;
+            p.dir_y = dy;
         }
-        else if (pkt.type == TYPE_BUY_ITEM) {
-            handle_buy_item(fd, pkt.input);
+
+        int nx = p.x + dx; int ny = p.y + dy;
+        if (!is_blocked_by_tower(nx, ny)) { 
+            p.x = nx; p.y = ny; 
         }
-        // [新增] 闪现技能 (Key: I)
-        else if (pkt.type == TYPE_SKILL_I) {
-            if (now - p.last_skill_i_time >= CD_FLASH) {
-                int dist = 3;
-                int nx = p.x + p.dir_x * dist;
-                int ny = p.y + p.dir_y * dist;
-
-                // 检查是否撞墙或出界
-                if (is_valid_move(nx, ny)) {
-                    // 成功闪现
-                    p.x = nx; p.y = ny;
-                    std::cout << "[Skill] Player " << p.name << " used Flash." << std::endl;
-                } else {
-                    // 撞墙，闪现失败，位置不变，但CD照扣 (模拟操作失误)
-                    std::cout << "[Skill] Player " << p.name << " Flash hit wall!" << std::endl;
-                }
-                p.last_skill_i_time = now;
+        // [新增] 客户端给移动编了号 (extra)，挡住没走成也算已处理
+        if (pkt.extra > p.last_move_seq) p.last_move_seq = pkt.extra;
+    }
+    else if (pkt.type == TYPE_ATTACK) {
+        handle_attack_logic(fd, pkt.extra); // [修改] extra 为客户端画面对应的服务器时间 (开局以来毫秒)
+    }
+    else if (pkt.type == TYPE_SPELL) {
+        // 通用回血
+        p.hp += 100; 
+        if(p.hp > p.max_hp) p.hp = p.max_hp;
+    }
+    else if (pkt.type == TYPE_BUY_ITEM) {
+        handle_buy_item(fd, pkt.input);
+    }
+    // [新增] 闪现技能 (Key: I)
+    else if (pkt.type == TYPE_SKILL_I) {
+        if (now - p.last_skill_i_time >= CD_FLASH) {
+            int dist = 3;
+            int nx = p.x + p.dir_x * dist;
+            int ny = p.y + p.dir_y * dist;
+
+            // 检查是否撞墙或出界
+            if (is_valid_move(nx, ny)) {
+                // 成功闪现
+                p.x = nx; p.y = ny;
+                std::cout << "[Skill] Player " << p.name << " used Flash." << std::endl;
+            } else {
+                // 撞墙，闪现失败，位置不变，但CD照扣 (模拟操作失误)
+                std::cout << "[Skill] Player " << p.name << " Flash hit wall!" << std::endl;
             }
+            p.last_skill_i_time = now;
         }
-        // [新增] 连锁水柱技能 (Key: U)
-        else if (pkt.type == TYPE_SKILL_U) {
-            // 这里为了演示，所有英雄都能放，如果你想限制法师：if (p.hero_id == HERO_MAGE) ...
-            if (now - p.last_skill_u_time >= CD_MAGE_ULT) {
-                // 生成第一段技能
-                SpellObj s;
-                s.id = global_id_counter++;
-                s.owner_id = p.id;
-                s.stage = 1;
-                // 向前2格
-                s.x = p.x + p.dir_x * 2;
-                s.y = p.y + p.dir_y * 2;
-                s.dir_x = p.dir_x; s.dir_y = p.dir_y; // 记录方向传递给下一段
-                s.radius = 2;
-                s.dmg_mult = 1.0f;
-                s.create_time = now;
-                s.active_time = now + 1000;      // 1秒后爆发伤害
-                s.next_stage_time = now + 500;   // 0.5秒后生成下一段
-                s.end_time = now + 1200;         // 稍微留一点视觉时间
-                s.next_spawned = false;
-                s.dmg_dealt = false;
-                
-                hero_spells.push_back(s);
-                p.last_skill_u_time = now;
-                std::cout << "[Skill] Player " << p.name << " used Chain Water (Stage 1)." << std::endl;
-            }
+    }
+    // [新增] 连锁水柱技能 (Key: U)
+    else if (pkt.type == TYPE_SKILL_U) {
+        // 这里为了演示，所有英雄都能放，如果你想限制法师：if (p.hero_id == HERO_MAGE) ...
+        if (now - p.last_skill_u_time >= CD_MAGE_ULT) {
+            // 生成第一段技能 (向前2格)，后续阶段由脚本自己推进
+            scripts.start(mage_chain_stage(p.id, 1, p.x + p.dir_x * 2, p.y + p.dir_y * 2, p.dir_x, p.dir_y), now);
+            p.last_skill_u_time = now;
+            std::cout << "[Skill] Player " << p.name << " used Chain Water (Stage 1)." << std::endl;
         }
     }
 }
 
+// 一帧内的多次座位/准备/选人变化合并成一个 RoomStatePacket
+// 对局中不发：客户端在战斗画面不认房间状态包，有人离开由快照 (实体消失) / 帧同步的离开输入告知
+void GameRoom::flush_room_state() {
+    if (!state_dirty) return;
+    state_dirty = false;
+    if (status == ROOM_STATUS_PLAYING) return;
+
+    RoomStatePacket state = get_room_state_packet();
+    for(auto& pair : players) net_send(pair.first, &state, sizeof(state));
+}
+
 void GameRoom::update_logic() {
+    flush_room_state();
     if (status != ROOM_STATUS_PLAYING) return; 
+
+    // [新增] 帧同步：先推进帧号，再按顺序执行上一帧间隔里收到的离开/操作
+    if (lockstep) {
+        lockstep_tick++;
+        apply_lockstep_inputs();
+    }
     
-    long long now = get_current_ms();
+    long long now = clock_ms();
+
+    // 上一帧的临时数据全部作废，bump 指针回到缓冲区开头
+    frame_arena.release();
     
-    // 物品被动逻辑 (霸者之装回血)
-    for (auto& pair : players) {
-        PlayerState& p = pair.second;
-        if (!p.is_playing) continue;
-        if (has_item(p, ITEM_REGEN_ARMOR)) {
-            if (now - p.last_regen_passive_time >= 5000) {
-                p.hp += 300;
-                if (p.hp > p.max_hp) p.hp = p.max_hp;
-                p.last_regen_passive_time = now;
-            }
-        }
-    }
+    // 推进时间轮：回血/特效过期直接处理，到期的塔、野怪、技能进入本帧批次
+    collect_due_timers(now);
 
     int current_sec = (now - game_start_time) / 1000;
     if (current_sec >= 30 && (current_sec - 30) % 60 == 0) {
@@ -452,14 +582,26 @@ void GameRoom::update_logic() {
         }
     }
 
+    // 感知阶段 (只读，可并行) -> 行动阶段 (串行应用结果)
+    sense_targets(now);
     update_towers(now);
     update_minions(now);
     update_jungle(now);
     
-    // [新增] 更新技能逻辑
-    update_spells(now);
+    // [新增] 恢复到期的技能脚本
+    update_scripts(now);
+
+    record_history(now);
 
-    broadcast_world(now);
+    // [新增] 帧同步且所有人都在本地模拟、也没人观战时，不必编码快照
+    if (snapshots_needed()) broadcast_world(now);
+    else for (auto& pair : players) pair.second.current_effect = EFFECT_NONE;
+
+    if (lockstep) {
+        if (!replica) send_lockstep_tick();
+        lockstep_left.clear();
+        lockstep_inputs.clear();
+    }
 
     // 检查基地是否被推（游戏结束判定）
     bool team1_base_alive = false;
@@ -498,158 +640,328 @@ void GameRoom::update_logic() {
 
         // 广播给所有人
         for(auto& pair : players) {
-            write(pair.first, &pkt, sizeof(pkt));
+            net_send(pair.first, &pkt, sizeof(pkt));
         }
+        if (on_frame) on_frame(room_id, (const char*)&pkt, sizeof(pkt));
+
+        if (on_game_over) on_game_over(pkt);
 
         // 结束游戏状态，重置为等待
         status = ROOM_STATUS_WAITING; 
+        info_version++;
         std::cout << "[Room " << room_id << "] GAME OVER. Winner: Team " << winner << std::endl;
     }
 }
 
-// [新增] 技能逻辑更新：处理生成下一段、伤害判定、移除
-void GameRoom::update_spells(long long now) {
-    std::vector<SpellObj> next_spells; // 用于暂存新生成的技能段
-    std::vector<int> remove_indices;
+// [新增] 恢复本帧到期的技能脚本
+void GameRoom::update_scripts(long long now) {
+    for (const auto& ev : due_scripts) {
+        scripts.resume(ev.id, ev.due, now);
+    }
+}
 
-    for (size_t i = 0; i < hero_spells.size(); i++) {
-        SpellObj& s = hero_spells[i];
-        
-        // 1. 生成下一段的逻辑
-        if (s.next_stage_time != -1 && now >= s.next_stage_time && !s.next_spawned) {
-            SpellObj next;
-            next.id = global_id_counter++;
-            next.owner_id = s.owner_id;
-            next.dir_x = s.dir_x; next.dir_y = s.dir_y;
-            
-            if (s.stage == 1) {
-                // 阶段1 -> 阶段2: 往前5格，半径4
-                next.stage = 2;
-                next.x = s.x + s.dir_x * 5;
-                next.y = s.y + s.dir_y * 5;
-                next.radius = 4;
-                next.dmg_mult = 1.0f;
-                next.create_time = now;
-                next.active_time = now + 1000; // 同样是1秒预警
-                next.next_stage_time = now + 500;
-                next.end_time = now + 1200;
-                next.next_spawned = false;
-                next.dmg_dealt = false;
-                next_spells.push_back(next);
-            } 
-            else if (s.stage == 2) {
-                // 阶段2 -> 阶段3: 往前6格，半径6，持续伤害
-                next.stage = 3;
-                next.x = s.x + s.dir_x * 6;
-                next.y = s.y + s.dir_y * 6;
-                next.radius = 6;
-                next.dmg_mult = 2.0f;
-                next.create_time = now;
-                next.active_time = now; // 立即开始 (或者加一点延迟)
-                next.next_stage_time = -1; // 没有下一段了
-                next.end_time = now + 3000; // 持续3秒
-                next.last_dot_time = 0;
-                next.next_spawned = false;
-                next_spells.push_back(next);
-            }
-            s.next_spawned = true;
+// =========================================
+// 技能脚本 (协程)
+// =========================================
+
+// 法师连锁水柱的一段：预警 1 秒后爆发，0.5 秒时在前方生成下一段；
+// 第三段为持续 3 秒、每 0.6 秒一跳的大范围伤害。
+AbilityScript GameRoom::mage_chain_stage(int owner_id, int stage, int x, int y, int dir_x, int dir_y) {
+    long long start = scripts.now();
+
+    SpellObj s;
+    s.id = global_id_counter++;
+    s.owner_id = owner_id;
+    s.stage = stage;
+    s.x = x; s.y = y;
+
+    if (stage < 3) {
+        s.radius = (stage == 1) ? 2 : 4;
+        s.active_time = start + 1000;   // 1秒后爆发伤害
+        s.end_time = start + 1200;      // 稍微留一点视觉时间
+        hero_spells.push_back(s);
+
+        co_await scripts.wait_until(start + 500);
+        // 阶段1 -> 阶段2: 往前5格，半径4；阶段2 -> 阶段3: 往前6格，半径6
+        int step = (stage == 1) ? 5 : 6;
+        scripts.start(mage_chain_stage(owner_id, stage + 1, x + dir_x * step, y + dir_y * step, dir_x, dir_y), scripts.now());
+
+        co_await scripts.wait_until(s.active_time);
+        deal_spell_damage(owner_id, x, y, s.radius, 1.0f);
+
+        co_await scripts.wait_until(s.end_time);
+    } else {
+        s.radius = 6;
+        s.active_time = start;
+        s.end_time = start + 3000;      // 持续3秒
+        hero_spells.push_back(s);
+
+        deal_spell_damage(owner_id, x, y, s.radius, 2.0f);
+        for (long long t = start + 600; t < s.end_time; t += 600) {
+            co_await scripts.wait_until(t);
+            deal_spell_damage(owner_id, x, y, s.radius, 2.0f);
         }
+        co_await scripts.wait_until(s.end_time);
+    }
+    remove_spell(s.id);
+}
 
-        // 2. 伤害判定逻辑
-        bool should_deal_dmg = false;
+// 主宰：在范围内每个英雄脚下预警，延迟后喷发
+AbilityScript GameRoom::overlord_skill(int mob_id, int seq) {
+    long long start = scripts.now();
+    JungleObj* m = find_casting_boss(mob_id, seq, 1);
+    if (!m) co_return;
+
+    // 脚本跨帧存活，不能用 frame_arena
+    struct Pt { int x, y; };
+    std::pmr::vector<Pt> targets(&entity_pool);
+    for (auto& pl : players) {
+        if (pl.second.is_playing && dist_sq(m->x, m->y, pl.second.x, pl.second.y) <= OVERLORD_RANGE * OVERLORD_RANGE) {
+            targets.push_back({pl.second.x, pl.second.y});
+            SkillEffectObj eff = {pl.second.x, pl.second.y, VFX_OVERLORD_WARN, start, start + OVERLORD_SKILL_DELAY, OVERLORD_SKILL_RADIUS, mob_id};
+            active_effects.push_back(eff);
+            timers.schedule(eff.end_time, TIMER_EFFECT, mob_id);
+        }
+    }
+
+    long long now = co_await scripts.wait_until(start + OVERLORD_SKILL_DELAY);
+    m = find_casting_boss(mob_id, seq, 1);
+    if (!m) co_return; // 已脱战或被击杀，技能取消
+
+    for (auto& target_pos : targets) {
+        SkillEffectObj eff = {target_pos.x, target_pos.y, VFX_OVERLORD_DMG, now, now + 500, OVERLORD_SKILL_RADIUS, mob_id};
+        active_effects.push_back(eff);
+        timers.schedule(eff.end_time, TIMER_EFFECT, mob_id);
         
-        if (s.stage == 1 || s.stage == 2) {
-            // 爆发伤害
-            if (now >= s.active_time && !s.dmg_dealt) {
-                should_deal_dmg = true;
-                s.dmg_dealt = true;
-            }
-        } else if (s.stage == 3) {
-            // 持续伤害 (每0.6秒)
-            if (now >= s.active_time && now < s.end_time) {
-                if (now - s.last_dot_time >= 600) {
-                    should_deal_dmg = true;
-                    s.last_dot_time = now;
+        for (auto& p : players) {
+            if (!p.second.is_playing) continue;
+            if (dist_sq(p.second.x, p.second.y, target_pos.x, target_pos.y) <= OVERLORD_SKILL_RADIUS * OVERLORD_SKILL_RADIUS) {
+                int def = get_total_def(p.second);
+                int dmg = (m->dmg * 3) - def;
+                if(dmg < 1) dmg = 1;
+                
+                p.second.hp -= dmg;
+                p.second.current_effect = EFFECT_HIT;
+                if(p.second.hp <= 0) { 
+                    if (p.second.color == 1) team2_kills++; 
+                    else team1_kills++;
+
+                    // 记录死亡
+                    p.second.deaths++;
+
+                    p.second.hp = p.second.max_hp; 
+                    p.second.x = (p.second.color == 1)?22:128; p.second.y = (p.second.color == 1)?128:22;
+                    m->target_id = 0; m->attack_counter = 0;
                 }
             }
         }
+    }
+    m->boss_state = 0; 
+    m->last_attack_time = now; 
+}
 
-        if (should_deal_dmg) {
-            // 获取施法者攻击力
-            PlayerState* owner = get_player_by_id(s.owner_id);
-            int base_atk = 0;
-            int owner_team = 0;
-            if (owner) {
-                base_atk = get_total_atk(*owner);
-                owner_team = owner->color;
-            } else {
-                base_atk = 500; // 默认值，防崩溃
-            }
+// 暴君：持续冲击波，每 0.5 秒对周围英雄造成伤害并击退
+AbilityScript GameRoom::tyrant_skill(int mob_id, int seq) {
+    long long start = scripts.now();
 
-            int dmg = (int)(base_atk * s.dmg_mult);
-            int r_sq = s.radius * s.radius;
-
-            // 对英雄造成伤害
-            for (auto& p : players) {
-                if (!p.second.is_playing || p.second.color == owner_team) continue;
-                if (dist_sq(s.x, s.y, p.second.x, p.second.y) <= r_sq) {
-                    int def = get_total_def(p.second);
-                    int final = dmg - def; 
-                    if (final < 1) final = 1;
-                    
-                    p.second.hp -= final;
-                    p.second.current_effect = EFFECT_HIT;
-                    
-                    if (p.second.hp <= 0) {
-                        p.second.deaths++;
-                        if (owner) owner->kills++;
-                        if (p.second.color == 1) team2_kills++; else team1_kills++;
-                        if (owner) add_gold(owner->id, 300);
-                        p.second.hp = p.second.max_hp;
-                        p.second.x = (p.second.color == 1) ? 22 : 128; p.second.y = (p.second.color == 1) ? 128 : 22;
-                    }
-                }
-            }
-            // 对小兵造成伤害
-            for (auto& m : minions) {
-                if (m.second.team == owner_team) continue;
-                if (dist_sq(s.x, s.y, (int)m.second.x, (int)m.second.y) <= r_sq) {
-                    m.second.hp -= dmg;
-                    if (m.second.hp <= 0 && owner) add_gold(owner->id, 80); 
+    for (long long t = start + 500; t < start + TYRANT_SKILL_DUR; t += 500) {
+        co_await scripts.wait_until(t);
+        JungleObj* m = find_casting_boss(mob_id, seq, 2);
+        if (!m) co_return;
+
+        for (auto& p : players) {
+            if (!p.second.is_playing) continue;
+            int d = dist_sq(m->x, m->y, p.second.x, p.second.y);
+            if (d <= TYRANT_RANGE * TYRANT_RANGE) {
+                int def = get_total_def(p.second);
+                int dmg = (m->dmg * 2) - def;
+                if(dmg < 1) dmg = 1;
+                
+                p.second.hp -= dmg;
+                p.second.current_effect = EFFECT_HIT;
+                int push_dx = 0, push_dy = 0;
+                if (p.second.x > m->x) push_dx = 1; else if (p.second.x < m->x) push_dx = -1;
+                if (p.second.y > m->y) push_dy = 1; else if (p.second.y < m->y) push_dy = -1;
+                int nx = p.second.x + push_dx;
+                int ny = p.second.y + push_dy;
+                if (!is_blocked_by_tower(nx, ny)) { p.second.x = nx; p.second.y = ny; }
+                
+                if(p.second.hp <= 0) {
+                    if (p.second.color == 1) team2_kills++; 
+                    else team1_kills++;
+
+                    // 记录死亡
+                    p.second.deaths++;
+
+                    p.second.hp = p.second.max_hp; 
+                    p.second.x = (p.second.color == 1)?22:128; p.second.y = (p.second.color == 1)?128:22;
+                    m->target_id = 0; m->attack_counter = 0; m->boss_state = 0;
                 }
             }
-            // 对野怪
-            for (auto& j : jungle_mobs) {
-                if (dist_sq(s.x, s.y, j.second.x, j.second.y) <= r_sq) {
-                    j.second.hp -= dmg;
-                    if (j.second.hp <= 0 && owner) add_gold(owner->id, 150);
-                }
+        }
+        if (m->boss_state != 2) co_return;
+    }
+
+    long long now = co_await scripts.wait_until(start + TYRANT_SKILL_DUR);
+    JungleObj* m = find_casting_boss(mob_id, seq, 2);
+    if (!m) co_return;
+    m->boss_state = 0;
+    m->last_attack_time = now;
+}
+
+// 找到仍在施放第 seq 次技能、且处于指定阶段的 Boss
+JungleObj* GameRoom::find_casting_boss(int mob_id, int seq, int state) {
+    auto it = jungle_mobs.find(mob_id);
+    if (it == jungle_mobs.end()) return nullptr;
+    JungleObj& m = it->second;
+    if (m.hp <= 0 || m.target_id == 0 || m.skill_seq != seq || m.boss_state != state) return nullptr;
+    return &m;
+}
+
+// 技能范围伤害结算 (敌方英雄、小兵、野怪)
+void GameRoom::deal_spell_damage(int owner_id, int x, int y, int radius, float dmg_mult) {
+    // 获取施法者攻击力
+    PlayerState* owner = get_player_by_id(owner_id);
+    int base_atk = 0;
+    int owner_team = 0;
+    if (owner) {
+        base_atk = get_total_atk(*owner);
+        owner_team = owner->color;
+    } else {
+        base_atk = 500; // 默认值，防崩溃
+    }
+
+    int dmg = (int)(base_atk * dmg_mult);
+    int r_sq = radius * radius;
+
+    // 对英雄造成伤害
+    for (auto& p : players) {
+        if (!p.second.is_playing || p.second.color == owner_team) continue;
+        if (dist_sq(x, y, p.second.x, p.second.y) <= r_sq) {
+            int def = get_total_def(p.second);
+            int final = dmg - def; 
+            if (final < 1) final = 1;
+            
+            p.second.hp -= final;
+            p.second.current_effect = EFFECT_HIT;
+            
+            if (p.second.hp <= 0) {
+                p.second.deaths++;
+                if (owner) owner->kills++;
+                if (p.second.color == 1) team2_kills++; else team1_kills++;
+                if (owner) add_gold(owner->id, 300);
+                p.second.hp = p.second.max_hp;
+                p.second.x = (p.second.color == 1) ? 22 : 128; p.second.y = (p.second.color == 1) ? 128 : 22;
             }
         }
+    }
+    // 对小兵造成伤害
+    for (auto& m : minions) {
+        if (m.second.team == owner_team) continue;
+        if (dist_sq(x, y, (int)m.second.x, (int)m.second.y) <= r_sq) {
+            m.second.hp -= dmg;
+            if (m.second.hp <= 0 && owner) add_gold(owner->id, 80); 
+        }
+    }
+    // 对野怪
+    for (auto& j : jungle_mobs) {
+        if (dist_sq(x, y, j.second.x, j.second.y) <= r_sq) {
+            j.second.hp -= dmg;
+            wake_jungle(j.second);
+            if (j.second.hp <= 0 && owner) add_gold(owner->id, 150);
+        }
+    }
+}
 
-        // 3. 过期移除
-        if (now >= s.end_time) {
-            remove_indices.push_back(i);
+void GameRoom::remove_spell(int spell_id) {
+    for (size_t i = 0; i < hero_spells.size(); i++) {
+        if (hero_spells[i].id == spell_id) {
+            hero_spells[i] = hero_spells.back();
+            hero_spells.pop_back();
+            return;
         }
     }
+}
 
-    // 处理新增和移除
-    // 先加新的
-    for (auto& ns : next_spells) hero_spells.push_back(ns);
-    
-    // 再移除旧的 (倒序移除以防索引错乱)
-    for (int k = remove_indices.size() - 1; k >= 0; k--) {
-        hero_spells.erase(hero_spells.begin() + remove_indices[k]);
+// =========================================
+// 时间轮调度
+// =========================================
+
+void GameRoom::collect_due_timers(long long now) {
+    due_events.clear();
+    timers.advance(now, due_events);
+
+    sense_towers.clear();
+    sense_jungle.clear();
+    due_scripts.clear();
+
+    // 战斗中的野怪每帧都要处理
+    for (int id : awake_jungle) {
+        auto it = jungle_mobs.find(id);
+        if (it != jungle_mobs.end()) sense_jungle.push_back(&it->second);
     }
+
+    // 事件与实体记录的唤醒时间对不上，说明已被重新预约，直接丢弃
+    for (const auto& ev : due_events) {
+        if (ev.kind == TIMER_TOWER) {
+            auto it = towers.find(ev.id);
+            if (it == towers.end() || it->second.wake_time != ev.due) continue;
+            it->second.wake_time = -1;
+            sense_towers.push_back(&it->second);
+        }
+        else if (ev.kind == TIMER_JUNGLE) {
+            auto it = jungle_mobs.find(ev.id);
+            if (it == jungle_mobs.end() || it->second.awake || it->second.wake_time != ev.due) continue;
+            it->second.wake_time = -1;
+            sense_jungle.push_back(&it->second);
+        }
+        else if (ev.kind == TIMER_SCRIPT) {
+            due_scripts.push_back(ev);
+        }
+        else if (ev.kind == TIMER_PLAYER_REGEN) {
+            // 霸者重装回血 (id 为玩家 fd)
+            auto it = players.find(ev.id);
+            if (it == players.end()) continue;
+            PlayerState& p = it->second;
+            if (!has_item(p, ITEM_REGEN_ARMOR)) continue; // 装备没了才结束；再买时重新预约
+            // 暂时不在场上 (还没开局等) 只跳过这一次回血，继续预约，否则回血就此断掉
+            if (p.is_playing) {
+                p.hp += 300;
+                if (p.hp > p.max_hp) p.hp = p.max_hp;
+                p.last_regen_passive_time = now;
+            }
+            timers.schedule(now + 5000, TIMER_PLAYER_REGEN, ev.id);
+        }
+        else if (ev.kind == TIMER_EFFECT) {
+            // 特效顺序无关：过期的与末尾交换后弹出，不搬移中间元素
+            for (size_t i = 0; i < active_effects.size(); ) {
+                if (now >= active_effects[i].end_time) {
+                    active_effects[i] = active_effects.back();
+                    active_effects.pop_back();
+                } else {
+                    i++;
+                }
+            }
+        }
+    }
+}
+
+// 野怪被攻击时唤醒，转为逐帧处理
+void GameRoom::wake_jungle(JungleObj& m) {
+    if (m.awake) return;
+    m.awake = true;
+    m.wake_time = -1;
+    awake_jungle.push_back(m.id);
 }
 
 // =========================================
 // 私有辅助逻辑
 // =========================================
 
-void GameRoom::init_map_and_units() {
+// [新增] 生成开局的塔与野怪模板 (只在房间构造时跑一次，之后每局直接拷贝)
+void GameRoom::build_unit_templates() {
     // 1. Init Towers
-    towers.clear();
+    tower_template.clear();
     for(int y=0; y<MAP_SIZE; y++) {
         for(int x=0; x<MAP_SIZE; x++) {
             int t = game_map[y][x];
@@ -671,13 +983,14 @@ void GameRoom::init_map_and_units() {
                     }
                 }
                 tower.hp = tower.max_hp;
-                towers[tower.id] = tower;
+                tower.wake_time = -1;
+                tower_template.push_back(tower);
             }
         }
     }
 
     // 2. Init Jungle
-    jungle_mobs.clear();
+    jungle_template.clear();
     
     // Bosses
     JungleObj overlord;
@@ -686,8 +999,9 @@ void GameRoom::init_map_and_units() {
     overlord.hp = OVERLORD_HP; overlord.max_hp = OVERLORD_HP;
     overlord.dmg = OVERLORD_DMG; overlord.range = OVERLORD_RANGE;
     overlord.target_id = 0; overlord.last_hit_by_time = 0; overlord.last_attack_time = 0; overlord.last_regen_time = 0;
-    overlord.attack_counter = 0; overlord.boss_state = 0; 
-    jungle_mobs[overlord.id] = overlord;
+    overlord.attack_counter = 0; overlord.boss_state = 0; overlord.skill_seq = 0;
+    overlord.awake = false; overlord.wake_time = -1;
+    jungle_template.push_back(overlord);
 
     JungleObj tyrant;
     tyrant.id = boss_id_counter++; tyrant.type = BOSS_TYPE_TYRANT;
@@ -695,10 +1009,12 @@ void GameRoom::init_map_and_units() {
     tyrant.hp = TYRANT_HP; tyrant.max_hp = TYRANT_HP;
     tyrant.dmg = TYRANT_DMG; tyrant.range = TYRANT_RANGE;
     tyrant.target_id = 0; tyrant.last_hit_by_time = 0; tyrant.last_attack_time = 0; tyrant.last_regen_time = 0;
-    tyrant.attack_counter = 0; tyrant.boss_state = 0; 
-    jungle_mobs[tyrant.id] = tyrant;
+    tyrant.attack_counter = 0; tyrant.boss_state = 0; tyrant.skill_seq = 0;
+    tyrant.awake = false; tyrant.wake_time = -1;
+    jungle_template.push_back(tyrant);
 
     // Normal Mobs
+    unsigned int seed = UNIT_TEMPLATE_SEED;
     struct Zone { int x, y, size; int buff_type; };
     std::vector<Zone> zones = {
         {56, 96, 26, MONSTER_TYPE_BLUE}, {68, 28, 26, MONSTER_TYPE_RED}, 
@@ -715,18 +1031,19 @@ void GameRoom::init_map_and_units() {
         buff.hp = MONSTER_BUFF_HP; buff.max_hp = MONSTER_BUFF_HP;
         buff.dmg = MONSTER_BUFF_DMG; buff.range = MONSTER_BUFF_RANGE;
         buff.target_id = 0; buff.last_hit_by_time = 0; buff.last_attack_time = 0; buff.last_regen_time = 0;
-        buff.boss_state = 0;
-        jungle_mobs[buff.id] = buff;
+        buff.boss_state = 0; buff.skill_seq = 0;
+        buff.awake = false; buff.wake_time = -1;
+        jungle_template.push_back(buff);
 
         int std_count = 0, attempts = 0;
         while(std_count < 3 && attempts < 50) { 
             attempts++;
-            int rx = z.x + 2 + rand() % (z.size - 4);
-            int ry = z.y + 2 + rand() % (z.size - 4);
+            int rx = z.x + 2 + lcg_next(seed) % (z.size - 4);
+            int ry = z.y + 2 + lcg_next(seed) % (z.size - 4);
             if (game_map[ry][rx] != TILE_EMPTY) continue;
             if (dist_sq(rx, ry, cx, cy) < 25) continue;
             bool overlap = false;
-            for(const auto& m : jungle_mobs) { if (dist_sq(rx, ry, m.second.x, m.second.y) < 9) { overlap = true; break; } }
+            for(const auto& m : jungle_template) { if (dist_sq(rx, ry, m.x, m.y) < 9) { overlap = true; break; } }
             if(overlap) continue;
 
             JungleObj mob;
@@ -735,11 +1052,31 @@ void GameRoom::init_map_and_units() {
             mob.hp = MONSTER_STD_HP; mob.max_hp = MONSTER_STD_HP;
             mob.dmg = MONSTER_STD_DMG; mob.range = MONSTER_STD_RANGE;
             mob.target_id = 0; mob.last_hit_by_time = 0; mob.last_attack_time = 0; mob.last_regen_time = 0;
-            mob.boss_state = 0;
-            jungle_mobs[mob.id] = mob;
+            mob.boss_state = 0; mob.skill_seq = 0;
+            mob.awake = false; mob.wake_time = -1;
+            jungle_template.push_back(mob);
             std_count++;
         }
     }
+
+    // Boss 与普通野怪 ID 分属不同区段，按 ID 排好序，开局时可以顺序插入
+    std::sort(jungle_template.begin(), jungle_template.end(),
+              [](const JungleObj& a, const JungleObj& b) { return a.id < b.id; });
+}
+
+// 开局：从模板恢复塔与野怪 (模板按 ID 递增生成，直接在尾部插入)
+void GameRoom::init_map_and_units() {
+    towers.clear();
+    for (const TowerObj& t : tower_template) {
+        TowerObj& tower = towers.emplace_hint(towers.end(), t.id, t)->second;
+        tower.wake_time = game_start_time;
+        timers.schedule(tower.wake_time, TIMER_TOWER, tower.id);
+    }
+
+    jungle_mobs.clear();
+    for (const JungleObj& m : jungle_template) {
+        jungle_mobs.emplace_hint(jungle_mobs.end(), m.id, m);
+    }
 }
 
 void GameRoom::spawn_wave() {
@@ -757,8 +1094,8 @@ void GameRoom::spawn_wave() {
             m.hp = (m.type == 1) ? melee_hp : ranged_hp; m.max_hp = m.hp;
             m.dmg = (m.type == 1) ? melee_dmg : ranged_dmg;
             m.range = (m.type == 1) ? MELEE_RANGE : RANGED_RANGE;
-            m.x = 22 + rand()%2; m.y = 128 + rand()%2; 
-            m.wp_idx = 0; m.state = 0; m.last_attack_time = 0; m.visual_end_time = 0;
+            m.x = 22 + next_random()%2; m.y = 128 + next_random()%2; 
+            m.wp_idx = 0; m.state = 0; m.target_id = 0; m.last_attack_time = 0; m.visual_end_time = 0;
             minions[m.id] = m;
         }
         // Team 2
@@ -768,61 +1105,147 @@ void GameRoom::spawn_wave() {
             m.hp = (m.type == 1) ? melee_hp : ranged_hp; m.max_hp = m.hp;
             m.dmg = (m.type == 1) ? melee_dmg : ranged_dmg;
             m.range = (m.type == 1) ? MELEE_RANGE : RANGED_RANGE;
-            m.x = 128 + rand()%2; m.y = 22 + rand()%2; 
+            m.x = 128 + next_random()%2; m.y = 22 + next_random()%2; 
             const std::vector<Pt>* path = (lane == 0) ? &PATH_TOP : ((lane == 1) ? &PATH_MID : &PATH_BOT);
-            m.wp_idx = path->size() - 1; m.state = 0; m.last_attack_time = 0; m.visual_end_time = 0;
+            m.wp_idx = path->size() - 1; m.state = 0; m.target_id = 0; m.last_attack_time = 0; m.visual_end_time = 0;
             minions[m.id] = m;
         }
     }
 }
 
-void GameRoom::update_towers(long long now) {
+// =========================================
+// 感知阶段：只读索敌
+// =========================================
+
+// 整个阶段只读 players/minions/towers/jungle_mobs，结果写入各自下标，
+// 不同实体之间没有写冲突，因此可以安全地分发到多个线程。
+void GameRoom::sense_targets(long long now) {
+    // 塔和野怪只包含本帧被时间轮唤醒 (或正在战斗) 的，小兵一直在移动所以全量
+    sense_minions.clear();
+    for (auto& pair : minions) sense_minions.push_back(&pair.second);
+
+    int nt = sense_towers.size();
+    int nm = sense_minions.size();
+    int nj = sense_jungle.size();
+    tower_targets.assign(nt, 0);
+    minion_targets.assign(nm, 0);
+    jungle_targets.assign(nj, nullptr);
+
+    auto sense_range = [&](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            if (i < nt) {
+                TowerObj& t = *sense_towers[i];
+                if (t.hp > 0) tower_targets[i] = sense_tower_target(t, now);
+            } else if (i < nt + nm) {
+                MinionObj& m = *sense_minions[i - nt];
+                if (m.hp > 0 && m.state == 0) minion_targets[i - nt] = sense_minion_target(m);
+            } else {
+                JungleObj& m = *sense_jungle[i - nt - nm];
+                if (m.hp > 0 && m.target_id != 0) jungle_targets[i - nt - nm] = sense_jungle_target(m);
+            }
+        }
+    };
+
+    int total = nt + nm + nj;
+    if (total >= SENSE_PARALLEL_THRESHOLD) {
+        WorkStealingPool::instance().parallel_for(total, SENSE_PARALLEL_GRAIN, sense_range);
+    } else {
+        sense_range(0, total);
+    }
+}
+
+int GameRoom::sense_tower_target(const TowerObj& t, long long now) {
     int tower_range_sq = TOWER_ATK_RANGE * TOWER_ATK_RANGE;
-    
-    for (auto& pair : towers) {
-        TowerObj& t = pair.second;
-        if (t.hp <= 0) continue;
-        
-        int best_target = 0;
-        int min_dist = 99999;
-        
-        // 1. 仇恨机制
+    int best_target = 0;
+    int min_dist = 99999;
+
+    // 1. 仇恨机制
+    for (auto& p : players) {
+        if (!p.second.is_playing || p.second.color == t.team) continue;
+        int d = dist_sq(t.x, t.y, p.second.x, p.second.y);
+        if (d > tower_range_sq) continue;
+        if (now - p.second.last_aggressive_time < 2000) {
+            return p.second.id;
+        }
+    }
+    // 2. 锁定与索敌
+    if (t.target_id != 0) {
+        bool valid = false;
+        int tx = 0, ty = 0;
+        PlayerState* p = get_player_by_id(t.target_id);
+        if (p) { tx = p->x; ty = p->y; valid = true; }
+        else {
+            auto it = minions.find(t.target_id);
+            if (it != minions.end() && it->second.hp > 0) {
+                tx = (int)it->second.x; ty = (int)it->second.y; valid = true;
+            }
+        }
+        if (valid && dist_sq(t.x, t.y, tx, ty) <= tower_range_sq) return t.target_id;
+    }
+
+    for (auto& m : minions) {
+        if (m.second.team == t.team) continue;
+        int d = dist_sq(t.x, t.y, (int)m.second.x, (int)m.second.y);
+        if (d <= tower_range_sq && d < min_dist) { min_dist = d; best_target = m.second.id; }
+    }
+    if (best_target == 0) {
         for (auto& p : players) {
             if (!p.second.is_playing || p.second.color == t.team) continue;
             int d = dist_sq(t.x, t.y, p.second.x, p.second.y);
-            if (d > tower_range_sq) continue;
-            if (now - p.second.last_aggressive_time < 2000) {
-                best_target = p.second.id;
-                break; 
-            }
+            if (d <= tower_range_sq && d < min_dist) { min_dist = d; best_target = p.second.id; }
         }
-        // 2. 锁定与索敌
-        if (best_target == 0 && t.target_id != 0) {
-            bool valid = false;
-            int tx = 0, ty = 0;
-            PlayerState* p = get_player_by_id(t.target_id);
-            if (p) { tx = p->x; ty = p->y; valid = true; }
-            else if (minions.count(t.target_id)) {
-                if (minions[t.target_id].hp > 0) {
-                    tx = (int)minions[t.target_id].x; ty = (int)minions[t.target_id].y; valid = true;
-                }
+    }
+    return best_target;
+}
+
+int GameRoom::sense_minion_target(const MinionObj& m) {
+    int min_d = 9999, found = 0;
+    int vision_sq = MINION_VISION_RANGE * MINION_VISION_RANGE;
+
+    for (auto& p : players) {
+        if (!p.second.is_playing || p.second.color == m.team) continue;
+        int d = dist_sq((int)m.x, (int)m.y, p.second.x, p.second.y);
+        if (d <= vision_sq && d < min_d) { min_d = d; found = p.second.id; }
+    }
+    if (found == 0) {
+        for (auto& em : minions) {
+            if (em.second.team == m.team) continue;
+            int d = dist_sq((int)m.x, (int)m.y, (int)em.second.x, (int)em.second.y);
+            if (d <= vision_sq && d < min_d) { min_d = d; found = em.second.id; }
+        }
+    }
+    if (found == 0) {
+        for (auto& t : towers) {
+            if (t.second.team == m.team || t.second.hp <= 0) continue;
+            int d = dist_sq((int)m.x, (int)m.y, t.second.x, t.second.y);
+            if (d <= (MINION_VISION_RANGE+2)*(MINION_VISION_RANGE+2) && d < min_d) { 
+                min_d = d; found = t.second.id; 
             }
-            if (valid && dist_sq(t.x, t.y, tx, ty) <= tower_range_sq) best_target = t.target_id;
         }
+    }
+    return found;
+}
 
-        if (best_target == 0) {
-            for (auto& m : minions) {
-                if (m.second.team == t.team) continue;
-                int d = dist_sq(t.x, t.y, (int)m.second.x, (int)m.second.y);
-                if (d <= tower_range_sq && d < min_dist) { min_dist = d; best_target = m.second.id; }
-            }
-            if (best_target == 0) {
-                for (auto& p : players) {
-                    if (!p.second.is_playing || p.second.color == t.team) continue;
-                    int d = dist_sq(t.x, t.y, p.second.x, p.second.y);
-                    if (d <= tower_range_sq && d < min_dist) { min_dist = d; best_target = p.second.id; }
-                }
-            }
+PlayerState* GameRoom::sense_jungle_target(const JungleObj& m) {
+    return get_player_by_id(m.target_id);
+}
+
+// =========================================
+// 行动阶段：串行应用感知结果
+// =========================================
+
+void GameRoom::update_towers(long long now) {
+    int tower_range_sq = TOWER_ATK_RANGE * TOWER_ATK_RANGE;
+    
+    for (size_t i = 0; i < sense_towers.size(); i++) {
+        TowerObj& t = *sense_towers[i];
+        int best_target = tower_targets[i];
+        if (t.hp <= 0) continue; // 被摧毁的塔不再预约
+
+        // 快照之后本帧可能已有英雄被击杀回城，出手前再确认一次距离
+        if (best_target != 0) {
+            PlayerState* bp = get_player_by_id(best_target);
+            if (bp && dist_sq(t.x, t.y, bp->x, bp->y) > tower_range_sq) best_target = 0;
         }
 
         if (best_target != t.target_id) { 
@@ -862,42 +1285,29 @@ void GameRoom::update_towers(long long now) {
                 minions[t.target_id].hp -= (TOWER_BASE_DMG_MINION + 100 * wave_count);
             }
         }
+
+        // 有目标或仍在冷却：冷却结束再醒；否则隔一段时间巡检一次
+        if (t.target_id != 0 || now - t.last_attack_time < TOWER_ATK_COOLDOWN) {
+            t.wake_time = t.last_attack_time + TOWER_ATK_COOLDOWN;
+        } else {
+            t.wake_time = now + TOWER_IDLE_SCAN_MS;
+        }
+        timers.schedule(t.wake_time, TIMER_TOWER, t.id);
     }
 }
 
 void GameRoom::update_minions(long long now) {
-    std::vector<int> dead_ids;
+    std::pmr::vector<int> dead_ids(&frame_arena);
     const std::vector<Pt>* paths[] = { &PATH_TOP, &PATH_MID, &PATH_BOT };
 
+    int idx = 0;
     for (auto& pair : minions) {
         MinionObj& m = pair.second;
+        idx++;
         if (m.hp <= 0) { dead_ids.push_back(m.id); continue; }
 
         if (m.state == 0) { // MARCHING
-            int min_d = 9999, found = 0;
-            int vision_sq = MINION_VISION_RANGE * MINION_VISION_RANGE;
-
-            for (auto& p : players) {
-                if (!p.second.is_playing || p.second.color == m.team) continue;
-                int d = dist_sq((int)m.x, (int)m.y, p.second.x, p.second.y);
-                if (d <= vision_sq && d < min_d) { min_d = d; found = p.second.id; }
-            }
-            if (found == 0) {
-                for (auto& em : minions) {
-                    if (em.second.team == m.team) continue;
-                    int d = dist_sq((int)m.x, (int)m.y, (int)em.second.x, (int)em.second.y);
-                    if (d <= vision_sq && d < min_d) { min_d = d; found = em.second.id; }
-                }
-            }
-            if (found == 0) {
-                for (auto& t : towers) {
-                    if (t.second.team == m.team || t.second.hp <= 0) continue;
-                    int d = dist_sq((int)m.x, (int)m.y, t.second.x, t.second.y);
-                    if (d <= (MINION_VISION_RANGE+2)*(MINION_VISION_RANGE+2) && d < min_d) { 
-                        min_d = d; found = t.second.id; 
-                    }
-                }
-            }
+            int found = minion_targets[idx - 1];
 
             if (found != 0) {
                 m.state = 1; m.target_id = found; 
@@ -984,16 +1394,11 @@ void GameRoom::update_minions(long long now) {
 }
 
 void GameRoom::update_jungle(long long now) {
-    std::vector<int> dead_ids;
-    
-    // 清理过期特效
-    for (auto it = active_effects.begin(); it != active_effects.end(); ) {
-        if (now >= it->end_time) it = active_effects.erase(it);
-        else ++it;
-    }
+    std::pmr::vector<int> dead_ids(&frame_arena);
 
-    for (auto& pair : jungle_mobs) {
-        JungleObj& m = pair.second;
+    for (size_t i = 0; i < sense_jungle.size(); i++) {
+        JungleObj& m = *sense_jungle[i];
+        PlayerState* sensed = jungle_targets[i];
         if (m.hp <= 0) { dead_ids.push_back(m.id); continue; }
 
         if (m.target_id == 0 && m.hp < m.max_hp) {
@@ -1010,88 +1415,11 @@ void GameRoom::update_jungle(long long now) {
         }
 
         if (m.target_id != 0) {
-            if (m.boss_state == 1) { // PREPARE
-                if (m.type == BOSS_TYPE_OVERLORD) {
-                    if (now - m.skill_start_time >= OVERLORD_SKILL_DELAY) {
-                        for (auto& target_pos : m.skill_targets) {
-                            SkillEffectObj eff = {target_pos.x, target_pos.y, VFX_OVERLORD_DMG, now, now + 500, OVERLORD_SKILL_RADIUS, m.id};
-                            active_effects.push_back(eff);
-                            
-                            for (auto& p : players) {
-                                if (!p.second.is_playing) continue;
-                                if (dist_sq(p.second.x, p.second.y, target_pos.x, target_pos.y) <= OVERLORD_SKILL_RADIUS * OVERLORD_SKILL_RADIUS) {
-                                    int def = get_total_def(p.second);
-                                    int dmg = (m.dmg * 3) - def;
-                                    if(dmg < 1) dmg = 1;
-                                    
-                                    p.second.hp -= dmg;
-                                    p.second.current_effect = EFFECT_HIT;
-                                    if(p.second.hp <= 0) { 
-                                        if (p.second.color == 1) team2_kills++; 
-                                        else team1_kills++;
-
-                                        // 记录死亡
-                                        p.second.deaths++;
-
-                                        p.second.hp = p.second.max_hp; 
-                                        p.second.x = (p.second.color == 1)?22:128; p.second.y = (p.second.color == 1)?128:22;
-                                        m.target_id = 0; m.attack_counter = 0; m.boss_state = 0;
-                                    }
-                                }
-                            }
-                        }
-                        m.boss_state = 0; 
-                        m.last_attack_time = now; 
-                    }
-                }
-                continue; 
-            }
-            else if (m.boss_state == 2) { // ACTIVE
-                if (m.type == BOSS_TYPE_TYRANT) {
-                    if (now - m.skill_start_time >= TYRANT_SKILL_DUR) {
-                        m.boss_state = 0;
-                        m.last_attack_time = now;
-                    } else {
-                        if (now >= m.next_tick_time) {
-                            m.next_tick_time += 500;
-                            for (auto& p : players) {
-                                if (!p.second.is_playing) continue;
-                                int d = dist_sq(m.x, m.y, p.second.x, p.second.y);
-                                if (d <= TYRANT_RANGE * TYRANT_RANGE) {
-                                    int def = get_total_def(p.second);
-                                    int dmg = (m.dmg * 2) - def;
-                                    if(dmg < 1) dmg = 1;
-                                    
-                                    p.second.hp -= dmg;
-                                    p.second.current_effect = EFFECT_HIT;
-                                    int push_dx = 0, push_dy = 0;
-                                    if (p.second.x > m.x) push_dx = 1; else if (p.second.x < m.x) push_dx = -1;
-                                    if (p.second.y > m.y) push_dy = 1; else if (p.second.y < m.y) push_dy = -1;
-                                    int nx = p.second.x + push_dx;
-                                    int ny = p.second.y + push_dy;
-                                    if (!is_blocked_by_tower(nx, ny)) { p.second.x = nx; p.second.y = ny; }
-                                    
-                                    if(p.second.hp <= 0) {
-                                        if (p.second.color == 1) team2_kills++; 
-                                        else team1_kills++;
-
-                                        // 记录死亡
-                                        p.second.deaths++;
-
-                                        p.second.hp = p.second.max_hp; 
-                                        p.second.x = (p.second.color == 1)?22:128; p.second.y = (p.second.color == 1)?128:22;
-                                        m.target_id = 0; m.attack_counter = 0; m.boss_state = 0;
-                                    }
-                                }
-                            }
-                        }
-                    }
-                }
-                continue; 
-            }
+            // 技能施放中 (PREPARE / ACTIVE)：由技能脚本推进，这里不再普通攻击
+            if (m.boss_state != 0) continue;
 
             int tx=0, ty=0; bool valid=false;
-            PlayerState* p = get_player_by_id(m.target_id);
+            PlayerState* p = sensed;
             if (p) { tx = p->x; ty = p->y; valid = true; }
             if (!valid) { m.target_id = 0; continue; }
 
@@ -1103,22 +1431,14 @@ void GameRoom::update_jungle(long long now) {
                 if (now - m.last_attack_time >= cd) {
                     if ((m.type == BOSS_TYPE_OVERLORD || m.type == BOSS_TYPE_TYRANT) && m.attack_counter >= 3) {
                         m.attack_counter = 0;
+                        m.skill_seq++;
                         if (m.type == BOSS_TYPE_OVERLORD) {
                             m.boss_state = 1; 
-                            m.skill_start_time = now;
-                            m.skill_targets.clear();
-                            for(auto& pl : players) {
-                                if(pl.second.is_playing && dist_sq(m.x, m.y, pl.second.x, pl.second.y) <= OVERLORD_RANGE * OVERLORD_RANGE) {
-                                    m.skill_targets.push_back({pl.second.x, pl.second.y});
-                                    SkillEffectObj eff = {pl.second.x, pl.second.y, VFX_OVERLORD_WARN, now, now + OVERLORD_SKILL_DELAY, OVERLORD_SKILL_RADIUS, m.id};
-                                    active_effects.push_back(eff);
-                                }
-                            }
+                            scripts.start(overlord_skill(m.id, m.skill_seq), now);
                         } 
                         else if (m.type == BOSS_TYPE_TYRANT) {
                             m.boss_state = 2; 
-                            m.skill_start_time = now;
-                            m.next_tick_time = now + 500;
+                            scripts.start(tyrant_skill(m.id, m.skill_seq), now);
                         }
                     } 
                     else {
@@ -1151,28 +1471,77 @@ void GameRoom::update_jungle(long long now) {
             }
         }
     }
+
+    // 有仇恨的继续逐帧处理；脱战的睡眠，需要回血时再由时间轮唤醒
+    awake_jungle.clear();
+    for (JungleObj* m : sense_jungle) {
+        if (m->hp <= 0) continue;
+        if (m->target_id != 0) {
+            m->awake = true;
+            awake_jungle.push_back(m->id);
+        } else {
+            m->awake = false;
+            if (m->hp < m->max_hp) {
+                m->wake_time = std::max(now + 1, m->last_regen_time + 1000);
+                timers.schedule(m->wake_time, TIMER_JUNGLE, m->id);
+            }
+        }
+    }
     for(int id : dead_ids) jungle_mobs.erase(id);
 }
 
 // 核心攻击逻辑：应用属性计算、防御力、吸血与金币、比分
-bool GameRoom::handle_attack_logic(int attacker_fd) {
+bool GameRoom::handle_attack_logic(int attacker_fd, int view_ms) {
     PlayerState& att = players[attacker_fd];
     HeroData& tmpl = HERO_DB[att.hero_id];
     int range_sq = (tmpl.range + 1) * (tmpl.range + 1);
+    long long now = clock_ms();
     
     int target_id = 0;
     int min_dist = 9999;
+
+    // [新增] 延迟补偿：客户端画面落后于服务器，英雄和小兵回到它看到的那一帧 (最多回退 LAG_COMP_MAX_MS) 再索敌
+    const HistoryEntity* seen = nullptr;
+    int seen_count = 0;
+    if (view_ms > 0) {
+        long long view_time = game_start_time + view_ms;
+        if (view_time < now - LAG_COMP_MAX_MS) view_time = now - LAG_COMP_MAX_MS;
+        if (view_time < now) seen = history.frame_at(view_time, &seen_count);
+    }
     
     // 索敌
-    for(auto& p : players) {
-        if(p.second.color == att.color || !p.second.is_playing) continue;
-        int d = dist_sq(att.x, att.y, p.second.x, p.second.y);
-        if(d <= range_sq && d < min_dist) { min_dist=d; target_id=p.second.id; }
-    }
-    for (auto& m : minions) {
-        if (m.second.team == att.color) continue;
-        int d = dist_sq(att.x, att.y, (int)m.second.x, (int)m.second.y);
-        if (d <= range_sq && d < min_dist) { min_dist = d; target_id = m.second.id; }
+    if (seen) {
+        for (int i = 0; i < seen_count; i++) {
+            const HistoryEntity& e = seen[i];
+            if (e.team == att.color) continue;
+            int d = dist_sq(att.x, att.y, e.x, e.y);
+            if (d > range_sq || d >= min_dist) continue;
+
+            // 目标现在必须还在，且没有在这段时间里复活/闪现到别处
+            int cx, cy;
+            if (e.id >= MINION_ID_START) {
+                auto it = minions.find(e.id);
+                if (it == minions.end()) continue;
+                cx = (int)it->second.x; cy = (int)it->second.y;
+            } else {
+                PlayerState* p = get_player_by_id(e.id);
+                if (!p) continue;
+                cx = p->x; cy = p->y;
+            }
+            if (dist_sq(e.x, e.y, cx, cy) > LAG_COMP_MAX_DRIFT_SQ) continue;
+            min_dist = d; target_id = e.id;
+        }
+    } else {
+        for(auto& p : players) {
+            if(p.second.color == att.color || !p.second.is_playing) continue;
+            int d = dist_sq(att.x, att.y, p.second.x, p.second.y);
+            if(d <= range_sq && d < min_dist) { min_dist=d; target_id=p.second.id; }
+        }
+        for (auto& m : minions) {
+            if (m.second.team == att.color) continue;
+            int d = dist_sq(att.x, att.y, (int)m.second.x, (int)m.second.y);
+            if (d <= range_sq && d < min_dist) { min_dist = d; target_id = m.second.id; }
+        }
     }
     for (auto& t : towers) {
         if (t.second.team == att.color || t.second.hp <= 0) continue;
@@ -1186,10 +1555,9 @@ bool GameRoom::handle_attack_logic(int attacker_fd) {
     
     if (target_id != 0) {
         att.current_target_id = target_id;
-        att.visual_end_time = get_current_ms() + 200;
-        att.last_aggressive_time = get_current_ms();
+        att.visual_end_time = now + 200;
+        att.last_aggressive_time = now;
         
-        long long now = get_current_ms();
         int atk_dmg = get_total_atk(att);
         
         // 吸血 (泣血之刃)
@@ -1227,6 +1595,7 @@ bool GameRoom::handle_attack_logic(int attacker_fd) {
                 mob.hp -= atk_dmg; // 野怪暂无防御
                 mob.target_id = att.id;
                 mob.last_hit_by_time = now;
+                wake_jungle(mob);
                 if(mob.hp <= 0) {
                     int reward = 100;
                     if(mob.type == MONSTER_TYPE_RED || mob.type == MONSTER_TYPE_BLUE) reward = 300;
@@ -1250,7 +1619,9 @@ bool GameRoom::handle_attack_logic(int attacker_fd) {
 }
 
 void GameRoom::broadcast_world(long long now) {
-    std::vector<GamePacket> updates;
+    std::pmr::vector<GamePacket> updates(&frame_arena);
+    updates.reserve(players.size() + towers.size() + minions.size() + jungle_mobs.size() * 2
+                    + active_effects.size() + hero_spells.size() + 1);
     
     // Pack Players
     for(auto& pair : players) {
@@ -1270,6 +1641,7 @@ void GameRoom::broadcast_world(long long now) {
         pkt.effect = p.current_effect;
         pkt.attack_target_id = atk_target;
         pkt.gold = p.gold;
+        pkt.extra = p.last_move_seq; // 只有本人会用，整帧仍是所有人共用一份
         
         // 填充装备栏
         for(size_t i=0; i<p.inventory.size() && i<6; i++) {
@@ -1373,10 +1745,49 @@ void GameRoom::broadcast_world(long long now) {
     GamePacket end_pkt; memset(&end_pkt, 0, sizeof(end_pkt));
     end_pkt.type = TYPE_FRAME;
     end_pkt.extra = (int)((now - game_start_time) / 1000);
+    end_pkt.input = (int)(now - game_start_time);
+
+    updates.push_back(end_pkt);
 
+    // [新增] 降级控制：采样帧里按帧间隔和各自的发送积压调整等级 (本地副本不做)
+    // 帧间隔要用真实时间量：帧同步时 now 是按帧号推出来的逻辑时钟，永远是整 33ms
+    bool was_behind = qos.behind();
+    bool sample = qos.on_tick(get_current_ms()) && !replica;
+    if (qos.behind() != was_behind) {
+        std::cout << "[QoS] Room " << room_id << (qos.behind() ? " falling behind real time, degrading snapshots."
+                                                               : " caught up, restoring snapshot quality.") << std::endl;
+    }
+    std::pmr::vector<GamePacket> reduced(&frame_arena);
+
+    // 整帧作为一份快照发出：TCP 下少一次系统调用，UDP 下可以整帧丢弃/只取最新
     for(auto& pair : players) {
-        write(pair.first, updates.data(), updates.size() * sizeof(GamePacket)); 
-        write(pair.first, &end_pkt, sizeof(end_pkt));
+        if (pair.second.lockstep_synced) continue; // 本地在模拟，只收输入包
+        PlayerState& p = pair.second;
+        if (sample) qos.adjust(p.qos_level, p.qos_calm, net_send_backlog(pair.first));
+        if (p.qos_level == 0) {
+            net_send(pair.first, updates.data(), updates.size() * sizeof(GamePacket), NET_SNAPSHOT); 
+            continue;
+        }
+        // 降级的客户端单独挑一份 (各客户端的完整帧按 fd 错开)
+        reduced.clear();
+        if (qos.filter(updates.data(), updates.size(), p.qos_level, qos.tick() + pair.first, p.x, p.y, reduced)) {
+            net_send(pair.first, reduced.data(), reduced.size() * sizeof(GamePacket), NET_SNAPSHOT);
+        }
+    }
+    // [新增] 同一份编码交给观战中继，由它复制一次后分发给所有观众
+    if (on_frame) on_frame(room_id, (const char*)updates.data(), (int)(updates.size() * sizeof(GamePacket)));
+}
+
+// [新增] 本帧模拟完的位置进历史 (塔和野怪不会动，不记)
+void GameRoom::record_history(long long now) {
+    history.begin_frame(now);
+    for (auto& pair : players) {
+        const PlayerState& p = pair.second;
+        if (p.is_playing) history.add(p.id, p.color, p.x, p.y);
+    }
+    for (auto& pair : minions) {
+        const MinionObj& m = pair.second;
+        history.add(m.id, m.team, (int)m.x, (int)m.y);
     }
 }
 
@@ -1402,4 +1813,192 @@ bool GameRoom::is_blocked_by_tower(int x, int y) {
         }
     }
     return false;
-}
\ No newline at end of file
+}
+// =========================================
+// [新增] 帧同步
+// =========================================
+
+long long GameRoom::clock_ms() {
+    if (lockstep) return LOCKSTEP_EPOCH_MS + (long long)lockstep_tick * LOCKSTEP_TICK_MS;
+    return get_current_ms();
+}
+
+int GameRoom::next_random() {
+    return lcg_next(rng_state);
+}
+
+// 只转发会改变对局状态的操作；每帧有上限，超出的丢掉 (没转发的服务器也不执行)
+void GameRoom::queue_lockstep_input(int fd, const GamePacket& pkt) {
+    if (pkt.type != TYPE_MOVE && pkt.type != TYPE_ATTACK && pkt.type != TYPE_SPELL &&
+        pkt.type != TYPE_BUY_ITEM && pkt.type != TYPE_SKILL_I && pkt.type != TYPE_SKILL_U) return;
+    if ((int)lockstep_inputs.size() >= LOCKSTEP_MAX_INPUTS) return;
+
+    LockstepInput in;
+    in.fd = fd;
+    in.type = pkt.type;
+    in.x = pkt.x;
+    in.y = pkt.y;
+    in.input = pkt.input;
+    in.extra = pkt.extra;
+    lockstep_inputs.push_back(in);
+}
+
+// 服务器上离开的玩家当时就删了 (等价于排在本帧最前面)，这里的 erase 只对副本生效
+void GameRoom::apply_lockstep_inputs() {
+    for (int fd : lockstep_left) {
+        if (players.erase(fd)) info_version++;
+    }
+    for (const LockstepInput& in : lockstep_inputs) {
+        GamePacket pkt;
+        memset(&pkt, 0, sizeof(pkt));
+        pkt.type = in.type;
+        pkt.x = in.x;
+        pkt.y = in.y;
+        pkt.input = in.input;
+        pkt.extra = in.extra;
+        apply_game_input(in.fd, pkt);
+    }
+}
+
+// 还有人要看快照 (不支持/已失步的玩家、观众) 才需要编码整帧
+bool GameRoom::snapshots_needed() {
+    if (!lockstep || replica || on_frame) return true;
+    for (auto& pair : players) {
+        if (!pair.second.lockstep_synced) return true;
+    }
+    return false;
+}
+
+void GameRoom::send_lockstep_start() {
+    LockstepStartPacket pkt;
+    memset(&pkt, 0, sizeof(pkt));
+    pkt.type = TYPE_LOCKSTEP_START;
+    pkt.room_id = room_id;
+    pkt.seed = lockstep_seed;
+    pkt.next_id = global_id_counter;
+    for (auto& pair : players) {
+        if (pkt.player_count >= 10) break;
+        LockstepPlayer& lp = pkt.players[pkt.player_count++];
+        lp.fd = pair.first;
+        lp.id = pair.second.id;
+        lp.hero_id = pair.second.hero_id;
+        lp.color = pair.second.color;
+        lp.room_slot = pair.second.room_slot;
+        strncpy(lp.name, pair.second.name.c_str(), 31);
+    }
+    for (auto& pair : players) {
+        if (!pair.second.lockstep_pending) continue;
+        pkt.self_fd = pair.first;
+        net_send(pair.first, &pkt, sizeof(pkt));
+    }
+}
+
+// 一帧一个输入包；每 LOCKSTEP_HASH_INTERVAL 帧抽样算一次状态哈希给客户端校验
+void GameRoom::send_lockstep_tick() {
+    bool any = false;
+    for (auto& pair : players) any = any || pair.second.lockstep_synced || pair.second.lockstep_pending;
+    if (!any) return;
+
+    int count = (int)(lockstep_left.size() + lockstep_inputs.size());
+    lockstep_buf.assign(lockstep_tick_size(count), 0);
+    LockstepTickPacket* hdr = (LockstepTickPacket*)lockstep_buf.data();
+    hdr->type = TYPE_LOCKSTEP_TICK;
+    hdr->tick = lockstep_tick;
+    hdr->has_hash = (lockstep_tick % LOCKSTEP_HASH_INTERVAL == 0) ? 1 : 0;
+    hdr->hash = hdr->has_hash ? state_hash() : 0;
+    hdr->count = count;
+
+    LockstepInput* out = (LockstepInput*)(lockstep_buf.data() + sizeof(LockstepTickPacket));
+    for (int fd : lockstep_left) {
+        out->fd = fd;
+        out->type = TYPE_LEAVE_ROOM;
+        out++;
+    }
+    for (const LockstepInput& in : lockstep_inputs) *out++ = in;
+
+    for (auto& pair : players) {
+        if (pair.second.lockstep_synced || pair.second.lockstep_pending) net_send(pair.first, lockstep_buf.data(), lockstep_buf.size());
+    }
+}
+
+void GameRoom::start_lockstep_replica(const LockstepStartPacket& pkt) {
+    reset(pkt.room_id, "");
+    for (int i = 0; i < pkt.player_count && i < 10; i++) {
+        const LockstepPlayer& lp = pkt.players[i];
+        PlayerState p = PlayerState();
+        p.fd = lp.fd;
+        p.id = lp.id;
+        p.hero_id = lp.hero_id;
+        p.color = lp.color;
+        p.room_slot = lp.room_slot;
+        p.name = std::string(lp.name, strnlen(lp.name, sizeof(lp.name)));
+        p.is_ready = true;
+        players[lp.fd] = p;
+    }
+    global_id_counter = pkt.next_id;
+    replica = true;
+    lockstep_seed = pkt.seed;
+    status = ROOM_STATUS_PICKING;
+    start_battle();
+}
+
+bool GameRoom::apply_lockstep_tick(const LockstepTickPacket& hdr, const LockstepInput* inputs) {
+    if (!replica || status != ROOM_STATUS_PLAYING || hdr.tick != lockstep_tick + 1) return false;
+
+    lockstep_left.clear();
+    lockstep_inputs.clear();
+    for (int i = 0; i < hdr.count; i++) {
+        if (inputs[i].type == TYPE_LEAVE_ROOM) lockstep_left.push_back(inputs[i].fd);
+        else lockstep_inputs.push_back(inputs[i]);
+    }
+    update_logic();
+    return true;
+}
+
+// FNV-1a，覆盖所有影响后续模拟的状态 (显示用的特效标记除外)
+static void hash_mix(unsigned int& h, long long v) {
+    for (int i = 0; i < 8; i++) {
+        h ^= (unsigned int)((v >> (i * 8)) & 0xff);
+        h *= 16777619u;
+    }
+}
+
+static long long float_bits(float f) {
+    int bits;
+    memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
+
+unsigned int GameRoom::state_hash() {
+    unsigned int h = 2166136261u;
+    hash_mix(h, rng_state);
+    hash_mix(h, wave_count);
+    hash_mix(h, team1_kills);
+    hash_mix(h, team2_kills);
+    for (auto& pair : players) {
+        const PlayerState& p = pair.second;
+        hash_mix(h, pair.first);
+        hash_mix(h, p.id); hash_mix(h, p.x); hash_mix(h, p.y);
+        hash_mix(h, p.dir_x); hash_mix(h, p.dir_y);
+        hash_mix(h, p.hp); hash_mix(h, p.max_hp); hash_mix(h, p.gold);
+        hash_mix(h, p.kills); hash_mix(h, p.deaths);
+        hash_mix(h, p.last_skill_u_time); hash_mix(h, p.last_skill_i_time);
+        for (int item : p.inventory) hash_mix(h, item);
+    }
+    for (auto& pair : minions) {
+        const MinionObj& m = pair.second;
+        hash_mix(h, m.id); hash_mix(h, float_bits(m.x)); hash_mix(h, float_bits(m.y));
+        hash_mix(h, m.hp); hash_mix(h, m.state); hash_mix(h, m.target_id); hash_mix(h, m.wp_idx);
+    }
+    for (auto& pair : towers) {
+        hash_mix(h, pair.first); hash_mix(h, pair.second.hp); hash_mix(h, pair.second.target_id);
+    }
+    for (auto& pair : jungle_mobs) {
+        const JungleObj& m = pair.second;
+        hash_mix(h, m.id); hash_mix(h, m.x); hash_mix(h, m.y);
+        hash_mix(h, m.hp); hash_mix(h, m.target_id); hash_mix(h, m.boss_state);
+    }
+    hash_mix(h, (long long)hero_spells.size());
+    hash_mix(h, (long long)active_effects.size());
+    return h;
+}
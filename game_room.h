@@ -3,33 +3,45 @@
 
 #include <vector>
 #include <map>
+#include <memory_resource>
+#include <functional>
 #include <iostream>
 #include <string>
 #include "protocol.h"
+#include "timer_wheel.h"
+#include "ability_script.h"
+#include "position_history.h"
+#include "snapshot_qos.h"
+
+// [新增] 房间时间轮的事件类型
+#define TIMER_TOWER          1  // 塔攻击冷却结束 / 空闲巡检
+#define TIMER_JUNGLE         2  // 脱战野怪回血
+#define TIMER_PLAYER_REGEN   3  // 霸者重装被动回血
+#define TIMER_SCRIPT         4  // 技能脚本 (协程) 恢复
+#define TIMER_EFFECT         5  // 特效过期清理
+
+#define TOWER_IDLE_SCAN_MS   200 // 塔身边没人时的巡检间隔
+
+// [新增] 每帧临时数据 (广播包、死亡列表等) 的 bump 缓冲区大小，每帧开头整体复位
+#define ROOM_FRAME_ARENA_BYTES (128 * 1024)
+
+// 感知阶段实体总数超过该值时才分发到线程池，小房间直接串行跑
+#define SENSE_PARALLEL_THRESHOLD 128
+#define SENSE_PARALLEL_GRAIN     32
 
 // --------------------------------------------------------
 // 辅助结构体
 // --------------------------------------------------------
 
-// [新增] 技能实体结构体 (用于管理法师的多段技能等)
+// [新增] 技能实体结构体 (法师多段技能的显示记录，生命周期由技能脚本管理)
 struct SpellObj {
     int id;               // 唯一ID (暂用 global counter 分配)
     int owner_id;         // 释放者 ID
     int stage;            // 阶段: 1, 2, 3
     int x, y;             // 中心坐标
-    int dir_x, dir_y;     // 传递给下一段的方向
     int radius;           // 伤害半径
-    float dmg_mult;       // 伤害倍率 (1.0 或 2.0)
-    
-    long long create_time;        // 创建时间
-    long long active_time;        // 激活/开始造成伤害的时间 (用于Stage1,2的延迟爆发)
-    long long next_stage_time;    // 什么时候生成下一段 (-1表示没有)
+    long long active_time;        // 开始造成伤害的时间 (之前显示预警圈)
     long long end_time;           // 技能彻底消失时间
-    
-    // 状态标记
-    bool next_spawned;    // 下一段是否已生成
-    bool dmg_dealt;       // 单次伤害是否已结算 (Stage 1 & 2)
-    long long last_dot_time; // 持续伤害上次触发时间 (Stage 3)
 };
 
 struct PlayerState {
@@ -67,6 +79,18 @@ struct PlayerState {
     // [新增] 技能冷却
     long long last_skill_u_time;
     long long last_skill_i_time;
+
+    // [新增] 帧同步：客户端声明能本地模拟 / 本局正在按输入包同步 (不收快照)
+    bool lockstep_capable;
+    bool lockstep_synced;
+    bool lockstep_pending;  // 已发开局参数，等客户端回 READY (期间输入包和快照都发)
+
+    // [新增] 已执行的最后一个移动序号，随快照回给本人用于客户端预测校正
+    int last_move_seq;
+
+    // [新增] 快照降级等级 (0 为完整) 与连续有余量的采样次数，见 SnapshotQos
+    int qos_level;
+    int qos_calm;
 };
 
 struct TowerObj {
@@ -76,6 +100,7 @@ struct TowerObj {
     int consecutive_hits;       
     long long last_attack_time; 
     long long visual_end_time;  
+    long long wake_time;        // 时间轮上预约的唤醒时间
 };
 
 struct MinionObj {
@@ -100,13 +125,14 @@ struct JungleObj {
     long long last_regen_time;  
     long long visual_end_time;  
 
+    // 时间轮调度：有仇恨目标时每帧处理 (awake)，否则只在回血时被唤醒
+    bool awake;
+    long long wake_time;
+
     // Boss专用
     int attack_counter;         
-    int boss_state; // 0:IDLE, 1:PREPARE, 2:ACTIVE
-    long long skill_start_time; 
-    long long next_tick_time;   
-    struct Pt { int x, y; };
-    std::vector<Pt> skill_targets; 
+    int boss_state; // 0:IDLE, 1:PREPARE, 2:ACTIVE (由技能脚本推进)
+    int skill_seq;  // 每次施法 +1，脚本恢复时据此判断技能是否已被打断
 };
 
 struct SkillEffectObj {
@@ -130,6 +156,24 @@ public:
     GameRoom(int id, const std::string& owner_name);
     ~GameRoom();
 
+    // [新增] 恢复为空的等待中房间 (房间池回收复用)
+    void reset(int id, const std::string& owner_name);
+
+    // [新增] 对局结束回调 (RoomManager 据此更新匹配分)
+    void set_game_over_listener(std::function<void(const GameOverPacket&)> fn) { on_game_over = fn; }
+
+    // [新增] 帧同步：进程级开关 (--lockstep)，对之后开局的对局生效
+    static void set_lockstep_enabled(bool on);
+
+    // [新增] 客户端本地副本：按服务器的开局参数开局，之后每收到一帧输入包推进一帧
+    // 帧号不连续时返回 false (调用方应退回快照)
+    void start_lockstep_replica(const LockstepStartPacket& pkt);
+    bool apply_lockstep_tick(const LockstepTickPacket& hdr, const LockstepInput* inputs);
+    unsigned int state_hash();
+
+    // [新增] 观战：有人观战时，每帧编码好的整帧 (以及结算包) 原样交给监听者一次；没人看时不设置，不增加开销
+    void set_frame_listener(std::function<void(int room_id, const char* data, int len)> fn) { on_frame = fn; }
+
     // === 大厅管理接口 ===
     bool add_player(int fd, const std::string& name);
     void remove_player(int fd);
@@ -138,7 +182,13 @@ public:
     bool start_game(int fd_requester);
     
     RoomInfo get_room_info();
+    // [新增] 大厅可见信息 (人数/状态/房主) 每变一次 +1，RoomManager 据此增量同步房间目录
+    unsigned int get_info_version() const { return info_version; }
     RoomStatePacket get_room_state_packet();
+
+    // [新增] 房间状态 (座位/准备/选人) 变化只做标记，每帧在 update_logic 开头统一广播一次
+    void mark_state_dirty() { state_dirty = true; }
+    void flush_room_state();
     
     // === 游戏逻辑接口 ===
     void handle_game_packet(int fd, const GamePacket& pkt);
@@ -151,6 +201,28 @@ public:
     int get_player_id(int fd);
 
 private:
+    // === 房间内存 (必须在所有容器之前声明：最先构造、最后析构) ===
+    // 实体节点走按大小分级的 slab 池，房间销毁时整块归还给系统，不再逐个 free；
+    // 逐帧临时数据走 frame_arena，只移动指针，每帧开头 release() 复位。
+    std::pmr::unsynchronized_pool_resource entity_pool;
+    alignas(std::max_align_t) char frame_buffer[ROOM_FRAME_ARENA_BYTES];
+    std::pmr::monotonic_buffer_resource frame_arena;
+
+    std::function<void(const GameOverPacket&)> on_game_over;
+    std::function<void(int, const char*, int)> on_frame;
+    unsigned int info_version;
+    bool state_dirty;
+
+    // [新增] 帧同步：时间按帧号推算、随机数用开局种子，服务器与客户端副本跑出同样的结果
+    bool lockstep;                 // 本局是否为帧同步
+    bool replica;                  // 客户端副本：输入来自服务器的输入包
+    int lockstep_tick;
+    unsigned int lockstep_seed;
+    unsigned int rng_state;
+    std::vector<int> lockstep_left;              // 本帧离开的玩家
+    std::vector<LockstepInput> lockstep_inputs;  // 本帧收集的输入 (按到达顺序)
+    std::vector<char> lockstep_buf;              // 输入包编码缓冲
+
     // === 游戏数据 ===
     int game_map[MAP_SIZE][MAP_SIZE]; 
     long long game_start_time;
@@ -169,29 +241,86 @@ private:
     int boss_id_counter;
 
     // 实体容器
-    std::map<int, PlayerState> players; 
-    std::map<int, MinionObj> minions;
-    std::map<int, TowerObj> towers; 
-    std::map<int, JungleObj> jungle_mobs; 
+    std::pmr::map<int, PlayerState> players; 
+    std::pmr::map<int, MinionObj> minions;
+    std::pmr::map<int, TowerObj> towers; 
+    std::pmr::map<int, JungleObj> jungle_mobs; 
     
-    // 视觉特效 (Boss等使用)
-    std::vector<SkillEffectObj> active_effects; 
+    // 视觉特效 (Boss等使用)，顺序无关，删除时与末尾交换
+    std::pmr::vector<SkillEffectObj> active_effects; 
 
     // [新增] 英雄逻辑技能 (法师大招等需要持续判定的技能)
-    std::vector<SpellObj> hero_spells;
+    std::pmr::vector<SpellObj> hero_spells;
+
+    // [新增] 开局单位模板：构造时生成一次，每局开局直接拷贝，不再扫描整张地图
+    std::vector<TowerObj> tower_template;
+    std::vector<JungleObj> jungle_template;
+
+    // [新增] 时间轮：实体预约下一次唤醒，空闲实体每帧零开销
+    TimerWheel timers;
+    std::vector<TimerEvent> due_events;
+    std::vector<int> awake_jungle;       // 正在战斗、需要逐帧处理的野怪
+
+    // [新增] 技能脚本调度 (挂起的协程挂在上面的时间轮上)
+    ScriptScheduler scripts;
+    std::vector<TimerEvent> due_scripts; // 本帧需要恢复的脚本
+    friend struct AbilityScript::promise_type;
+    ScriptFramePool& script_frames() { return scripts.frames(); }
+
+    // [新增] 感知阶段 (只读索敌) 的输入与结果，下标与本帧待处理列表一致
+    std::vector<TowerObj*> sense_towers;
+    std::vector<MinionObj*> sense_minions;
+    std::vector<JungleObj*> sense_jungle;
+    std::vector<int> tower_targets;             // 塔选中的目标 ID (0 表示无)
+    std::vector<int> minion_targets;            // 行军中小兵发现的目标 ID (0 表示无)
+    std::vector<PlayerState*> jungle_targets;   // 野怪当前仇恨目标 (无效为 nullptr)
+
+    // [新增] 延迟补偿：每帧结束时英雄/小兵的位置，普攻按攻击者画面上的那一帧索敌
+    PositionHistory history;
+
+    // [新增] 帧间隔变长或客户端发送积压时，按客户端给快照降级
+    SnapshotQos qos;
 
     // === 内部辅助逻辑 ===
+    void build_unit_templates();
     void init_map_and_units(); 
     void spawn_wave();
+    // [新增] 推进时间轮，把到期事件分发到本帧的待处理列表
+    void collect_due_timers(long long now);
+    void wake_jungle(JungleObj& m);
+    // [新增] 感知阶段：基于冻结快照为所有塔/小兵/野怪选目标，可并行
+    void sense_targets(long long now);
+    int sense_tower_target(const TowerObj& t, long long now);
+    int sense_minion_target(const MinionObj& m);
+    PlayerState* sense_jungle_target(const JungleObj& m);
     void update_towers(long long now);
     void update_minions(long long now);
     void update_jungle(long long now);
-    // [新增] 更新英雄技能逻辑
-    void update_spells(long long now);
+    // [新增] 恢复到期的技能脚本
+    void update_scripts(long long now);
+
+    // [新增] 技能脚本 (协程)
+    AbilityScript mage_chain_stage(int owner_id, int stage, int x, int y, int dir_x, int dir_y);
+    AbilityScript overlord_skill(int mob_id, int seq);
+    AbilityScript tyrant_skill(int mob_id, int seq);
+    void deal_spell_damage(int owner_id, int x, int y, int radius, float dmg_mult);
+    void remove_spell(int spell_id);
+    JungleObj* find_casting_boss(int mob_id, int seq, int state);
 
-    bool handle_attack_logic(int attacker_fd);
+    bool handle_attack_logic(int attacker_fd, int view_ms);
+    void record_history(long long now);
     void broadcast_world(long long now);
 
+    // [新增] 帧同步
+    long long clock_ms();   // 帧同步时为逻辑时间，否则为真实时间
+    int next_random();
+    void apply_game_input(int fd, const GamePacket& pkt);
+    void queue_lockstep_input(int fd, const GamePacket& pkt);
+    void apply_lockstep_inputs();
+    bool snapshots_needed();
+    void send_lockstep_start();
+    void send_lockstep_tick();
+
     void start_battle(); 
 
     // 商店与属性计算逻辑
@@ -0,0 +1,82 @@
+#include "idle_reaper.h"
+#include <algorithm>
+#include <iostream>
+
+#define TIMER_CONN_CHECK  1
+
+static const char* STAGE_NAMES[] = { "handshake", "login", "idle" };
+
+IdleReaper::IdleReaper(long long now) {
+    timers.reset(now);
+}
+
+void IdleReaper::add(int fd, long long now, long long opened) {
+    Conn c;
+    c.stage = STAGE_HANDSHAKE;
+    c.heartbeat = false;
+    c.opened = opened < 0 ? now : opened;
+    c.last_rx = now;
+    c.next_check = 0;
+    reschedule(fd, conns[fd] = c);
+}
+
+void IdleReaper::remove(int fd) {
+    conns.erase(fd); // 时间轮里剩下的事件到期时找不到连接，直接丢弃
+}
+
+void IdleReaper::on_data(int fd, long long now) {
+    auto it = conns.find(fd);
+    if (it == conns.end()) return;
+    it->second.last_rx = now;
+    if (it->second.stage == STAGE_HANDSHAKE) it->second.stage = STAGE_LOGIN;
+}
+
+// 注册成功的客户端也直接进大厅 (不再发登录)，同样算通过
+void IdleReaper::on_authed(int fd) {
+    auto it = conns.find(fd);
+    if (it != conns.end()) it->second.stage = STAGE_ACTIVE;
+}
+
+void IdleReaper::on_heartbeat(int fd, long long now) {
+    auto it = conns.find(fd);
+    if (it == conns.end()) return;
+    Conn& c = it->second;
+    c.last_rx = now;
+    if (!c.heartbeat) {
+        c.heartbeat = true;
+        reschedule(fd, c); // 截止时间提前了，原来的事件来不及
+    }
+}
+
+long long IdleReaper::deadline_of(const Conn& c) {
+    if (c.stage == STAGE_HANDSHAKE) return c.opened + CONN_HANDSHAKE_MS;
+    long long idle = c.last_rx + (c.heartbeat ? CONN_HEARTBEAT_MS : CONN_IDLE_MS);
+    if (c.stage == STAGE_LOGIN) return std::min(idle, c.opened + CONN_LOGIN_MS);
+    return idle;
+}
+
+void IdleReaper::reschedule(int fd, Conn& c) {
+    c.next_check = deadline_of(c);
+    timers.schedule(c.next_check, TIMER_CONN_CHECK, fd);
+}
+
+void IdleReaper::collect(long long now, std::vector<int>& expired) {
+    due.clear();
+    timers.advance(now, due);
+    for (const TimerEvent& ev : due) {
+        auto it = conns.find(ev.id);
+        if (it == conns.end() || it->second.next_check != ev.due) continue;
+        Conn& c = it->second;
+
+        // 期间有过数据 (或阶段变了)，按新的截止时间重新挂上
+        if (deadline_of(c) > now) {
+            reschedule(ev.id, c);
+            continue;
+        }
+
+        std::cout << "[Server] Reaping connection " << ev.id << " (" << STAGE_NAMES[c.stage] << " timeout, silent "
+                  << (now - c.last_rx) << "ms)" << std::endl;
+        conns.erase(it);
+        expired.push_back(ev.id);
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef IDLE_REAPER_H
+#define IDLE_REAPER_H
+
+#include <unordered_map>
+#include <vector>
+#include "timer_wheel.h"
+
+#define CONN_HANDSHAKE_MS  5000   // 连上后这么久一个字节都没发
+#define CONN_LOGIN_MS      30000  // 连上后这么久还没登录/注册成功
+#define CONN_HEARTBEAT_MS  5000   // 回过 PONG 的连接 (每秒一个 PING)：这么久没收到任何数据
+#define CONN_IDLE_MS       30000  // 其它连接：这么久没收到任何数据
+
+// --------------------------------------------------------
+// 空闲连接回收
+// 半开的 TCP 连接 (对端掉线、拔网线) 在 read 返回 0 之前一直占着房间里的玩家和收发缓冲，
+// 每帧还在给它写快照。这里给每条连接记一个截止时间挂在时间轮上：收到数据只更新时间戳，
+// 到期时再按最新状态算一次，真超时了才交给主循环走正常的断线流程。
+// 心跳复用延迟测量的 PING/PONG，回过 PONG 的连接按更短的 CONN_HEARTBEAT_MS 判定。
+// --------------------------------------------------------
+class IdleReaper {
+public:
+    explicit IdleReaper(long long now);
+
+    void add(int fd, long long now, long long opened = -1); // opened: 连接建立的时间，缺省为 now
+    void remove(int fd);
+
+    void on_data(int fd, long long now);       // 收到任意字节
+    void on_authed(int fd);                    // 登录/注册成功
+    void on_heartbeat(int fd, long long now);  // 收到 PONG
+
+    // 推进时间轮，把超时的连接追加到 expired (已从表中移除，由调用方关闭)
+    void collect(long long now, std::vector<int>& expired);
+
+private:
+    enum Stage { STAGE_HANDSHAKE, STAGE_LOGIN, STAGE_ACTIVE };
+    struct Conn {
+        Stage stage;
+        bool heartbeat;
+        long long opened;
+        long long last_rx;
+        long long next_check;  // 时间轮上有效的那个事件的时间，对不上的事件直接丢弃
+    };
+    std::unordered_map<int, Conn> conns;
+
+    TimerWheel timers;
+    std::vector<TimerEvent> due;
+
+    static long long deadline_of(const Conn& c);
+    void reschedule(int fd, Conn& c);
+};
+
+#endif
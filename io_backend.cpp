@@ -0,0 +1,18 @@
+#include "io_backend.h"
+#include "epoll_backend.h"
+#include "uring_backend.h"
+#include <iostream>
+#include <cstring>
+
+IoBackend* create_io_backend(const char* name) {
+    if (name && strcmp(name, "uring") == 0) {
+#ifdef MOBA_HAVE_URING
+        IoBackend* b = UringBackend::create();
+        if (b) return b;
+        std::cout << "[IO] io_uring unavailable, falling back to epoll" << std::endl;
+#else
+        std::cout << "[IO] io_uring not compiled in, falling back to epoll" << std::endl;
+#endif
+    }
+    return new EpollBackend();
+}
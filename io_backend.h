@@ -0,0 +1,52 @@
+#ifndef IO_BACKEND_H
+#define IO_BACKEND_H
+
+#include <functional>
+#include <sys/types.h>
+
+// ==========================================
+// 主循环的 I/O 后端 (启动时选择: ./server --io epoll|uring)
+// - epoll: 就绪通知 + 每个可读 socket 一次 read、每次发送一次 write
+// - uring: 多发 accept/recv + 内核提供的缓冲环，发送按连接合并，
+//          每轮循环一次 io_uring_enter 同时提交发送并收取完成事件
+// 客户端连接的数据直接以 on_data 交出；其它 fd (eventfd、UDP、房间服务器连接)
+// 只通知可读，由调用方自己去读。
+// ==========================================
+
+struct IoHandlers {
+    std::function<void(int listen_fd, int fd)> on_accept;       // 新连接 (已是非阻塞)
+    std::function<void(int fd, const char* data, int len)> on_data;
+    std::function<void(int fd)> on_closed;                      // 对端断开或出错，调用方负责 remove + close
+    std::function<void(int fd)> on_readable;                    // add_watch 注册的 fd 可读
+};
+
+class IoBackend {
+public:
+    virtual ~IoBackend() {}
+    virtual const char* name() const = 0;
+
+    void set_handlers(const IoHandlers& h) { handlers = h; }
+
+    virtual void add_listener(int fd) = 0;
+    virtual void add_stream(int fd) = 0;
+    virtual void add_watch(int fd) = 0;
+    virtual void remove(int fd) = 0;   // 必须在 close(fd) 之前调用
+
+    // 等待最多 timeout_ms 毫秒并分发事件
+    virtual void poll(int timeout_ms) = 0;
+
+    // 客户端连接的写；uring 下只是排队，flush/poll 时统一提交
+    virtual ssize_t send(int fd, const void* buf, size_t len) = 0;
+    virtual void flush() = 0;
+
+    // [新增] 已交给 send、还没进内核发送队列的字节数 (uring 的待提交和在飞缓冲)；直接 write 的后端为 0
+    virtual size_t queued_bytes(int fd) const { (void)fd; return 0; }
+
+protected:
+    IoHandlers handlers;
+};
+
+// name 为 "uring" 且内核支持时返回 io_uring 后端，否则返回 epoll 后端
+IoBackend* create_io_backend(const char* name);
+
+#endif
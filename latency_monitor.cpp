@@ -0,0 +1,153 @@
+#include "latency_monitor.h"
+#include "net_io.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#define LATENCY_REPORT_ROOMS  5  // 每次打印延迟最高的几个房间
+#define TIMER_PING            1
+
+// 各分段的上界 (毫秒)，最后一段兜底
+static const int LATENCY_BOUNDS[LATENCY_BUCKETS] = { 5, 10, 20, 30, 50, 75, 100, 150, 200, 300, 500, 1000, 5000 };
+
+LatencyHistogram::LatencyHistogram() : total(0), last_p95(-1) {
+    memset(counts, 0, sizeof(counts));
+}
+
+void LatencyHistogram::add(int rtt_ms) {
+    int b = 0;
+    while (b < LATENCY_BUCKETS - 1 && rtt_ms > LATENCY_BOUNDS[b]) b++;
+    counts[b]++;
+    total++;
+}
+
+int LatencyHistogram::percentile(double p) const {
+    if (total == 0) return -1;
+    unsigned long long rank = (unsigned long long)(p * total);
+    if (rank >= total) rank = total - 1;
+    unsigned long long seen = 0;
+    for (int b = 0; b < LATENCY_BUCKETS; b++) {
+        seen += counts[b];
+        if (seen > rank) return LATENCY_BOUNDS[b];
+    }
+    return LATENCY_BOUNDS[LATENCY_BUCKETS - 1];
+}
+
+int LatencyHistogram::recent_p95() const {
+    return total >= LATENCY_MIN_SAMPLES ? percentile(0.95) : last_p95;
+}
+
+void LatencyHistogram::roll() {
+    if (total > 0) last_p95 = percentile(0.95);
+    memset(counts, 0, sizeof(counts));
+    total = 0;
+}
+
+LatencyMonitor::LatencyMonitor(long long now) : next_report(now + LATENCY_REPORT_MS), lost(0) {
+    timers.reset(now);
+}
+
+void LatencyMonitor::on_pong(int fd, const PingPacket& pkt, long long now) {
+    auto it = conns.find(fd);
+    if (it == conns.end()) {
+        if (pkt.seq != 0) return;
+        Conn c;
+        c.seq = 0;
+        c.sent_ms = 0;
+        c.srtt = c.rttvar = 0;
+        c.has_rtt = false;
+        c.next_ping = now;
+        conns[fd] = c;
+        timers.schedule(now, TIMER_PING, fd);
+        return;
+    }
+
+    // 只认最近一次 PING 的回应 (超时后才到的旧回应丢弃)
+    Conn& c = it->second;
+    if (c.sent_ms == 0 || pkt.seq != c.seq || pkt.server_ms != c.sent_ms) return;
+    int rtt = (int)(now - c.sent_ms);
+    c.sent_ms = 0;
+
+    if (!c.has_rtt) {
+        c.srtt = rtt * 8;
+        c.rttvar = rtt * 2;
+        c.has_rtt = true;
+    } else {
+        int err = rtt - c.srtt / 8;
+        c.srtt += err;
+        c.rttvar += std::abs(err) - c.rttvar / 4;
+    }
+
+    global.add(rtt);
+    int room_id = room_of ? room_of(fd) : 0;
+    if (room_id > 0) rooms[room_id].add(rtt);
+}
+
+void LatencyMonitor::remove(int fd) {
+    conns.erase(fd); // 时间轮里剩下的事件到期时找不到连接，直接丢弃
+}
+
+void LatencyMonitor::update(long long now) {
+    due.clear();
+    timers.advance(now, due);
+    for (const TimerEvent& ev : due) {
+        auto it = conns.find(ev.id);
+        // fd 被复用后旧连接的事件对不上预约时间，丢弃
+        if (it == conns.end() || it->second.next_ping != ev.due) continue;
+        send_ping(ev.id, it->second, now);
+    }
+
+    if (now >= next_report) {
+        report();
+        next_report = now + LATENCY_REPORT_MS;
+    }
+}
+
+void LatencyMonitor::send_ping(int fd, Conn& c, long long now) {
+    if (c.sent_ms != 0) lost++; // 上一次没等到回应
+
+    PingPacket pkt;
+    memset(&pkt, 0, sizeof(pkt));
+    pkt.type = TYPE_PING;
+    pkt.seq = ++c.seq;
+    pkt.server_ms = now;
+    pkt.rtt_ms = c.has_rtt ? c.srtt / 8 : -1;
+    pkt.jitter_ms = c.has_rtt ? c.rttvar / 4 : -1;
+    int room_id = room_of ? room_of(fd) : 0;
+    auto rit = rooms.find(room_id);
+    pkt.room_p95_ms = (room_id > 0 && rit != rooms.end()) ? rit->second.recent_p95() : -1;
+    pkt.global_p95_ms = global.recent_p95();
+    net_send(fd, &pkt, sizeof(pkt));
+
+    c.sent_ms = now;
+    c.next_ping = now + PING_INTERVAL_MS;
+    timers.schedule(c.next_ping, TIMER_PING, fd);
+}
+
+// 打印本周期的全服分位数和延迟最高的几个房间，然后清零
+void LatencyMonitor::report() {
+    if (global.total > 0 || lost > 0) {
+        std::cout << "[Latency] " << conns.size() << " conns, " << global.total << " samples, " << lost << " lost"
+                  << " | p50 " << global.percentile(0.5) << "ms p95 " << global.percentile(0.95)
+                  << "ms p99 " << global.percentile(0.99) << "ms" << std::endl;
+
+        std::vector<std::pair<int, int>> worst; // (p95, room_id)
+        for (auto& pair : rooms) {
+            if (pair.second.total > 0) worst.push_back({ pair.second.percentile(0.95), pair.first });
+        }
+        std::sort(worst.rbegin(), worst.rend());
+        if (worst.size() > LATENCY_REPORT_ROOMS) worst.resize(LATENCY_REPORT_ROOMS);
+        for (auto& w : worst) {
+            const LatencyHistogram& h = rooms[w.second];
+            std::cout << "[Latency]   room " << w.second << ": " << h.total << " samples, p50 "
+                      << h.percentile(0.5) << "ms p95 " << w.first << "ms" << std::endl;
+        }
+    }
+
+    global.roll();
+    for (auto it = rooms.begin(); it != rooms.end();) {
+        if (it->second.total == 0) it = rooms.erase(it); // 本周期没人测过 (房间已散)
+        else { it->second.roll(); ++it; }
+    }
+    lost = 0;
+}
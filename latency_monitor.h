@@ -0,0 +1,68 @@
+#ifndef LATENCY_MONITOR_H
+#define LATENCY_MONITOR_H
+
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include "protocol.h"
+#include "timer_wheel.h"
+
+#define PING_INTERVAL_MS       1000   // 每条连接每秒测一次
+#define LATENCY_REPORT_MS      10000  // 统计周期：到点打印一次并清零
+#define LATENCY_MIN_SAMPLES    10     // 本周期样本不足时，分位数沿用上一周期的
+#define LATENCY_BUCKETS        13
+
+// 延迟直方图：按固定分段计数，分位数返回所在分段的上界 (毫秒)
+struct LatencyHistogram {
+    unsigned long long counts[LATENCY_BUCKETS];
+    unsigned long long total;
+    int last_p95;   // 上一周期的 95 分位 (-1 表示没有)
+
+    LatencyHistogram();
+    void add(int rtt_ms);
+    int percentile(double p) const;
+    int recent_p95() const;  // 本周期样本够就用本周期，否则用上一周期
+    void roll();             // 结束一个周期
+};
+
+// --------------------------------------------------------
+// 延迟测量 (跑在持有客户端连接的进程里，集群时即网关)
+// 回过 PONG 的连接按 PING_INTERVAL_MS 收到 PING，收到回应后更新平滑 RTT / 抖动 (同 TCP 的 SRTT/RTTVAR)，
+// 样本同时计入全服和所在房间的直方图。发 PING 的时刻挂在时间轮上，空闲时不扫连接表。
+// --------------------------------------------------------
+class LatencyMonitor {
+public:
+    explicit LatencyMonitor(long long now);
+
+    // 连接当前所在的房间 (0 表示在大厅)，由主循环接到 RoomManager
+    std::function<int(int fd)> room_of;
+
+    // 收到 PONG；seq 为 0 的是客户端登录后的声明，连接从此加入测量
+    void on_pong(int fd, const PingPacket& pkt, long long now);
+    void remove(int fd);
+
+    // 每轮主循环调用：给到时间的连接发 PING，到点打印统计
+    void update(long long now);
+
+private:
+    struct Conn {
+        int seq;             // 最近一次 PING 的序号
+        long long sent_ms;   // 它的发出时间 (0 表示已回应)
+        long long next_ping;
+        int srtt, rttvar;    // 平滑 RTT 与平均偏差 (毫秒，x8 / x4 定点以免丢精度)
+        bool has_rtt;
+    };
+    std::unordered_map<int, Conn> conns;
+    LatencyHistogram global;
+    std::unordered_map<int, LatencyHistogram> rooms;
+
+    TimerWheel timers;
+    std::vector<TimerEvent> due;
+    long long next_report;
+    unsigned long long lost;  // 本周期内下一次 PING 前没等到回应的次数
+
+    void send_ping(int fd, Conn& c, long long now);
+    void report();
+};
+
+#endif
@@ -223,6 +223,6 @@ public:
     }
 };
 
-int (*MapGenerator::_map)[MAP_SIZE] = nullptr;
+inline int (*MapGenerator::_map)[MAP_SIZE] = nullptr;
 
 #endif
\ No newline at end of file
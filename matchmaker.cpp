@@ -0,0 +1,102 @@
+#include "matchmaker.h"
+#include <algorithm>
+#include <functional>
+
+Matchmaker::Matchmaker() : scan_cursor(-1, -1) {}
+
+bool Matchmaker::add(int fd, int rating, long long now) {
+    if (tickets.count(fd)) return false;
+    Ticket t = { rating, now };
+    tickets[fd] = t;
+    by_rating.insert(RatingKey(rating, fd));
+    by_time.insert(TimeKey(now, fd));
+    return true;
+}
+
+bool Matchmaker::remove(int fd) {
+    auto it = tickets.find(fd);
+    if (it == tickets.end()) return false;
+    by_rating.erase(RatingKey(it->second.rating, fd));
+    by_time.erase(TimeKey(it->second.join_time, fd));
+    tickets.erase(it);
+    return true;
+}
+
+int Matchmaker::window_for(const Ticket& t, long long now) const {
+    long long waited = now - t.join_time;
+    long long w = MATCH_BASE_WINDOW + waited * MATCH_WIDEN_PER_SEC / 1000;
+    return (int)std::min<long long>(w, MATCH_MAX_WINDOW);
+}
+
+void Matchmaker::form_matches(long long now, std::vector<MatchGroup>& out) {
+    int formed = 0;
+    int tried = 0;
+    int budget = std::min<int>(MATCH_ANCHORS_PER_TICK, (int)by_time.size());
+
+    while (tried < budget && formed < MATCH_MAX_PER_TICK && !by_time.empty()) {
+        // 从游标之后继续，到末尾回绕
+        auto it = by_time.upper_bound(scan_cursor);
+        if (it == by_time.end()) it = by_time.begin();
+        scan_cursor = *it;
+        tried++;
+
+        MatchGroup group;
+        if (try_form(it->second, now, group)) {
+            out.push_back(group);
+            formed++;
+        }
+    }
+}
+
+// 以 anchor 为中心，按分差由近到远取人
+bool Matchmaker::try_form(int anchor_fd, long long now, MatchGroup& group) {
+    const Ticket& anchor = tickets[anchor_fd];
+    bool forced = (now - anchor.join_time) >= MATCH_FORCE_START_MS;
+    int window = window_for(anchor, now);
+
+    std::vector<std::pair<int, int>> picked; // (rating, fd)
+    picked.push_back(std::make_pair(anchor.rating, anchor_fd));
+
+    auto center = by_rating.find(RatingKey(anchor.rating, anchor_fd));
+    auto up = std::next(center);
+    auto down = center;
+    bool down_done = (down == by_rating.begin());
+    if (!down_done) --down;
+
+    while ((int)picked.size() < MATCH_ROOM_SIZE) {
+        bool has_up = (up != by_rating.end()) && (forced || up->first - anchor.rating <= window);
+        bool has_down = !down_done && (forced || anchor.rating - down->first <= window);
+        if (!has_up && !has_down) break;
+
+        bool take_up = has_up && (!has_down || up->first - anchor.rating <= anchor.rating - down->first);
+        if (take_up) {
+            picked.push_back(*up);
+            ++up;
+        } else {
+            picked.push_back(*down);
+            if (down == by_rating.begin()) down_done = true;
+            else --down;
+        }
+    }
+
+    // 人不够：没超时就继续等，超时就有多少开多少 (与原来的 10 秒兜底一致)
+    if ((int)picked.size() < MATCH_ROOM_SIZE && !forced) return false;
+
+    for (const auto& m : picked) remove(m.second);
+    group.full = ((int)picked.size() == MATCH_ROOM_SIZE);
+    balance(picked, group);
+    return true;
+}
+
+// 贪心分队：按分数从高到低，依次放进当前总分较低且未满的一队
+void Matchmaker::balance(std::vector<std::pair<int, int>>& members, MatchGroup& group) {
+    std::sort(members.begin(), members.end(), std::greater<std::pair<int, int>>());
+    int cap = ((int)members.size() + 1) / 2;
+    long long sum1 = 0, sum2 = 0;
+    for (const auto& m : members) {
+        bool to_team1 = ((int)group.team1.size() < cap) &&
+                        ((int)group.team2.size() >= cap || sum1 <= sum2);
+        if (to_team1) { group.team1.push_back(m.second); sum1 += m.first; }
+        else          { group.team2.push_back(m.second); sum2 += m.first; }
+    }
+}
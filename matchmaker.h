@@ -0,0 +1,62 @@
+#ifndef MATCHMAKER_H
+#define MATCHMAKER_H
+
+#include <set>
+#include <vector>
+#include <utility>
+#include <unordered_map>
+
+// 匹配参数
+#define MATCH_TEAM_SIZE          5
+#define MATCH_ROOM_SIZE          (MATCH_TEAM_SIZE * 2)
+#define MATCH_BASE_WINDOW        100    // 初始可接受的分差
+#define MATCH_WIDEN_PER_SEC      50     // 每多等 1 秒放宽的分差
+#define MATCH_MAX_WINDOW         1000
+#define MATCH_FORCE_START_MS     10000  // 等待超过该时间，不再看分差，凑到多少人开多少人
+#define MATCH_ANCHORS_PER_TICK   256    // 每帧最多尝试的"发起人"数量，限制主循环上的开销
+#define MATCH_MAX_PER_TICK       64     // 每帧最多组成的房间数
+
+// 一次组队的结果：team1 放前面，team2 放后面
+struct MatchGroup {
+    std::vector<int> team1;
+    std::vector<int> team2;
+    bool full;              // 满 10 人 (否则为超时强制组队)
+};
+
+// --------------------------------------------------------
+// 匹配器
+// 两个有序索引：按分数 (找分差最近的人) 和按入队时间 (老玩家优先、窗口随等待放宽)。
+// 入队/出队 O(log n)；每帧只从上次停下的位置继续扫描有限个发起人。
+// --------------------------------------------------------
+class Matchmaker {
+public:
+    Matchmaker();
+
+    bool add(int fd, int rating, long long now);
+    bool remove(int fd);
+    bool contains(int fd) const { return tickets.count(fd) > 0; }
+    int size() const { return (int)tickets.size(); }
+
+    // 组成本帧能组成的房间 (追加到 out)，被选中的玩家从队列中移除
+    void form_matches(long long now, std::vector<MatchGroup>& out);
+
+private:
+    typedef std::pair<int, int> RatingKey;      // (rating, fd)
+    typedef std::pair<long long, int> TimeKey;  // (join_time, fd)
+
+    struct Ticket {
+        int rating;
+        long long join_time;
+    };
+
+    std::unordered_map<int, Ticket> tickets;
+    std::set<RatingKey> by_rating;
+    std::set<TimeKey> by_time;
+    TimeKey scan_cursor;   // 上一帧扫描到的位置 (轮转，避免总卡在同一批老玩家上)
+
+    int window_for(const Ticket& t, long long now) const;
+    bool try_form(int anchor_fd, long long now, MatchGroup& group);
+    void balance(std::vector<std::pair<int, int>>& members, MatchGroup& group);
+};
+
+#endif
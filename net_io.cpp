@@ -0,0 +1,110 @@
+#include "net_io.h"
+#include "shm_transport.h"
+#include "udp_transport.h"
+#include "protocol.h"
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/sockios.h>
+#include <cerrno>
+#include <unordered_map>
+
+static NetSendHook send_hook;
+static NetStreamWriter stream_writer;
+static NetStreamBacklog stream_backlog;
+
+// 走共享内存的连接 (只在主循环线程访问)
+static std::unordered_map<int, ShmChannel*> shm_conns;
+
+// 战斗流量走 UDP 的连接
+static std::unordered_map<int, UdpSession*> udp_conns;
+
+// 只有开局/结算走 UDP 的可靠通道，其余 (大厅、房间状态) 仍按原顺序走连接本身
+static bool is_udp_reliable(const void* buf, size_t len) {
+    if (len < sizeof(int)) return false;
+    int type = *(const int*)buf;
+    return type == TYPE_GAME_START || type == TYPE_GAME_OVER;
+}
+
+ssize_t net_send(int fd, const void* buf, size_t len, int delivery) {
+    if (send_hook) return send_hook(fd, buf, len, delivery);
+    if (!udp_conns.empty()) {
+        auto it = udp_conns.find(fd);
+        if (it != udp_conns.end()) {
+            if (delivery == NET_SNAPSHOT) {
+                it->second->send_snapshot(buf, len);
+                return (ssize_t)len;
+            }
+            if (is_udp_reliable(buf, len) && it->second->send_reliable(buf, len)) return (ssize_t)len;
+        }
+    }
+    if (!shm_conns.empty()) {
+        auto it = shm_conns.find(fd);
+        if (it != shm_conns.end()) return (ssize_t)it->second->write(buf, len); // 环里放不下整个消息就整个丢弃 (返回 0)
+    }
+    if (stream_writer) return stream_writer(fd, buf, len);
+    return write(fd, buf, len);
+}
+
+ssize_t net_recv(int fd, void* buf, size_t len) {
+    if (!shm_conns.empty()) {
+        auto it = shm_conns.find(fd);
+        if (it != shm_conns.end()) {
+            size_t n = it->second->read(buf, len);
+            if (n == 0) { errno = EAGAIN; return -1; } // 环空与非阻塞 socket 无数据同样处理，0 只表示断开
+            return (ssize_t)n;
+        }
+    }
+    return read(fd, buf, len);
+}
+
+void set_net_send_hook(NetSendHook hook) {
+    send_hook = hook;
+}
+
+void set_net_stream_writer(NetStreamWriter writer) {
+    stream_writer = writer;
+}
+
+void set_net_stream_backlog(NetStreamBacklog backlog) {
+    stream_backlog = backlog;
+}
+
+void net_attach_shm(int fd, ShmChannel* ch) {
+    auto it = shm_conns.find(fd);
+    if (it != shm_conns.end()) delete it->second;
+    shm_conns[fd] = ch;
+}
+
+ShmChannel* net_shm_of(int fd) {
+    if (shm_conns.empty()) return nullptr;
+    auto it = shm_conns.find(fd);
+    return it == shm_conns.end() ? nullptr : it->second;
+}
+
+void net_attach_udp(int fd, UdpSession* s) {
+    udp_conns[fd] = s;
+}
+
+void net_detach_udp(int fd) {
+    udp_conns.erase(fd);
+}
+
+size_t net_send_backlog(int fd) {
+    if (send_hook) return 0;
+    if (!udp_conns.empty() && udp_conns.count(fd)) return 0;
+    if (!shm_conns.empty() && shm_conns.count(fd)) return 0;
+    size_t backlog = stream_backlog ? stream_backlog(fd) : 0;
+    int queued = 0;
+    if (ioctl(fd, SIOCOUTQ, &queued) < 0 || queued < 0) return backlog;
+    return backlog + (size_t)queued;
+}
+
+void net_close(int fd) {
+    udp_conns.erase(fd);
+    auto it = shm_conns.find(fd);
+    if (it != shm_conns.end()) {
+        delete it->second;
+        shm_conns.erase(it);
+    }
+    close(fd);
+}
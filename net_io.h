@@ -0,0 +1,54 @@
+#ifndef NET_IO_H
+#define NET_IO_H
+
+#include <cstddef>
+#include <functional>
+#include <sys/types.h>
+
+class ShmChannel;
+class UdpSession;
+
+// ==========================================
+// 客户端连接的收发统一从这里走
+// - TCP / Unix socket: 直接 read/write(fd)
+// - 共享内存通道: fd 仍是那条 Unix socket (只用来探测断开)，数据走 ShmChannel 的环
+// - UDP 通道: 开局/结算包和快照改走 UdpSession，大厅包仍走 fd
+// - 在房间服务器进程里，发送会被替换成 "打包成内部帧交给网关转发"，
+//   GameRoom 本身不需要知道自己跑在哪里、对面是什么传输。
+// ==========================================
+
+// [新增] 发送语义：快照可以丢，只要最新的那份送到
+#define NET_RELIABLE  0
+#define NET_SNAPSHOT  1
+
+typedef std::function<ssize_t(int fd, const void* buf, size_t len, int delivery)> NetSendHook;
+typedef std::function<ssize_t(int fd, const void* buf, size_t len)> NetStreamWriter;
+typedef std::function<size_t(int fd)> NetStreamBacklog;
+
+ssize_t net_send(int fd, const void* buf, size_t len, int delivery = NET_RELIABLE);
+ssize_t net_recv(int fd, void* buf, size_t len);
+
+// 传空函数恢复为直接 write
+void set_net_send_hook(NetSendHook hook);
+
+// [新增] 最终落到连接本身的写 (默认 write)，io_uring 后端用它把发送攒到一轮统一提交
+void set_net_stream_writer(NetStreamWriter writer);
+// [新增] 上面的 writer 自己攒着、还没写进内核的字节数，计入 net_send_backlog
+void set_net_stream_backlog(NetStreamBacklog backlog);
+
+// [新增] 把连接切换到共享内存通道 (接管 ch 的所有权)
+void net_attach_shm(int fd, ShmChannel* ch);
+ShmChannel* net_shm_of(int fd);
+
+// [新增] 战斗流量改走 UDP 会话 (不接管所有权，会话由 UdpServer 管理)
+void net_attach_udp(int fd, UdpSession* s);
+void net_detach_udp(int fd);
+
+// [新增] 已交给连接、还没发出去的字节数 (I/O 后端里排队的 + 内核发送队列)，快照降级据此判断客户端是否跟不上。
+// 共享内存环和 UDP 快照满了直接丢、不排队，返回 0；在房间服务器里看不到真正的连接，也返回 0
+size_t net_send_backlog(int fd);
+
+// 释放连接的传输资源并 close(fd)
+void net_close(int fd);
+
+#endif
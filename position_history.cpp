@@ -0,0 +1,44 @@
+#include "position_history.h"
+
+PositionHistory::PositionHistory() : entities(LAG_COMP_HISTORY * LAG_COMP_MAX_ENTITIES) {
+    clear();
+}
+
+void PositionHistory::clear() {
+    for (int i = 0; i < LAG_COMP_HISTORY; i++) {
+        times[i] = 0;
+        counts[i] = 0;
+    }
+    head = LAG_COMP_HISTORY - 1;
+    frames = 0;
+}
+
+void PositionHistory::begin_frame(long long time) {
+    head = (head + 1) % LAG_COMP_HISTORY;
+    times[head] = time;
+    counts[head] = 0;
+    if (frames < LAG_COMP_HISTORY) frames++;
+}
+
+void PositionHistory::add(int id, int team, int x, int y) {
+    if (frames == 0 || counts[head] >= LAG_COMP_MAX_ENTITIES) return;
+    HistoryEntity& e = entities[head * LAG_COMP_MAX_ENTITIES + counts[head]++];
+    e.id = id;
+    e.team = team;
+    e.x = x;
+    e.y = y;
+}
+
+// 从最新一帧往回找
+const HistoryEntity* PositionHistory::frame_at(long long time, int* count) const {
+    *count = 0;
+    if (frames == 0) return nullptr;
+
+    int idx = head;
+    for (int i = 0; i < frames; i++) {
+        idx = (head - i + LAG_COMP_HISTORY) % LAG_COMP_HISTORY;
+        if (times[idx] <= time) break;
+    }
+    *count = counts[idx];
+    return &entities[idx * LAG_COMP_MAX_ENTITIES];
+}
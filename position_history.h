@@ -0,0 +1,45 @@
+#ifndef POSITION_HISTORY_H
+#define POSITION_HISTORY_H
+
+#include <vector>
+
+// 延迟补偿参数：保留 8 帧 (约 260ms)，每帧最多记 512 个会移动的实体
+#define LAG_COMP_HISTORY       8
+#define LAG_COMP_MAX_ENTITIES  512
+#define LAG_COMP_MAX_MS        200  // 最多回退这么久 (超出的按 200ms 算)
+#define LAG_COMP_MAX_DRIFT_SQ  25   // 回退时的位置与当前位置相距超过 5 格 (复活/闪现) 的不算
+
+// 某一帧里一个实体的位置
+struct HistoryEntity {
+    int id;
+    int team;
+    int x, y;
+};
+
+// --------------------------------------------------------
+// 实体位置历史 (环形缓冲)
+// 每帧模拟结束时记一份会移动的实体 (英雄、小兵) 的位置，攻击判定可以回到
+// 攻击者当时看到的那一帧。所有空间在构造时一次分配，记录与查询都不分配内存。
+// --------------------------------------------------------
+class PositionHistory {
+public:
+    PositionHistory();
+
+    void clear();
+
+    // 记录一帧：begin_frame 之后逐个 add (超出容量的不记)
+    void begin_frame(long long time);
+    void add(int id, int team, int x, int y);
+
+    // 取时间不晚于 time 的最近一帧 (比最旧的还早就返回最旧的)；一帧都没有返回 nullptr
+    const HistoryEntity* frame_at(long long time, int* count) const;
+
+private:
+    std::vector<HistoryEntity> entities;  // LAG_COMP_HISTORY 段，每段 LAG_COMP_MAX_ENTITIES 个
+    long long times[LAG_COMP_HISTORY];
+    int counts[LAG_COMP_HISTORY];
+    int head;    // 最新一帧所在的段
+    int frames;  // 已记录的帧数 (不超过 LAG_COMP_HISTORY)
+};
+
+#endif
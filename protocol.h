@@ -66,6 +66,8 @@
 #define TYPE_LOGIN_RESP     11
 #define TYPE_REG_REQ        12
 #define TYPE_REG_RESP       13
+#define TYPE_TRANSPORT_SHM  14 // [新增] Unix socket 连接申请改走共享内存环 (见 shm_transport.h)
+#define TYPE_TRANSPORT_UDP  15 // [新增] 登录后申请 UDP 战斗通道 (见 udp_transport.h)
 
 // 大厅/房间管理
 #define TYPE_ROOM_LIST_REQ  20
@@ -76,13 +78,31 @@
 #define TYPE_MATCH_REQ      25
 #define TYPE_ROOM_UPDATE    26 
 #define TYPE_GAME_START     27 
+#define TYPE_ROOM_PAGE_REQ  28 // [新增] 分页/过滤拉取房间目录，并订阅该页的增量推送
+#define TYPE_ROOM_PAGE_RESP 29 // [新增] 房间目录的一页
+#define TYPE_ROOM_DELTA     31 // [新增] 订阅页内房间的增量变更 (服务器主动推送)
+#define TYPE_SPECTATE       32 // [新增] 观战请求/应答；room_id 为 0 表示退出观战 (房间关闭时服务器也会推一个)
+
+#define SPECTATE_MAX_DELAY_SEC 60 // [新增] 观战最多延迟多少秒
+
+// [新增] 房间目录过滤条件
+#define ROOM_FILTER_ALL      0  // 全部房间
+#define ROOM_FILTER_OPEN     1  // 等待中且有空位
+#define ROOM_FILTER_PLAYING  2  // 选人/游戏中
+#define ROOM_FILTER_COUNT    3
+
+#define ROOM_PAGE_SIZE       10
+#define ROOM_DELTA_MAX       4  // 一个增量包最多携带的变更条数，更多时直接重发整页
+#define ROOM_DELTA_UPSERT    1
+#define ROOM_DELTA_REMOVE    2
 
 // 游戏逻辑
-#define TYPE_MOVE           1
+#define TYPE_MOVE           1  // [修改] extra 为客户端递增的移动序号，快照里本人那条的 extra 回给已执行到的序号
 #define TYPE_UPDATE         2  
 #define TYPE_SELECT         3  
-#define TYPE_FRAME          4  
-#define TYPE_ATTACK         5  
+#define TYPE_FRAME          4  // 一帧结束：extra 为对局秒数，[新增] input 为开局以来的服务器毫秒数 (插值用的时间戳)，
+                               // [新增] id 非 0 为降级后的部分帧 (值为等级)，没出现的实体沿用上一帧
+#define TYPE_ATTACK         5  // [修改] extra 为客户端画面对应的服务器时间 (同 TYPE_FRAME 的 input)，服务器按它回退做延迟补偿
 #define TYPE_SPELL          6  // 通用回血技能 (K键)
 #define TYPE_EFFECT         7  
 #define TYPE_BUY_ITEM       30 
@@ -92,11 +112,38 @@
 #define TYPE_SKILL_U        50 // 法师连锁技能 / 其他英雄技能1
 #define TYPE_SKILL_I        51 // 法师闪现 / 其他英雄技能2
 
+// [新增] 帧同步 (lockstep) 模式
+// 选英雄时 TYPE_SELECT 的 extra 填 LOCKSTEP_CAPABLE 表示客户端能在本地跑同一份 GameRoom；
+// 服务器开了 --lockstep 时，这些玩家开局收到 LockstepStartPacket 和之后每帧的输入包；
+// 客户端开好本地副本后回 TYPE_LOCKSTEP_READY (GamePacket)，服务器从此不再给他发快照
+// (开局包走 UDP 时可能晚于 LockstepStartPacket 到达，客户端要先攒着)。
+// 客户端发现状态哈希对不上就发 TYPE_LOCKSTEP_DESYNC (GamePacket)，退回快照。
+#define TYPE_LOCKSTEP_START  33
+#define TYPE_LOCKSTEP_TICK   34
+#define TYPE_LOCKSTEP_DESYNC 35
+#define TYPE_LOCKSTEP_READY  39
+
+#define LOCKSTEP_CAPABLE       1
+#define LOCKSTEP_TICK_MS       33           // 逻辑帧长，双方都按帧号推算时间
+#define LOCKSTEP_EPOCH_MS      1000000000LL // 第 0 帧的逻辑时间 (足够大，冷却判断与实时模式一致)
+#define LOCKSTEP_HASH_INTERVAL 15           // 每隔多少帧附带一次状态哈希
+#define LOCKSTEP_MAX_INPUTS    64           // 每帧最多转发的输入，超出的直接丢弃 (双方一致)
+#define LOCKSTEP_MAX_ENTRIES   (LOCKSTEP_MAX_INPUTS + 10) // 再加上本帧离开的玩家
+
+// [新增] 延迟测量：服务器定时发 PING (带服务器单调时间)，客户端立即原样回 PONG 并填上自己的单调时间。
+// 登录后客户端先主动发一个 seq 为 0 的 PONG 表示支持，服务器之后才会给它发 PING (机器人/旧客户端不受影响)。
+#define TYPE_PING            36
+#define TYPE_PONG            37
+
+// [新增] 服务器过载，刚才的大厅请求 (匹配/建房/翻页等) 没有处理，稍后重试。只有类型字段。
+#define TYPE_SERVER_BUSY     38
+
 // --- 返回码 ---
 #define RET_SUCCESS      0
 #define RET_FAIL_DUP     1
 #define RET_FAIL_PWD     2
 #define RET_FAIL_NONAME  3
+#define RET_FAIL_BUSY    4  // [新增] 服务器过载，拒绝新连接/登录
 
 // --- 特效状态 ---
 #define EFFECT_NONE  0
@@ -127,6 +174,22 @@ struct LoginResponsePacket {
     int user_id;
 };
 
+// [新增] 共享内存通道应答 (随包用 SCM_RIGHTS 附带 memfd、c2s/s2c 两个 eventfd)
+struct TransportShmPacket {
+    int type;
+    int result;      // RET_SUCCESS / 失败 (非 Unix 连接或资源不足)
+    int ring_bytes;  // 每个方向的环大小
+};
+
+// [新增] UDP 通道应答：客户端用 conn_id/token 从自己的 UDP socket 发 HELLO 完成绑定
+struct TransportUdpPacket {
+    int type;
+    int result;      // RET_SUCCESS / 失败 (服务器未开 UDP 或未登录)
+    int port;
+    unsigned int conn_id;
+    unsigned int token;
+};
+
 // 2. 房间信息
 struct RoomInfo {
     int room_id;
@@ -142,6 +205,47 @@ struct RoomListPacket {
     RoomInfo rooms[10]; 
 };
 
+// [新增] 分页请求：subscribe=1 时之后该页的变化会以 RoomDeltaPacket 推送过来
+struct RoomPageRequest {
+    int type;
+    int filter;
+    int page;
+    int subscribe;
+};
+
+struct RoomPagePacket {
+    int type;
+    int filter;
+    int page;         // 实际返回的页号 (越界请求会被夹到最后一页)
+    int total_pages;
+    int total_rooms;  // 满足过滤条件的房间总数
+    unsigned int version; // 目录版本号
+    int count;
+    RoomInfo rooms[ROOM_PAGE_SIZE];
+};
+
+struct RoomDeltaEntry {
+    int op;        // ROOM_DELTA_UPSERT / ROOM_DELTA_REMOVE
+    RoomInfo info; // REMOVE 时只有 room_id 有效
+};
+
+struct RoomDeltaPacket {
+    int type;
+    unsigned int version;
+    int total_pages;  // 过滤结果的页数/房间数也可能变化，一并带上
+    int total_rooms;
+    int count;
+    RoomDeltaEntry entries[ROOM_DELTA_MAX];
+};
+
+// [新增] 观战 (双向同一个结构)
+struct SpectatePacket {
+    int type;
+    int room_id;    // 0 = 退出观战
+    int delay_sec;  // 延迟观看 (0..SPECTATE_MAX_DELAY_SEC)，应答里是实际生效的值
+    int result;     // 应答: RET_SUCCESS / RET_FAIL_DUP (在房间或匹配中) / RET_FAIL_NONAME (房间不存在)
+};
+
 // 3. 房间详细状态
 struct RoomSlot {
     int is_taken;
@@ -203,6 +307,60 @@ struct GameOverPacket {
     PlayerResult results[10];
 };
 
+// 7. [新增] 帧同步
+struct LockstepPlayer {
+    int fd;         // 服务器侧的玩家标识，输入包按它区分玩家
+    int id;
+    int hero_id;
+    int color;
+    int room_slot;
+    char name[32];
+};
+
+struct LockstepStartPacket {
+    int type;
+    int room_id;
+    int self_fd;        // 收包玩家自己的 fd
+    unsigned int seed;  // 房间随机数种子
+    int next_id;        // 房间实体 ID 计数器
+    int player_count;
+    LockstepPlayer players[10];
+};
+
+// 一帧的输入：先是本帧离开的玩家 (type = TYPE_LEAVE_ROOM)，再按到达顺序排列的操作
+struct LockstepInput {
+    int fd;
+    int type;
+    int x, y;
+    int input;
+    int extra;  // 移动序号 (客户端预测用)
+};
+
+// 变长：头部之后紧跟 count 个 LockstepInput
+struct LockstepTickPacket {
+    int type;
+    int tick;
+    int has_hash;
+    unsigned int hash;  // 本帧模拟结束后的状态哈希 (has_hash 为 1 时有效)
+    int count;
+};
+
+inline size_t lockstep_tick_size(int count) {
+    return sizeof(LockstepTickPacket) + (size_t)count * sizeof(LockstepInput);
+}
+
+// [新增] PING / PONG 共用；PING 顺带把服务器测得的该连接延迟发给客户端显示
+struct PingPacket {
+    int type;
+    int seq;
+    long long server_ms;   // 服务器发出 PING 时的单调时间 (PONG 原样带回)
+    long long client_ms;   // PONG: 客户端收到 PING 时的单调时间
+    int rtt_ms;            // PING: 平滑 RTT (-1 表示还没有样本)
+    int jitter_ms;         // PING: RTT 的平均偏差
+    int room_p95_ms;       // PING: 所在房间最近一个统计周期的 95 分位 (-1 表示无)
+    int global_p95_ms;     // PING: 全服最近一个统计周期的 95 分位 (-1 表示无)
+};
+
 // ==========================================
 // [Part 3] 数值平衡配置
 // ==========================================
@@ -0,0 +1,268 @@
+#include "reactor_pool.h"
+#include "epoll_backend.h"
+#include "idle_reaper.h"
+#include "admission_control.h"
+#include "protocol.h"
+#include <iostream>
+#include <chrono>
+#include <cstring>
+#include <unordered_map>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+// 还没交出去的连接
+struct PendingConn {
+    std::string buf;    // 未解析的字节
+    long long opened;   // accept 的时间
+    AdmitBucket login;  // 登录/注册包限速
+};
+
+struct ReactorPool::Reactor {
+    int index;
+    int listen_fd;
+    int stop_fd;
+    IoBackend* io;                              // 在 reactor 线程里创建和使用
+    std::unordered_map<int, PendingConn> conns;
+    IdleReaper* reaper;                         // 只在 reactor 线程里用
+    std::thread th;
+};
+
+static long long get_current_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 每个 reactor 一个监听 socket，SO_REUSEPORT 让内核按连接分散到各个 socket
+static int reuseport_listen(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (fd < 0) return -1;
+    int opt = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt));
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = INADDR_ANY;
+    address.sin_port = htons(port);
+    if (bind(fd, (sockaddr*)&address, sizeof(address)) < 0 || listen(fd, 1024) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void send_auth_reply(int fd, int type, int result) {
+    LoginResponsePacket resp;
+    memset(&resp, 0, sizeof(resp));
+    resp.type = type;
+    resp.result = result;
+    resp.user_id = fd;
+    if (write(fd, &resp, sizeof(resp)) < 0) {} // 写失败由读那边发现断开
+}
+
+ReactorPool::ReactorPool(UserManager* um)
+    : user_mgr(um), stopping(false), overloaded(false), held(0), pending_main(0), n_rejected(0), n_throttled(0), n_shed(0) {
+    efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (efd < 0) perror("[Reactor] eventfd failed");
+}
+
+ReactorPool::~ReactorPool() {
+    stopping = true;
+    uint64_t one = 1;
+    for (Reactor* r : reactors) {
+        if (write(r->stop_fd, &one, sizeof(one)) < 0) {}
+    }
+    for (Reactor* r : reactors) {
+        if (r->th.joinable()) r->th.join();
+        close(r->listen_fd);
+        close(r->stop_fd);
+        delete r;
+    }
+    for (ConnHandoff& h : done) close(h.fd);
+    if (efd >= 0) close(efd);
+}
+
+bool ReactorPool::start(int port, int n) {
+    if (n > REACTOR_MAX_THREADS) n = REACTOR_MAX_THREADS;
+    for (int i = 0; i < n; i++) {
+        int lfd = reuseport_listen(port);
+        if (lfd < 0) {
+            perror("[Reactor] listen failed");
+            for (Reactor* r : reactors) { close(r->listen_fd); close(r->stop_fd); delete r; }
+            reactors.clear();
+            return false;
+        }
+        Reactor* r = new Reactor();
+        r->index = i;
+        r->listen_fd = lfd;
+        r->stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        r->io = nullptr;
+        r->reaper = nullptr;
+        reactors.push_back(r);
+    }
+    // 监听 socket 全部建好再起线程，避免早到的连接都落在前几个 socket 上
+    for (Reactor* r : reactors) r->th = std::thread(&ReactorPool::run, this, r);
+    std::cout << "[Reactor] " << n << " accept reactors on port " << port << std::endl;
+    return true;
+}
+
+void ReactorPool::take_counts(unsigned long long& rejected_conns, unsigned long long& throttled_logins,
+                              unsigned long long& shed_logins) {
+    rejected_conns = n_rejected.exchange(0);
+    throttled_logins = n_throttled.exchange(0);
+    shed_logins = n_shed.exchange(0);
+}
+
+void ReactorPool::drain(std::vector<ConnHandoff>& out) {
+    uint64_t cnt;
+    while (read(efd, &cnt, sizeof(cnt)) > 0) {}
+
+    std::lock_guard<std::mutex> lock(done_mtx);
+    for (ConnHandoff& h : done) out.push_back(std::move(h));
+    done.clear();
+}
+
+void ReactorPool::run(Reactor* r) {
+    EpollBackend io;
+    IdleReaper reaper(get_current_ms());
+    r->io = &io;
+    r->reaper = &reaper;
+
+    IoHandlers handlers;
+    handlers.on_accept = [this, r](int listen_fd, int fd) {
+        (void)listen_fd;
+        // [新增] 准入：主循环过载或握手中的连接太多时回一个忙就关掉
+        if (overloaded || held + pending_main >= ADMIT_MAX_PENDING) {
+            send_auth_reply(fd, TYPE_LOGIN_RESP, RET_FAIL_BUSY);
+            close(fd);
+            n_rejected++;
+            return;
+        }
+        long long now = get_current_ms();
+        PendingConn& c = r->conns[fd];
+        c.opened = now;
+        c.login.reset(ADMIT_LOGIN_BURST, now);
+        held++;
+        r->io->add_stream(fd);
+        r->reaper->add(fd, now); // 握手/登录的截止时间从 accept 起算
+    };
+    handlers.on_data = [this, r](int fd, const char* data, int len) {
+        r->reaper->on_data(fd, get_current_ms());
+        on_bytes(r, fd, data, len);
+    };
+    handlers.on_closed = [this, r](int fd) {
+        drop(r, fd);
+    };
+    handlers.on_readable = [](int fd) { (void)fd; }; // 只有 stop_fd
+    io.set_handlers(handlers);
+
+    io.add_listener(r->listen_fd);
+    io.add_watch(r->stop_fd);
+    std::vector<int> expired;
+    while (!stopping) {
+        io.poll(REACTOR_REAP_MS);
+
+        // 连上后不发数据、或迟迟不登录的连接在这里关掉，不占着 reactor
+        expired.clear();
+        reaper.collect(get_current_ms(), expired);
+        for (int fd : expired) drop(r, fd);
+    }
+
+    for (auto& kv : r->conns) {
+        io.remove(kv.first);
+        close(kv.first);
+    }
+    held -= (int)r->conns.size();
+    r->conns.clear();
+    r->io = nullptr;
+    r->reaper = nullptr;
+}
+
+void ReactorPool::drop(Reactor* r, int fd) {
+    r->io->remove(fd);
+    r->reaper->remove(fd);
+    if (r->conns.erase(fd)) held--;
+    close(fd);
+}
+
+// 登录前的包只认注册/登录；校验通过 (或来了别的包) 就把连接交出去
+void ReactorPool::on_bytes(Reactor* r, int fd, const char* data, int len) {
+    auto it = r->conns.find(fd);
+    if (it == r->conns.end()) return;
+    std::string& buf = it->second.buf;
+    buf.append(data, len);
+
+    size_t ptr = 0;
+    while (buf.size() - ptr >= sizeof(int)) {
+        int type;
+        memcpy(&type, buf.data() + ptr, sizeof(type));
+        if (type != TYPE_LOGIN_REQ && type != TYPE_REG_REQ) {
+            buf.erase(0, ptr);
+            hand_off(r, fd, false, nullptr);
+            return;
+        }
+        if (buf.size() - ptr < sizeof(LoginPacket)) break;
+
+        LoginPacket pkt;
+        memcpy(&pkt, buf.data() + ptr, sizeof(pkt));
+        ptr += sizeof(pkt);
+        std::string username(pkt.username, strnlen(pkt.username, sizeof(pkt.username)));
+        std::string password(pkt.password, strnlen(pkt.password, sizeof(pkt.password)));
+
+        // [新增] 与主循环同样的准入规则：过载时回"忙"，超过登录速率的直接丢弃
+        int resp_type = (type == TYPE_REG_REQ ? TYPE_REG_RESP : TYPE_LOGIN_RESP);
+        if (overloaded) {
+            send_auth_reply(fd, resp_type, RET_FAIL_BUSY);
+            n_shed++;
+            continue;
+        }
+        if (!it->second.login.take(ADMIT_LOGIN_RATE, ADMIT_LOGIN_BURST, get_current_ms())) {
+            n_throttled++;
+            continue;
+        }
+
+        if (type == TYPE_REG_REQ) {
+            int ret = user_mgr->register_user(username, password);
+            if (ret == RET_SUCCESS) r->reaper->on_authed(fd); // 与主循环一致：注册成功也算通过
+            send_auth_reply(fd, resp_type, ret);
+            continue;
+        }
+        int ret = user_mgr->check_password(username, password);
+        if (ret != RET_SUCCESS) {
+            send_auth_reply(fd, resp_type, ret);
+            continue;
+        }
+        buf.erase(0, ptr);
+        hand_off(r, fd, true, username.c_str());
+        return;
+    }
+    buf.erase(0, ptr);
+}
+
+// 从本线程的 epoll 摘下，连同剩余字节交给主循环 (期间到达的数据留在 socket 里，主循环注册后再读)
+void ReactorPool::hand_off(Reactor* r, int fd, bool authed, const char* username) {
+    ConnHandoff h;
+    h.fd = fd;
+    h.authed = authed;
+    memset(h.username, 0, sizeof(h.username));
+    if (username) strncpy(h.username, username, sizeof(h.username) - 1);
+    PendingConn& c = r->conns[fd];
+    h.accepted_ms = c.opened;
+    h.pending.swap(c.buf);
+    r->io->remove(fd);
+    r->reaper->remove(fd);
+    r->conns.erase(fd);
+    held--;
+
+    {
+        std::lock_guard<std::mutex> lock(done_mtx);
+        done.push_back(std::move(h));
+    }
+    uint64_t one = 1;
+    if (write(efd, &one, sizeof(one)) < 0) perror("[Reactor] eventfd write failed");
+}
@@ -0,0 +1,78 @@
+#ifndef REACTOR_POOL_H
+#define REACTOR_POOL_H
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include "user_manager.h"
+
+#define REACTOR_MAX_THREADS 16
+#define REACTOR_BUF_SIZE    10240 // 与主循环的连接缓冲一致
+#define REACTOR_REAP_MS     500   // 没有事件时也隔这么久醒一次，回收超时的连接
+
+// 交给主循环的连接
+struct ConnHandoff {
+    int fd;
+    bool authed;          // 前端已校验过密码，主循环只需 mark_online 并回登录结果
+    char username[32];
+    long long accepted_ms; // reactor accept 的时间，主循环接着按它算登录超时
+    std::string pending;  // 前端已读到、还没处理的字节 (紧跟登录之后的包)
+};
+
+// --------------------------------------------------------
+// 接入前端：N 个 reactor 线程，各自一个 SO_REUSEPORT 监听 socket + 一个 epoll
+// 内核按连接把新连接分散到各个监听 socket 上，accept 和登录前的读/校验
+// (注册、密码检查) 在各线程并行完成，重连潮不会堵在游戏主循环上。
+// 登录通过后把连接连同已读到的后续字节交给主循环 —— 所有房间 (或到房间服务器的路由)
+// 都在主循环线程上，它就是玩家房间的所属线程。
+// 登录前就发来其它包的连接 (大厅、传输切换) 直接交给主循环，保持原有行为。
+// 还没交出去的连接由各 reactor 自己的 IdleReaper 按握手/登录超时回收。
+// 准入规则与主循环一致：过载或握手中的连接太多时拒绝新连接，登录/注册包按连接限速，过载时回"忙"。
+// --------------------------------------------------------
+class ReactorPool {
+public:
+    explicit ReactorPool(UserManager* um);
+    ~ReactorPool();
+
+    // 在 port 上起 n 个 reactor；任何一个监听 socket 建不起来就返回 false
+    bool start(int port, int n);
+    int size() const { return (int)reactors.size(); }
+
+    // 有连接交接过来时可读 (注册到主循环)
+    int event_fd() const { return efd; }
+    void drain(std::vector<ConnHandoff>& out);
+
+    // [新增] 主循环每帧发布是否过载、它那边还在握手/登录阶段的连接数 (与 reactor 手里的合计封顶)
+    void set_admission(bool overload, int main_pending) {
+        overloaded = overload;
+        pending_main = main_pending;
+    }
+    int pending() const { return held; }
+    // 取走 reactor 里拒绝的连接数、限速/回"忙"的登录包数 (并清零)，计入主循环的统计
+    void take_counts(unsigned long long& rejected_conns, unsigned long long& throttled_logins,
+                     unsigned long long& shed_logins);
+
+private:
+    struct Reactor;
+
+    UserManager* user_mgr;
+    int efd;
+    std::atomic<bool> stopping;
+    std::atomic<bool> overloaded;
+    std::atomic<int> held;  // 各 reactor 手里还没交出去的连接数
+    std::atomic<int> pending_main;
+    std::atomic<unsigned long long> n_rejected, n_throttled, n_shed;
+    std::vector<Reactor*> reactors;
+
+    std::mutex done_mtx;
+    std::vector<ConnHandoff> done;
+
+    void run(Reactor* r);
+    void on_bytes(Reactor* r, int fd, const char* data, int len);
+    void hand_off(Reactor* r, int fd, bool authed, const char* username);
+    void drop(Reactor* r, int fd);
+};
+
+#endif
@@ -0,0 +1,94 @@
+#include "remote_room_node.h"
+#include "net_io.h"
+#include <cstring>
+
+RemoteRoomNode::RemoteRoomNode(const std::string& addr, int sock, const RoomEvents& events, ClientDataFn client_data)
+    : addr(addr), link(sock), events(events), client_data(client_data), hosted_rooms(0) {
+    memset(&load, 0, sizeof(load));
+}
+
+void RemoteRoomNode::create_room(int room_id, const std::string& owner_name) {
+    ClusterCreateRoom msg;
+    memset(&msg, 0, sizeof(msg));
+    strncpy(msg.owner_name, owner_name.c_str(), sizeof(msg.owner_name) - 1);
+    link.send(CMD_CREATE_ROOM, room_id, 0, &msg, sizeof(msg));
+    hosted_rooms++;
+}
+
+void RemoteRoomNode::join_room(int room_id, int fd, const std::string& name, int slot, bool ready) {
+    ClusterJoinRoom msg;
+    memset(&msg, 0, sizeof(msg));
+    strncpy(msg.name, name.c_str(), sizeof(msg.name) - 1);
+    msg.slot = slot;
+    msg.ready = ready ? 1 : 0;
+    link.send(CMD_JOIN_ROOM, room_id, fd, &msg, sizeof(msg));
+}
+
+void RemoteRoomNode::leave_room(int room_id, int fd) {
+    link.send(CMD_LEAVE_ROOM, room_id, fd, nullptr, 0);
+}
+
+void RemoteRoomNode::start_game(int room_id, int fd) {
+    link.send(CMD_START_GAME, room_id, fd, nullptr, 0);
+}
+
+void RemoteRoomNode::room_control(int room_id, int fd, const RoomControlPacket& pkt) {
+    link.send(CMD_ROOM_CONTROL, room_id, fd, &pkt, sizeof(pkt));
+}
+
+void RemoteRoomNode::game_packet(int room_id, int fd, const GamePacket& pkt) {
+    link.send(CMD_GAME_PACKET, room_id, fd, &pkt, sizeof(pkt));
+}
+
+void RemoteRoomNode::set_watched(int room_id, bool watched) {
+    int v = watched ? 1 : 0;
+    link.send(CMD_WATCH_ROOM, room_id, 0, &v, sizeof(v));
+}
+
+void RemoteRoomNode::update() {
+    link.flush();
+}
+
+bool RemoteRoomNode::on_readable() {
+    return link.receive([this](const ClusterFrame& hdr, const char* payload) { dispatch(hdr, payload); });
+}
+
+void RemoteRoomNode::dispatch(const ClusterFrame& hdr, const char* payload) {
+    switch (hdr.kind) {
+        case EVT_CLIENT_DATA:
+            if (client_data) client_data(this, hdr.client_fd, payload, hdr.len, NET_RELIABLE);
+            break;
+        case EVT_CLIENT_SNAPSHOT:
+            if (client_data) client_data(this, hdr.client_fd, payload, hdr.len, NET_SNAPSHOT);
+            break;
+        case EVT_JOIN_RESULT:
+            if (hdr.len >= (int)sizeof(int) && events.join_result) {
+                events.join_result(hdr.room_id, hdr.client_fd, *(const int*)payload != 0);
+            }
+            break;
+        case EVT_ROOM_INFO:
+            if (hdr.len >= (int)sizeof(RoomInfo) && events.room_info) {
+                RoomInfo info;
+                memcpy(&info, payload, sizeof(info));
+                events.room_info(info);
+            }
+            break;
+        case EVT_ROOM_CLOSED:
+            hosted_rooms--;
+            if (events.room_closed) events.room_closed(hdr.room_id);
+            break;
+        case EVT_GAME_OVER:
+            if (hdr.len >= (int)sizeof(GameOverPacket) && events.game_over) {
+                GameOverPacket res;
+                memcpy(&res, payload, sizeof(res));
+                events.game_over(res);
+            }
+            break;
+        case EVT_ROOM_FRAME:
+            if (events.room_frame) events.room_frame(hdr.room_id, payload, hdr.len);
+            break;
+        case EVT_LOAD:
+            if (hdr.len >= (int)sizeof(ClusterLoad)) memcpy(&load, payload, sizeof(load));
+            break;
+    }
+}
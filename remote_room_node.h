@@ -0,0 +1,49 @@
+#ifndef REMOTE_ROOM_NODE_H
+#define REMOTE_ROOM_NODE_H
+
+#include <string>
+#include <functional>
+#include "room_backend.h"
+#include "cluster_link.h"
+
+// --------------------------------------------------------
+// 网关侧的房间服务器代理
+// 调用被打包成内部帧，房间服务器的事件和发给客户端的数据从 on_readable 回来。
+// --------------------------------------------------------
+class RemoteRoomNode : public RoomBackend {
+public:
+    typedef std::function<void(RoomBackend* from, int fd, const char* data, int len, int delivery)> ClientDataFn;
+
+    RemoteRoomNode(const std::string& addr, int sock, const RoomEvents& events, ClientDataFn client_data);
+
+    void create_room(int room_id, const std::string& owner_name) override;
+    void join_room(int room_id, int fd, const std::string& name, int slot, bool ready) override;
+    void leave_room(int room_id, int fd) override;
+    void start_game(int room_id, int fd) override;
+    void room_control(int room_id, int fd, const RoomControlPacket& pkt) override;
+    void game_packet(int room_id, int fd, const GamePacket& pkt) override;
+    void set_watched(int room_id, bool watched) override;
+    void update() override;
+
+    int room_count() const override { return hosted_rooms; }
+    int tick_cost_us() const override { return load.tick_us; }
+
+    int fd() const { return link.fd(); }
+    const std::string& address() const { return addr; }
+
+    // 连接可读时调用；返回 false 表示房间服务器已断开
+    bool on_readable();
+    bool flush() { return link.flush(); }
+
+private:
+    std::string addr;
+    ClusterLink link;
+    RoomEvents events;
+    ClientDataFn client_data;
+    int hosted_rooms;   // 网关自己记账：建房 +1，收到关闭 -1，不受上报延迟影响
+    ClusterLoad load;   // 最近一次上报
+
+    void dispatch(const ClusterFrame& hdr, const char* payload);
+};
+
+#endif
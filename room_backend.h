@@ -0,0 +1,45 @@
+#ifndef ROOM_BACKEND_H
+#define ROOM_BACKEND_H
+
+#include <string>
+#include <functional>
+#include "protocol.h"
+
+// ==========================================
+// 房间后端：真正承载 GameRoom 的地方
+// RoomHost 在本进程内跑房间；RemoteRoomNode 把同样的调用打包发给房间服务器进程。
+// RoomManager (大厅/匹配) 只通过这个接口操作房间，结果以 RoomEvents 异步回来。
+// ==========================================
+
+struct RoomEvents {
+    std::function<void(const RoomInfo& info)> room_info;          // 大厅可见信息变化
+    std::function<void(int room_id)> room_closed;                 // 房间已空并回收
+    std::function<void(int room_id, int fd, bool ok)> join_result;
+    std::function<void(const GameOverPacket& result)> game_over;
+    // [新增] 被观战房间每帧编码好的整帧 / 结算包 (只在 set_watched 打开后才有)
+    std::function<void(int room_id, const char* data, int len)> room_frame;
+};
+
+class RoomBackend {
+public:
+    virtual ~RoomBackend() {}
+
+    virtual void create_room(int room_id, const std::string& owner_name) = 0;
+    // slot 为 -1 时自动分配座位
+    virtual void join_room(int room_id, int fd, const std::string& name, int slot, bool ready) = 0;
+    virtual void leave_room(int room_id, int fd) = 0;
+    virtual void start_game(int room_id, int fd) = 0;
+    virtual void room_control(int room_id, int fd, const RoomControlPacket& pkt) = 0;
+    virtual void game_packet(int room_id, int fd, const GamePacket& pkt) = 0;
+    // [新增] 打开/关闭该房间的 room_frame 输出 (有人观战时才打开)
+    virtual void set_watched(int room_id, bool watched) = 0;
+
+    // 每帧调用：本地后端推进房间逻辑，远端后端把缓冲的命令写出去
+    virtual void update() = 0;
+
+    // 放置新房间时参考的负载
+    virtual int room_count() const = 0;
+    virtual int tick_cost_us() const = 0;
+};
+
+#endif
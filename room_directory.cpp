@@ -0,0 +1,130 @@
+#include "room_directory.h"
+#include <algorithm>
+#include <cstring>
+
+RoomDirectory::RoomDirectory() : ver(0) {
+    for (int f = 0; f < ROOM_FILTER_COUNT; f++) filter_dirty[f] = false;
+}
+
+bool RoomDirectory::matches(const RoomInfo& info, int filter) {
+    switch (filter) {
+        case ROOM_FILTER_OPEN:
+            return info.status == ROOM_STATUS_WAITING && info.player_count < info.max_player;
+        case ROOM_FILTER_PLAYING:
+            return info.status != ROOM_STATUS_WAITING;
+        default:
+            return true;
+    }
+}
+
+void RoomDirectory::upsert(const RoomInfo& info) {
+    auto it = rooms.find(info.room_id);
+    if (it != rooms.end() && memcmp(&it->second, &info, sizeof(RoomInfo)) == 0) return;
+
+    for (int f = 0; f < ROOM_FILTER_COUNT; f++) {
+        bool was = (it != rooms.end()) && matches(it->second, f);
+        bool now = matches(info, f);
+        if (was && now) touch_id(f, info.room_id);
+        else if (was) erase_id(f, info.room_id);
+        else if (now) insert_id(f, info.room_id);
+    }
+
+    rooms[info.room_id] = info;
+    changed.insert(info.room_id);
+    ver++;
+}
+
+void RoomDirectory::remove(int room_id) {
+    auto it = rooms.find(room_id);
+    if (it == rooms.end()) return;
+
+    for (int f = 0; f < ROOM_FILTER_COUNT; f++) {
+        if (matches(it->second, f)) erase_id(f, room_id);
+    }
+    rooms.erase(it);
+    changed.insert(room_id);
+    ver++;
+}
+
+const RoomInfo* RoomDirectory::find(int room_id) const {
+    auto it = rooms.find(room_id);
+    return it == rooms.end() ? nullptr : &it->second;
+}
+
+int RoomDirectory::total_rooms(int filter) const {
+    return (int)ids[filter].size();
+}
+
+int RoomDirectory::total_pages(int filter) const {
+    int n = (int)ids[filter].size();
+    return n == 0 ? 1 : (n + ROOM_PAGE_SIZE - 1) / ROOM_PAGE_SIZE;
+}
+
+const RoomPagePacket& RoomDirectory::get_page(int filter, int page) {
+    if (filter < 0 || filter >= ROOM_FILTER_COUNT) filter = ROOM_FILTER_ALL;
+    int pages = total_pages(filter);
+    if (page < 0) page = 0;
+    if (page >= pages) page = pages - 1;
+
+    std::vector<CachedPage>& pc = cache[filter];
+    if ((int)pc.size() < pages) pc.resize(pages, CachedPage{ false, RoomPagePacket() });
+
+    CachedPage& c = pc[page];
+    if (!c.valid) {
+        memset(&c.pkt, 0, sizeof(c.pkt));
+        c.pkt.type = TYPE_ROOM_PAGE_RESP;
+        c.pkt.filter = filter;
+        c.pkt.page = page;
+        const std::vector<int>& list = ids[filter];
+        int begin = page * ROOM_PAGE_SIZE;
+        int end = std::min((int)list.size(), begin + ROOM_PAGE_SIZE);
+        for (int i = begin; i < end; i++) {
+            c.pkt.rooms[c.pkt.count++] = rooms[list[i]];
+        }
+        c.valid = true;
+    }
+
+    // 总数与版本号每次取的时候填，房间进出别的页时不必让本页缓存失效
+    c.pkt.total_pages = pages;
+    c.pkt.total_rooms = (int)ids[filter].size();
+    c.pkt.version = ver;
+    return c.pkt;
+}
+
+void RoomDirectory::clear_changes() {
+    changed.clear();
+    for (int f = 0; f < ROOM_FILTER_COUNT; f++) filter_dirty[f] = false;
+}
+
+// 有房间进出时，它所在页以及之后的页整体平移，需要重建
+void RoomDirectory::insert_id(int filter, int room_id) {
+    std::vector<int>& list = ids[filter];
+    auto pos = std::lower_bound(list.begin(), list.end(), room_id);
+    int idx = pos - list.begin();
+    list.insert(pos, room_id);
+    filter_dirty[filter] = true;
+    invalidate_from(filter, idx / ROOM_PAGE_SIZE);
+}
+
+void RoomDirectory::erase_id(int filter, int room_id) {
+    std::vector<int>& list = ids[filter];
+    auto pos = std::lower_bound(list.begin(), list.end(), room_id);
+    if (pos == list.end() || *pos != room_id) return;
+    int idx = pos - list.begin();
+    list.erase(pos);
+    filter_dirty[filter] = true;
+    invalidate_from(filter, idx / ROOM_PAGE_SIZE);
+}
+
+// 只是信息变化，只影响所在的那一页
+void RoomDirectory::touch_id(int filter, int room_id) {
+    const std::vector<int>& list = ids[filter];
+    auto pos = std::lower_bound(list.begin(), list.end(), room_id);
+    int page = (pos - list.begin()) / ROOM_PAGE_SIZE;
+    if (page < (int)cache[filter].size()) cache[filter][page].valid = false;
+}
+
+void RoomDirectory::invalidate_from(int filter, int first_page) {
+    std::vector<CachedPage>& pc = cache[filter];
+    for (int p = first_page; p < (int)pc.size(); p++) pc[p].valid = false;
+}
@@ -0,0 +1,58 @@
+#ifndef ROOM_DIRECTORY_H
+#define ROOM_DIRECTORY_H
+
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include "protocol.h"
+
+// --------------------------------------------------------
+// 房间目录
+// 房间状态变化时增量维护 (upsert/remove)，不再每次请求都遍历所有房间。
+// 每个过滤条件一份按 room_id 排序的 id 列表，分页直接按下标切片；
+// 组好的 RoomPagePacket 按页缓存，只有该页内容变化时才重建。
+// --------------------------------------------------------
+class RoomDirectory {
+public:
+    RoomDirectory();
+
+    // 房间新建或信息变化 (内容没变时不算变更)
+    void upsert(const RoomInfo& info);
+    void remove(int room_id);
+
+    const RoomInfo* find(int room_id) const;
+    unsigned int version() const { return ver; }
+
+    // 取一页 (page 越界时夹到最后一页)，返回的包可直接发送
+    const RoomPagePacket& get_page(int filter, int page);
+    int total_rooms(int filter) const;
+    int total_pages(int filter) const;
+
+    // 自上次 clear_changes 以来的变更，供推送订阅者用
+    bool has_changes() const { return !changed.empty(); }
+    bool changed_since_flush(int room_id) const { return changed.count(room_id) > 0; }
+    bool membership_changed(int filter) const { return filter_dirty[filter]; }
+    void clear_changes();
+
+    static bool matches(const RoomInfo& info, int filter);
+
+private:
+    struct CachedPage {
+        bool valid;
+        RoomPagePacket pkt;
+    };
+
+    std::unordered_map<int, RoomInfo> rooms;
+    std::vector<int> ids[ROOM_FILTER_COUNT];          // 各过滤条件下的房间 id (升序)
+    std::vector<CachedPage> cache[ROOM_FILTER_COUNT]; // 下标为页号
+    bool filter_dirty[ROOM_FILTER_COUNT];             // 本轮是否有房间进出该过滤结果
+    std::unordered_set<int> changed;
+    unsigned int ver;
+
+    void insert_id(int filter, int room_id);
+    void erase_id(int filter, int room_id);
+    void touch_id(int filter, int room_id);
+    void invalidate_from(int filter, int first_page);
+};
+
+#endif
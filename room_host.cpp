@@ -0,0 +1,155 @@
+#include "room_host.h"
+#include <iostream>
+#include <chrono>
+
+RoomHost::RoomHost(const RoomEvents& events) : events(events), last_tick_us(0) {
+    // 预热房间池：地图拷贝、开局单位模板都在这里提前做完
+    for (int i = 0; i < ROOM_POOL_PREWARM; i++) {
+        room_pool.push_back(new GameRoom(0, ""));
+    }
+}
+
+RoomHost::~RoomHost() {
+    for (auto& pair : rooms) {
+        delete pair.second;
+    }
+    for (GameRoom* room : room_pool) {
+        delete room;
+    }
+}
+
+GameRoom* RoomHost::find(int room_id) {
+    auto it = rooms.find(room_id);
+    return it == rooms.end() ? nullptr : it->second;
+}
+
+GameRoom* RoomHost::acquire_room(int room_id, const std::string& owner_name) {
+    GameRoom* room;
+    if (room_pool.empty()) {
+        std::cout << "[RoomHost] Room pool empty, constructing a new room." << std::endl;
+        room = new GameRoom(room_id, owner_name);
+    } else {
+        room = room_pool.back();
+        room_pool.pop_back();
+        room->reset(room_id, owner_name);
+    }
+    room->set_game_over_listener(events.game_over);
+    return room;
+}
+
+void RoomHost::release_room(GameRoom* room) {
+    if ((int)room_pool.size() >= ROOM_POOL_MAX) {
+        delete room;
+        return;
+    }
+    room->set_frame_listener(nullptr);
+    room->reset(0, "");
+    room_pool.push_back(room);
+}
+
+// 信息版本号变了才上报
+void RoomHost::sync_info(GameRoom* room) {
+    unsigned int v = room->get_info_version();
+    auto it = info_versions.find(room->room_id);
+    if (it != info_versions.end() && it->second == v) return;
+
+    info_versions[room->room_id] = v;
+    if (events.room_info) events.room_info(room->get_room_info());
+}
+
+int RoomHost::player_count() {
+    int n = 0;
+    for (auto& pair : rooms) n += (int)pair.second->get_player_fds().size();
+    return n;
+}
+
+void RoomHost::create_room(int room_id, const std::string& owner_name) {
+    if (rooms.count(room_id)) return;
+    rooms[room_id] = acquire_room(room_id, owner_name);
+    fresh_rooms.insert(room_id);
+}
+
+void RoomHost::join_room(int room_id, int fd, const std::string& name, int slot, bool ready) {
+    GameRoom* room = find(room_id);
+    bool ok = room && room->add_player(fd, name);
+    if (ok) {
+        fresh_rooms.erase(room_id);
+        if (slot >= 0) room->change_slot(fd, slot);
+        if (ready) room->set_ready(fd, true);
+        room->mark_state_dirty();
+    }
+    if (events.join_result) events.join_result(room_id, fd, ok);
+}
+
+void RoomHost::leave_room(int room_id, int fd) {
+    GameRoom* room = find(room_id);
+    if (!room) return;
+    room->remove_player(fd);
+    // 等待/选人阶段给剩下的人发新的房间状态；对局中走房间自己的离开通知
+    if (!room->is_empty() && room->status != ROOM_STATUS_PLAYING) room->mark_state_dirty();
+    sync_info(room); // 离开的玩家马上要看房间列表，先把变化报上去
+}
+
+void RoomHost::start_game(int room_id, int fd) {
+    GameRoom* room = find(room_id);
+    if (room) room->start_game(fd); // 进入选人阶段
+}
+
+void RoomHost::room_control(int room_id, int fd, const RoomControlPacket& pkt) {
+    GameRoom* room = find(room_id);
+    if (!room) return;
+
+    if (pkt.slot_index != -1) {
+        room->change_slot(fd, pkt.slot_index);
+    } else {
+        room->set_ready(fd, pkt.extra_data == 1);
+    }
+    // 广播房间最新状态 (本帧末统一发送)
+    room->mark_state_dirty();
+}
+
+void RoomHost::game_packet(int room_id, int fd, const GamePacket& pkt) {
+    GameRoom* room = find(room_id);
+    if (room) room->handle_game_packet(fd, pkt);
+}
+
+void RoomHost::set_watched(int room_id, bool watched) {
+    GameRoom* room = find(room_id);
+    if (!room) return;
+    if (watched) room->set_frame_listener(events.room_frame);
+    else room->set_frame_listener(nullptr);
+}
+
+void RoomHost::update() {
+    auto t0 = std::chrono::steady_clock::now();
+
+    // 驱动所有房间的游戏逻辑 (含合并后的房间状态广播)，并清理空房间
+    auto it = rooms.begin();
+    while (it != rooms.end()) {
+        GameRoom* room = it->second;
+        room->update_logic();
+
+        if (room->is_empty() && !fresh_rooms.count(it->first)) {
+            int rid = it->first;
+            std::cout << "[RoomHost] Room " << rid << " is empty, returning to pool." << std::endl;
+            info_versions.erase(rid);
+            release_room(room);
+            it = rooms.erase(it);
+            if (events.room_closed) events.room_closed(rid);
+        } else {
+            // 上一帧以来的加入/离开/换座以及本帧的开局/结算，都体现在版本号上
+            sync_info(room);
+            ++it;
+        }
+    }
+
+    last_tick_us = (int)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - t0).count();
+}
+
+void RoomHost::clear() {
+    for (auto& pair : rooms) release_room(pair.second);
+    rooms.clear();
+    fresh_rooms.clear();
+    info_versions.clear();
+}
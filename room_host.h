@@ -0,0 +1,56 @@
+#ifndef ROOM_HOST_H
+#define ROOM_HOST_H
+
+#include <map>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include "game_room.h"
+#include "room_backend.h"
+
+// 房间池：启动时预先构造，空房间回收复用，避免高峰期反复构造/析构
+#define ROOM_POOL_PREWARM  8    // 启动时预热的房间数
+#define ROOM_POOL_MAX      32   // 池中最多保留的空闲房间，超出的直接释放
+
+// --------------------------------------------------------
+// 本进程内的房间后端
+// 单进程部署时由 RoomManager 直接持有；集群部署时由 room_server 进程持有，
+// 事件经内部连接回传网关。
+// --------------------------------------------------------
+class RoomHost : public RoomBackend {
+public:
+    explicit RoomHost(const RoomEvents& events);
+    ~RoomHost();
+
+    void create_room(int room_id, const std::string& owner_name) override;
+    void join_room(int room_id, int fd, const std::string& name, int slot, bool ready) override;
+    void leave_room(int room_id, int fd) override;
+    void start_game(int room_id, int fd) override;
+    void room_control(int room_id, int fd, const RoomControlPacket& pkt) override;
+    void game_packet(int room_id, int fd, const GamePacket& pkt) override;
+    void set_watched(int room_id, bool watched) override;
+    void update() override;
+
+    int room_count() const override { return (int)rooms.size(); }
+    int tick_cost_us() const override { return last_tick_us; }
+    int player_count();
+
+    // 丢弃所有房间 (房间服务器与网关断开时)
+    void clear();
+
+private:
+    RoomEvents events;
+
+    std::map<int, GameRoom*> rooms;
+    std::unordered_set<int> fresh_rooms;  // 刚创建、第一个玩家还没进来的房间，不能当空房间回收
+    std::unordered_map<int, unsigned int> info_versions; // room_id -> 已上报的信息版本号
+    std::vector<GameRoom*> room_pool;     // 已 reset，可直接分配
+    int last_tick_us;
+
+    GameRoom* find(int room_id);
+    GameRoom* acquire_room(int room_id, const std::string& owner_name);
+    void release_room(GameRoom* room);
+    void sync_info(GameRoom* room);
+};
+
+#endif
@@ -1,10 +1,12 @@
 #include "room_manager.h"
+#include "net_io.h"
 #include <iostream>
 #include <algorithm>
 #include <cstring>
 #include <sys/socket.h>
 #include <unistd.h>
 #include <chrono> 
+#include <cmath>
 
 // 获取当前毫秒时间戳
 static long long get_ms() {
@@ -12,54 +14,182 @@ static long long get_ms() {
         std::chrono::steady_clock::now().time_since_epoch()).count();
 }
 
-RoomManager::RoomManager(UserManager* um) : user_mgr(um) {
+RoomManager::RoomManager(UserManager* um, const std::vector<std::string>& room_nodes) : user_mgr(um) {
     room_id_counter = 1;
+
+    RoomEvents events = make_events();
+    for (const std::string& addr : room_nodes) {
+        int sock = cluster_connect(addr);
+        if (sock < 0) {
+            std::cout << "[RoomMgr] Cannot reach room server " << addr << ", skipped." << std::endl;
+            continue;
+        }
+        RemoteRoomNode* node = new RemoteRoomNode(addr, sock, events,
+            [this](RoomBackend* from, int fd, const char* data, int len, int delivery) { on_client_data(from, fd, data, len, delivery); });
+        nodes.push_back(node);
+        backends.push_back(node);
+        std::cout << "[RoomMgr] Connected to room server " << addr << std::endl;
+    }
+
+    // 没有可用的房间服务器时退回单进程模式
+    if (backends.empty()) backends.push_back(new RoomHost(events));
 }
 
 RoomManager::~RoomManager() {
-    for (auto& pair : rooms) {
-        delete pair.second;
+    for (RoomBackend* b : backends) {
+        delete b;
     }
 }
 
-void RoomManager::update_all() {
-    // 1. 驱动所有房间的游戏逻辑，并清理空房间
-    auto it = rooms.begin();
-    while (it != rooms.end()) {
-        GameRoom* room = it->second;
-        
-        // 运行房间内部逻辑
-        room->update_logic();
-        
-        // 检查是否为空
-        if (room->is_empty()) {
-            std::cout << "[RoomMgr] Room " << it->first << " is empty, removing." << std::endl;
-            delete room;
-            it = rooms.erase(it);
+RoomEvents RoomManager::make_events() {
+    RoomEvents ev;
+    ev.room_info = [this](const RoomInfo& info) {
+        if (rooms.count(info.room_id)) directory.upsert(info);
+    };
+    ev.room_closed = [this](int room_id) { on_room_closed(room_id); };
+    ev.join_result = [this](int room_id, int fd, bool ok) { on_join_result(room_id, fd, ok); };
+    ev.game_over = [this](const GameOverPacket& res) { apply_game_result(res); };
+    ev.room_frame = [this](int room_id, const char* data, int len) { spectators.publish(room_id, data, len, get_ms()); };
+    return ev;
+}
+
+// 先避开过载的节点，再挑房间数最少的；全都过载时只看房间数
+RoomBackend* RoomManager::pick_backend() {
+    RoomBackend* best = nullptr;
+    bool best_busy = true;
+    for (RoomBackend* b : backends) {
+        bool busy = b->tick_cost_us() > ROOM_NODE_BUSY_US;
+        if (!best || (best_busy && !busy) ||
+            (busy == best_busy && b->room_count() < best->room_count())) {
+            best = b;
+            best_busy = busy;
+        }
+    }
+    return best;
+}
+
+int RoomManager::room_of(int fd) const {
+    auto pit = player_room_map.find(fd);
+    return pit == player_room_map.end() ? 0 : pit->second;
+}
+
+RoomBackend* RoomManager::backend_of(int fd, int* room_id) {
+    auto pit = player_room_map.find(fd);
+    if (pit == player_room_map.end()) return nullptr;
+    auto rit = rooms.find(pit->second);
+    if (rit == rooms.end()) return nullptr;
+    if (room_id) *room_id = pit->second;
+    return rit->second;
+}
+
+std::vector<int> RoomManager::node_fds() const {
+    std::vector<int> fds;
+    for (RemoteRoomNode* n : nodes) fds.push_back(n->fd());
+    return fds;
+}
+
+bool RoomManager::is_node_fd(int fd) const {
+    for (RemoteRoomNode* n : nodes) if (n->fd() == fd) return true;
+    return false;
+}
+
+void RoomManager::on_node_readable(int fd) {
+    for (RemoteRoomNode* n : nodes) {
+        if (n->fd() != fd) continue;
+        if (!n->on_readable()) on_node_lost(n);
+        return;
+    }
+}
+
+void RoomManager::flush_nodes() {
+    for (size_t i = 0; i < nodes.size(); i++) {
+        if (!nodes[i]->flush()) { on_node_lost(nodes[i]); i--; }
+    }
+}
+
+// 房间服务器掉线：上面的房间全部作废，玩家送回大厅
+void RoomManager::on_node_lost(RemoteRoomNode* node) {
+    std::cout << "[RoomMgr] Room server " << node->address() << " lost." << std::endl;
+
+    auto pit = player_room_map.begin();
+    while (pit != player_room_map.end()) {
+        auto rit = rooms.find(pit->second);
+        if (rit != rooms.end() && rit->second == node) {
+            int fd = pit->first;
+            pit = player_room_map.erase(pit);
+            send_room_list(fd);
+        } else {
+            ++pit;
+        }
+    }
+    auto rit = rooms.begin();
+    while (rit != rooms.end()) {
+        if (rit->second == node) {
+            directory.remove(rit->first);
+            end_spectating_room(rit->first);
+            rit = rooms.erase(rit);
         } else {
-            ++it;
+            ++rit;
         }
     }
 
-    // 2. 处理匹配队列
+    nodes.erase(std::find(nodes.begin(), nodes.end(), node));
+    backends.erase(std::find(backends.begin(), backends.end(), node));
+    if (on_node_closing) on_node_closing(node->fd());
+    delete node;
+    if (backends.empty()) {
+        std::cout << "[RoomMgr] No room servers left, hosting rooms locally." << std::endl;
+        backends.push_back(new RoomHost(make_events()));
+    }
+}
+
+void RoomManager::on_join_result(int room_id, int fd, bool ok) {
+    if (ok) {
+        std::cout << "[RoomMgr] Player " << user_mgr->get_username(fd) << " joined Room " << room_id << std::endl;
+        return;
+    }
+    std::cout << "[RoomMgr] Join failed: Room " << room_id << " is full or in game." << std::endl;
+    auto it = player_room_map.find(fd);
+    if (it != player_room_map.end() && it->second == room_id) player_room_map.erase(it);
+}
+
+void RoomManager::on_room_closed(int room_id) {
+    directory.remove(room_id);
+    rooms.erase(room_id);
+    end_spectating_room(room_id);
+}
+
+// 房间服务器发给客户端的数据：只转给仍在该节点房间里的连接 (fd 可能已断开并被复用)
+void RoomManager::on_client_data(RoomBackend* from, int fd, const char* data, int len, int delivery) {
+    if (backend_of(fd, nullptr) != from) return;
+    net_send(fd, data, len, delivery);
+}
+
+void RoomManager::update_all() {
+    // 1. 处理匹配队列 (先于房间循环，新房间的状态本帧就能发出去)
     process_matching();
+
+    // 2. 驱动各后端：本地房间跑一帧逻辑，远端则把缓冲的命令发出去
+    for (RoomBackend* b : backends) b->update();
+
+    // 3. 推送目录增量
+    push_directory_updates();
+
+    // 4. 延迟观战的到期帧
+    spectators.flush(get_ms());
 }
 
 void RoomManager::on_player_disconnect(int fd) {
-    // 1. 从匹配队列移除
-    for (auto it = match_queue.begin(); it != match_queue.end(); ) {
-        if (it->fd == fd) it = match_queue.erase(it);
-        else ++it;
-    }
+    // 1. 从匹配队列、目录订阅中移除
+    matcher.remove(fd);
+    lobby_subs.erase(fd);
+    stop_spectating(fd);
 
     // 2. 从房间移除并清理映射
-    if (player_room_map.count(fd)) {
-        int rid = player_room_map[fd];
-        if (rooms.count(rid)) {
-            rooms[rid]->remove_player(fd);
-        }
-        player_room_map.erase(fd);
-    }
+    int rid;
+    RoomBackend* backend = backend_of(fd, &rid);
+    if (backend) backend->leave_room(rid, fd);
+    player_room_map.erase(fd);
 }
 
 // === 网络包分发逻辑 ===
@@ -79,50 +209,86 @@ void RoomManager::handle_lobby_packet(int fd, int type, const void* data) {
     else if (type == TYPE_ROOM_LIST_REQ) {
         send_room_list(fd);
     }
+    else if (type == TYPE_ROOM_PAGE_REQ) {
+        send_room_page(fd, *(const RoomPageRequest*)data);
+    }
     else if (type == TYPE_MATCH_REQ) {
         add_to_match(fd);
     }
     else if (type == TYPE_GAME_START) {
-        if (player_room_map.count(fd)) {
-            int rid = player_room_map[fd];
-            if (rooms.count(rid)) {
-                // 进入选人阶段
-                rooms[rid]->start_game(fd);
-            }
-        }
+        int rid;
+        RoomBackend* backend = backend_of(fd, &rid);
+        // 进入选人阶段
+        if (backend) backend->start_game(rid, fd);
     }
 }
 
 void RoomManager::handle_room_control(int fd, const RoomControlPacket& pkt) {
-    if (player_room_map.count(fd) == 0) return;
-    int rid = player_room_map[fd];
-    if (rooms.count(rid) == 0) return;
-    
-    GameRoom* room = rooms[rid];
-    
-    if (pkt.slot_index != -1) {
-        room->change_slot(fd, pkt.slot_index);
-    } else {
-        room->set_ready(fd, pkt.extra_data == 1);
-    }
-    
-    // 广播房间最新状态
-    RoomStatePacket state = room->get_room_state_packet();
-    std::vector<int> mems = room->get_player_fds();
-    for(int mfd : mems) write(mfd, &state, sizeof(state));
+    int rid;
+    RoomBackend* backend = backend_of(fd, &rid);
+    if (backend) backend->room_control(rid, fd, pkt);
 }
 
 void RoomManager::handle_game_packet(int fd, const GamePacket& pkt) {
-    if (player_room_map.count(fd) == 0) return;
-    int rid = player_room_map[fd];
-    if (rooms.count(rid)) {
-        rooms[rid]->handle_game_packet(fd, pkt);
+    int rid;
+    RoomBackend* backend = backend_of(fd, &rid);
+    if (backend) backend->game_packet(rid, fd, pkt);
+}
+
+// === 观战 ===
+
+// 在房间里或排队中不能观战；观看期间不接收大厅推送
+void RoomManager::handle_spectate(int fd, const SpectatePacket& pkt) {
+    stop_spectating(fd);
+
+    SpectatePacket resp;
+    memset(&resp, 0, sizeof(resp));
+    resp.type = TYPE_SPECTATE;
+    resp.room_id = pkt.room_id;
+    resp.delay_sec = std::max(0, std::min(pkt.delay_sec, SPECTATE_MAX_DELAY_SEC));
+    resp.result = RET_SUCCESS;
+
+    if (pkt.room_id != 0) {
+        auto it = rooms.find(pkt.room_id);
+        if (player_room_map.count(fd) || matcher.contains(fd)) {
+            resp.result = RET_FAIL_DUP;
+        } else if (it == rooms.end()) {
+            resp.result = RET_FAIL_NONAME;
+        } else {
+            lobby_subs.erase(fd);
+            if (spectators.add(fd, pkt.room_id, resp.delay_sec, get_ms())) it->second->set_watched(pkt.room_id, true);
+            std::cout << "[Spectate] " << user_mgr->get_username(fd) << " watching Room " << pkt.room_id
+                      << " (delay " << resp.delay_sec << "s, " << spectators.viewer_count(pkt.room_id) << " viewers)" << std::endl;
+        }
     }
+    net_send(fd, &resp, sizeof(resp));
+}
+
+void RoomManager::stop_spectating(int fd) {
+    bool unwatched;
+    int rid = spectators.remove(fd, &unwatched);
+    if (!unwatched) return;
+    auto it = rooms.find(rid);
+    if (it != rooms.end()) it->second->set_watched(rid, false);
+}
+
+void RoomManager::end_spectating_room(int room_id) {
+    std::vector<int> fds;
+    spectators.close_room(room_id, fds);
+    if (fds.empty()) return;
+
+    SpectatePacket pkt;
+    memset(&pkt, 0, sizeof(pkt));
+    pkt.type = TYPE_SPECTATE;
+    pkt.room_id = 0;
+    pkt.result = RET_SUCCESS;
+    for (int fd : fds) net_send(fd, &pkt, sizeof(pkt));
 }
 
 // === 内部逻辑实现 ===
 
 void RoomManager::create_room(int fd) {
+    stop_spectating(fd);
     // 修正：创建前先离开可能存在的旧房间
     if (player_room_map.count(fd)) {
         leave_room(fd);
@@ -131,19 +297,20 @@ void RoomManager::create_room(int fd) {
     std::string name = user_mgr->get_username(fd);
     int new_id = room_id_counter++;
     
-    GameRoom* room = new GameRoom(new_id, name);
-    rooms[new_id] = room;
+    RoomBackend* backend = pick_backend();
+    backend->create_room(new_id, name);
+    rooms[new_id] = backend;
     
-    room->add_player(fd, name);
     player_room_map[fd] = new_id;
+    lobby_subs.erase(fd); // 进了房间就不再需要大厅推送
+    backend->join_room(new_id, fd, name, -1, false);
     
     std::cout << "[RoomMgr] Player " << name << " created Room " << new_id << std::endl;
-    
-    RoomStatePacket state = room->get_room_state_packet();
-    write(fd, &state, sizeof(state));
 }
 
+// 加入结果由后端异步回报 (on_join_result)，这里先乐观地记下映射，失败时再撤销
 void RoomManager::join_room(int fd, int room_id) {
+    stop_spectating(fd);
     // 修正：加入前先清理旧房间状态，防止逻辑阻塞
     if (player_room_map.count(fd)) {
         std::cout << "[RoomMgr] Player already in room " << player_room_map[fd] << ", leaving first." << std::endl;
@@ -155,117 +322,192 @@ void RoomManager::join_room(int fd, int room_id) {
         return; 
     }
     
-    GameRoom* room = rooms[room_id];
-    std::string name = user_mgr->get_username(fd);
-    
-    if (room->add_player(fd, name)) {
-        player_room_map[fd] = room_id;
-        std::cout << "[RoomMgr] Player " << name << " joined Room " << room_id << std::endl;
-        
-        RoomStatePacket state = room->get_room_state_packet();
-        std::vector<int> mems = room->get_player_fds();
-        for(int mfd : mems) write(mfd, &state, sizeof(state));
-    }
+    player_room_map[fd] = room_id;
+    lobby_subs.erase(fd);
+    rooms[room_id]->join_room(room_id, fd, user_mgr->get_username(fd), -1, false);
 }
 
 void RoomManager::leave_room(int fd) {
-    if (player_room_map.count(fd) == 0) return;
-    int rid = player_room_map[fd];
-    
-    if (rooms.count(rid)) {
-        GameRoom* room = rooms[rid];
-        room->remove_player(fd);
-        
-        if (!room->is_empty()) {
-            RoomStatePacket state = room->get_room_state_packet();
-            std::vector<int> mems = room->get_player_fds();
-            for(int mfd : mems) write(mfd, &state, sizeof(state));
-        }
-    }
+    int rid;
+    RoomBackend* backend = backend_of(fd, &rid);
+    if (backend) backend->leave_room(rid, fd); // 本地后端会立即把人数变化报进目录
     player_room_map.erase(fd);
     send_room_list(fd);
 }
 
+// 旧版列表请求：直接取目录缓存的第一页
 void RoomManager::send_room_list(int fd) {
+    const RoomPagePacket& page = directory.get_page(ROOM_FILTER_ALL, 0);
+
     RoomListPacket pkt;
     pkt.type = TYPE_ROOM_LIST_RESP;
-    pkt.count = 0;
-    
-    int i = 0;
-    for (auto& pair : rooms) {
-        if (i >= 10) break;
-        pkt.rooms[i] = pair.second->get_room_info();
-        pkt.count++;
-        i++;
+    pkt.count = page.count;
+    memcpy(pkt.rooms, page.rooms, sizeof(pkt.rooms));
+    net_send(fd, &pkt, sizeof(pkt));
+}
+
+// === 房间目录 ===
+
+void RoomManager::send_room_page(int fd, const RoomPageRequest& req) {
+    const RoomPagePacket& page = directory.get_page(req.filter, req.page);
+    net_send(fd, &page, sizeof(page));
+
+    if (!req.subscribe || player_room_map.count(fd)) {
+        lobby_subs.erase(fd);
+        return;
     }
-    write(fd, &pkt, sizeof(pkt));
+    LobbySubscription& sub = lobby_subs[fd];
+    sub.filter = page.filter;
+    sub.page = page.page;
+    sub.total_rooms = page.total_rooms;
+    sub.count = page.count;
+    for (int i = 0; i < page.count; i++) sub.shown[i] = page.rooms[i].room_id;
+}
+
+// 对每个订阅者比较 "他看到的那一页" 和 "现在的那一页"：
+// 页内只有少量房间变化就发增量，变化太多或页号被夹回来了才重发整页。
+// 页包本身在目录里有缓存，同一页的订阅者共享，一帧最多重建一次。
+void RoomManager::push_directory_updates() {
+    if (!directory.has_changes()) return;
+
+    for (auto& pair : lobby_subs) {
+        int fd = pair.first;
+        LobbySubscription& sub = pair.second;
+
+        if (!directory.membership_changed(sub.filter)) {
+            bool touched = false;
+            for (int i = 0; i < sub.count && !touched; i++) {
+                touched = directory.changed_since_flush(sub.shown[i]);
+            }
+            if (!touched) continue;
+        }
+
+        const RoomPagePacket& page = directory.get_page(sub.filter, sub.page);
+
+        RoomDeltaPacket delta;
+        memset(&delta, 0, sizeof(delta));
+        delta.type = TYPE_ROOM_DELTA;
+        delta.version = page.version;
+        delta.total_pages = page.total_pages;
+        delta.total_rooms = page.total_rooms;
+        delta.count = 0;
+        bool overflow = (page.page != sub.page);
+
+        // 已不在本页的 -> 删除
+        for (int i = 0; i < sub.count && !overflow; i++) {
+            bool still = false;
+            for (int j = 0; j < page.count; j++) {
+                if (page.rooms[j].room_id == sub.shown[i]) { still = true; break; }
+            }
+            if (still) continue;
+            if (delta.count >= ROOM_DELTA_MAX) { overflow = true; break; }
+            RoomDeltaEntry& e = delta.entries[delta.count++];
+            e.op = ROOM_DELTA_REMOVE;
+            e.info.room_id = sub.shown[i];
+        }
+        // 新进入本页的、或内容变了的 -> 更新
+        for (int j = 0; j < page.count && !overflow; j++) {
+            int rid = page.rooms[j].room_id;
+            bool shown = false;
+            for (int i = 0; i < sub.count; i++) {
+                if (sub.shown[i] == rid) { shown = true; break; }
+            }
+            if (shown && !directory.changed_since_flush(rid)) continue;
+            if (delta.count >= ROOM_DELTA_MAX) { overflow = true; break; }
+            RoomDeltaEntry& e = delta.entries[delta.count++];
+            e.op = ROOM_DELTA_UPSERT;
+            e.info = page.rooms[j];
+        }
+
+        if (overflow) {
+            net_send(fd, &page, sizeof(page));
+        } else if (delta.count > 0 || page.total_rooms != sub.total_rooms) {
+            net_send(fd, &delta, sizeof(delta));
+        }
+
+        sub.page = page.page;
+        sub.total_rooms = page.total_rooms;
+        sub.count = page.count;
+        for (int i = 0; i < page.count; i++) sub.shown[i] = page.rooms[i].room_id;
+    }
+
+    directory.clear_changes();
 }
 
 // === 匹配逻辑 ===
 
 void RoomManager::add_to_match(int fd) {
-    for(auto& mp : match_queue) if(mp.fd == fd) return;
+    if (matcher.contains(fd)) return;
     if (player_room_map.count(fd)) return;
+    stop_spectating(fd);
 
-    MatchPlayer mp;
-    mp.fd = fd;
-    mp.join_time = get_ms();
-    match_queue.push_back(mp);
+    int rating = user_mgr->get_rating(user_mgr->get_username(fd));
+    matcher.add(fd, rating, get_ms());
     
-    std::cout << "[Match] Player " << fd << " added to queue. Size: " << match_queue.size() << std::endl;
+    std::cout << "[Match] Player " << fd << " (rating " << rating << ") added to queue. Size: " << matcher.size() << std::endl;
 }
 
 void RoomManager::process_matching() {
-    if (match_queue.empty()) return;
-
-    // 1. 检查是否满10人
-    if (match_queue.size() >= 10) {
-        int new_id = room_id_counter++;
-        int owner_fd = match_queue[0].fd;
-        std::string owner_name = user_mgr->get_username(owner_fd);
-        
-        GameRoom* room = new GameRoom(new_id, owner_name);
-        rooms[new_id] = room;
-        
-        std::cout << "[Match] Full 10 players! Auto creating Room " << new_id << std::endl;
-        for (int i = 0; i < 10; i++) {
-            int fd = match_queue[i].fd;
-            std::string name = user_mgr->get_username(fd);
-            room->add_player(fd, name);
+    if (matcher.size() == 0) return;
+
+    match_groups.clear();
+    matcher.form_matches(get_ms(), match_groups);
+    for (const MatchGroup& g : match_groups) create_match_room(g);
+}
+
+// 按组好的队伍建房：team1 占 0-4 号位，team2 占 5-9 号位
+void RoomManager::create_match_room(const MatchGroup& group) {
+    int new_id = room_id_counter++;
+    int owner_fd = group.team1.empty() ? group.team2[0] : group.team1[0];
+    std::string owner_name = user_mgr->get_username(owner_fd);
+
+    RoomBackend* backend = pick_backend();
+    backend->create_room(new_id, owner_name);
+    rooms[new_id] = backend;
+
+    const std::vector<int>* teams[2] = { &group.team1, &group.team2 };
+    for (int t = 0; t < 2; t++) {
+        for (size_t i = 0; i < teams[t]->size(); i++) {
+            int fd = (*teams[t])[i];
             player_room_map[fd] = new_id;
-            room->set_ready(fd, true);
+            lobby_subs.erase(fd);
+            backend->join_room(new_id, fd, user_mgr->get_username(fd), t * MATCH_TEAM_SIZE + (int)i, group.full);
         }
-        
-        match_queue.erase(match_queue.begin(), match_queue.begin() + 10);
-        
+    }
+
+    if (group.full) {
+        std::cout << "[Match] Full " << MATCH_ROOM_SIZE << " players! Auto creating Room " << new_id << std::endl;
         // 自动进入选人阶段
-        room->start_game(owner_fd); 
-        return;
+        backend->start_game(new_id, owner_fd); 
+    } else {
+        std::cout << "[Match] Timeout. Grouping " << group.team1.size() + group.team2.size()
+                  << " players into Room " << new_id << std::endl;
     }
+}
 
-    // 2. 检查超时 (10秒强制开)
-    long long now = get_ms();
-    if (now - match_queue[0].join_time > 10000) { 
-        std::cout << "[Match] Timeout. Grouping " << match_queue.size() << " players." << std::endl;
-        
-        int new_id = room_id_counter++;
-        int owner_fd = match_queue[0].fd;
-        std::string owner_name = user_mgr->get_username(owner_fd);
-        
-        GameRoom* room = new GameRoom(new_id, owner_name);
-        rooms[new_id] = room;
-        
-        for (auto& mp : match_queue) {
-            int fd = mp.fd;
-            std::string name = user_mgr->get_username(fd);
-            room->add_player(fd, name);
-            player_room_map[fd] = new_id;
-        }
-        match_queue.clear();
-        
-        // 广播进入房间
-        RoomStatePacket state = room->get_room_state_packet();
-        std::vector<int> mems = room->get_player_fds();
-        for(int mfd : mems) write(mfd, &state, sizeof(state));
+// Elo：每名玩家按 "本队平均分 vs 对方平均分" 计算期望胜率
+void RoomManager::apply_game_result(const GameOverPacket& result) {
+    const int K = 32;
+    long long sum[3] = {0, 0, 0};
+    int cnt[3] = {0, 0, 0};
+    int ratings[10];
+
+    for (int i = 0; i < result.player_count && i < 10; i++) {
+        const PlayerResult& r = result.results[i];
+        ratings[i] = user_mgr->get_rating(r.name);
+        if (r.team == 1 || r.team == 2) { sum[r.team] += ratings[i]; cnt[r.team]++; }
     }
-}
\ No newline at end of file
+    if (cnt[1] == 0 || cnt[2] == 0) return; // 单边对局不计分
+
+    double avg[3] = { 0, (double)sum[1] / cnt[1], (double)sum[2] / cnt[2] };
+    for (int i = 0; i < result.player_count && i < 10; i++) {
+        const PlayerResult& r = result.results[i];
+        if (r.team != 1 && r.team != 2) continue;
+        int opp = 3 - r.team;
+        double expected = 1.0 / (1.0 + pow(10.0, (avg[opp] - avg[r.team]) / 400.0));
+        double score = (r.team == result.winner_team) ? 1.0 : 0.0;
+        int new_rating = ratings[i] + (int)lround(K * (score - expected));
+        user_mgr->set_rating(r.name, new_rating);
+        std::cout << "[Match] Rating " << r.name << ": " << ratings[i] << " -> " << new_rating << std::endl;
+    }
+}
@@ -3,34 +3,68 @@
 
 #include <map>
 #include <vector>
+#include <functional>
 #include <string>
+#include <unordered_map>
 #include "game_room.h"
 #include "user_manager.h"
 #include "protocol.h"
+#include "matchmaker.h"
+#include "room_directory.h"
+#include "room_host.h"
+#include "remote_room_node.h"
+#include "spectator_relay.h"
 
-struct MatchPlayer {
-    int fd;
-    long long join_time;
-};
+// [新增] 房间服务器平均帧耗时超过该值 (微秒) 时，新房间优先放到别处
+#define ROOM_NODE_BUSY_US  20000
 
 class RoomManager {
 private:
     UserManager* user_mgr; // 引用，用于获取名字
     
-    // 房间容器: room_id -> Room*
-    std::map<int, GameRoom*> rooms;
+    // [修改] 房间实际跑在后端上：单进程时是本地 RoomHost，集群时是若干房间服务器
+    std::vector<RoomBackend*> backends;
+    std::vector<RemoteRoomNode*> nodes;   // backends 中的远端部分
+    std::map<int, RoomBackend*> rooms;    // room_id -> 所在后端
     int room_id_counter;
 
-    // 匹配队列
-    std::vector<MatchPlayer> match_queue;
+    // [修改] 按匹配分排队的匹配器
+    Matchmaker matcher;
+    std::vector<MatchGroup> match_groups; // 本帧组好的队伍 (复用容量)
 
     // 玩家当前所在的房间映射: fd -> room_id (0表示在大厅)
     std::map<int, int> player_room_map;
 
+    // [新增] 房间目录：由后端上报的 RoomInfo 增量维护
+    RoomDirectory directory;
+
+    // [新增] 订阅了目录某一页的大厅玩家，记录其客户端当前显示的内容用于算增量
+    struct LobbySubscription {
+        int filter;
+        int page;
+        int total_rooms;
+        int count;
+        int shown[ROOM_PAGE_SIZE];
+    };
+    std::unordered_map<int, LobbySubscription> lobby_subs; // fd -> 订阅
+
+    // [新增] 观战：房间每帧交出一份编码好的帧，由中继分发给观众
+    SpectatorRelay spectators;
+
 public:
-    RoomManager(UserManager* um);
+    // room_nodes 为空时在本进程内跑房间；否则作为网关，房间放到这些房间服务器上
+    RoomManager(UserManager* um, const std::vector<std::string>& room_nodes = std::vector<std::string>());
     ~RoomManager();
 
+    // === 集群 ===
+    // 房间服务器连接的 fd (主循环注册到 epoll)，可读时调用 on_node_readable
+    std::vector<int> node_fds() const;
+    bool is_node_fd(int fd) const;
+    void on_node_readable(int fd);
+    void flush_nodes(); // 把本轮收到的客户端输入尽快转发出去
+    // [新增] 房间服务器掉线、连接即将关闭前调用 (主循环借此把 fd 从 I/O 后端注销)
+    std::function<void(int fd)> on_node_closing;
+
     // === 核心循环 ===
     // 每帧调用，驱动所有房间的逻辑 + 匹配逻辑
     void update_all();
@@ -49,16 +83,41 @@ public:
     // 转发房间控制包 (Ready, ChangeSlot, Kick)
     void handle_room_control(int fd, const RoomControlPacket& pkt);
 
+    // [新增] 开始/停止观战 (room_id 为 0 表示停止)
+    void handle_spectate(int fd, const SpectatePacket& pkt);
+
+    // [新增] 玩家当前所在的房间 (0 表示在大厅)，延迟统计按房间归类用
+    int room_of(int fd) const;
+
 private:
     // 内部逻辑
     void create_room(int fd);
     void join_room(int fd, int room_id);
     void leave_room(int fd);
     void send_room_list(int fd);
+
+    // 房间目录
+    void send_room_page(int fd, const RoomPageRequest& req);
+    void push_directory_updates(); // 每帧一次，把变化推给订阅者
+
+    // 后端
+    RoomEvents make_events();
+    RoomBackend* pick_backend();  // 按负载挑选新房间的落点
+    RoomBackend* backend_of(int fd, int* room_id); // 玩家所在房间的后端
+    void on_join_result(int room_id, int fd, bool ok);
+    void on_room_closed(int room_id);
+    void on_client_data(RoomBackend* from, int fd, const char* data, int len, int delivery);
+    void on_node_lost(RemoteRoomNode* node);
+
+    // 观战
+    void stop_spectating(int fd);
+    void end_spectating_room(int room_id); // 房间没了：通知观众回大厅
     
     // 匹配逻辑
     void add_to_match(int fd);
     void process_matching(); // 检查队列
+    void create_match_room(const MatchGroup& group);
+    void apply_game_result(const GameOverPacket& result); // 按 Elo 更新匹配分
 };
 
 #endif
\ No newline at end of file
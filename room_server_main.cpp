@@ -0,0 +1,188 @@
+#include <iostream>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <cstring>
+#include <chrono>
+
+#include "protocol.h"
+#include "room_host.h"
+#include "cluster_link.h"
+#include "net_io.h"
+
+// ==========================================
+// 房间服务器进程
+// 只跑 GameRoom，不直接面对客户端：网关把建房/进房/游戏输入通过内部连接发过来，
+// 房间发给玩家的数据和房间事件再经同一条连接回给网关。
+// 用法: ./room_server [地址] [--lockstep]   (默认 unix:/tmp/moba_room.sock)
+// ==========================================
+
+#define DEFAULT_ROOM_ADDR "unix:/tmp/moba_room.sock"
+#define LOAD_REPORT_MS    1000
+
+static long long get_current_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static ClusterLink* gateway = nullptr;
+
+static void handle_command(RoomHost& host, const ClusterFrame& hdr, const char* payload) {
+    switch (hdr.kind) {
+        case CMD_CREATE_ROOM: {
+            if (hdr.len < (int)sizeof(ClusterCreateRoom)) return;
+            const ClusterCreateRoom* msg = (const ClusterCreateRoom*)payload;
+            host.create_room(hdr.room_id, std::string(msg->owner_name, strnlen(msg->owner_name, 32)));
+            break;
+        }
+        case CMD_JOIN_ROOM: {
+            if (hdr.len < (int)sizeof(ClusterJoinRoom)) return;
+            const ClusterJoinRoom* msg = (const ClusterJoinRoom*)payload;
+            host.join_room(hdr.room_id, hdr.client_fd, std::string(msg->name, strnlen(msg->name, 32)),
+                           msg->slot, msg->ready != 0);
+            break;
+        }
+        case CMD_LEAVE_ROOM:
+            host.leave_room(hdr.room_id, hdr.client_fd);
+            break;
+        case CMD_START_GAME:
+            host.start_game(hdr.room_id, hdr.client_fd);
+            break;
+        case CMD_ROOM_CONTROL:
+            if (hdr.len < (int)sizeof(RoomControlPacket)) return;
+            host.room_control(hdr.room_id, hdr.client_fd, *(const RoomControlPacket*)payload);
+            break;
+        case CMD_GAME_PACKET:
+            if (hdr.len < (int)sizeof(GamePacket)) return;
+            host.game_packet(hdr.room_id, hdr.client_fd, *(const GamePacket*)payload);
+            break;
+        case CMD_WATCH_ROOM:
+            if (hdr.len < (int)sizeof(int)) return;
+            host.set_watched(hdr.room_id, *(const int*)payload != 0);
+            break;
+    }
+}
+
+int main(int argc, char** argv) {
+    std::string addr = DEFAULT_ROOM_ADDR;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--lockstep") == 0) GameRoom::set_lockstep_enabled(true);
+        else addr = argv[i];
+    }
+    int listen_fd = cluster_listen(addr);
+    if (listen_fd < 0) {
+        std::cout << "[RoomServer] Cannot listen on " << addr << std::endl;
+        return -1;
+    }
+
+    // 房间事件 -> 网关
+    RoomEvents events;
+    events.room_info = [](const RoomInfo& info) {
+        if (gateway) gateway->send(EVT_ROOM_INFO, info.room_id, 0, &info, sizeof(info));
+    };
+    events.room_closed = [](int room_id) {
+        if (gateway) gateway->send(EVT_ROOM_CLOSED, room_id, 0, nullptr, 0);
+    };
+    events.join_result = [](int room_id, int fd, bool ok) {
+        int v = ok ? 1 : 0;
+        if (gateway) gateway->send(EVT_JOIN_RESULT, room_id, fd, &v, sizeof(v));
+    };
+    events.game_over = [](const GameOverPacket& res) {
+        if (gateway) gateway->send(EVT_GAME_OVER, 0, 0, &res, sizeof(res));
+    };
+    events.room_frame = [](int room_id, const char* data, int len) {
+        if (gateway) gateway->send(EVT_ROOM_FRAME, room_id, 0, data, len);
+    };
+    RoomHost host(events);
+
+    // 房间里所有发给玩家的数据都改走网关
+    set_net_send_hook([](int fd, const void* buf, size_t len, int delivery) -> ssize_t {
+        if (!gateway) return -1;
+        gateway->send(delivery == NET_SNAPSHOT ? EVT_CLIENT_SNAPSHOT : EVT_CLIENT_DATA, 0, fd, buf, (int)len);
+        return (ssize_t)len;
+    });
+
+    int epoll_fd = epoll_create1(0);
+    epoll_event ev, events_buf[16];
+    ev.events = EPOLLIN;
+    ev.data.fd = listen_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev);
+
+    std::cout << "[RoomServer] Listening on " << addr << "..." << std::endl;
+
+    const int TICK_MS = 33; // 与网关一致，约30FPS
+    long long last_tick_time = get_current_ms();
+    long long last_report_time = last_tick_time;
+    long long tick_us_sum = 0;
+    int tick_samples = 0;
+
+    while (true) {
+        long long now = get_current_ms();
+        int wait_ms = TICK_MS - (int)(now - last_tick_time);
+        if (wait_ms < 0) wait_ms = 0;
+
+        int n = epoll_wait(epoll_fd, events_buf, 16, wait_ms);
+        bool lost = false;
+
+        for (int i = 0; i < n; i++) {
+            int fd = events_buf[i].data.fd;
+            if (fd == listen_fd) {
+                int conn = accept(listen_fd, nullptr, nullptr);
+                if (conn < 0) continue;
+                if (gateway) {
+                    // 一个房间服务器只服务一个网关，新连接替换旧连接
+                    std::cout << "[RoomServer] New gateway replaces the old one, dropping all rooms." << std::endl;
+                    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, gateway->fd(), NULL);
+                    delete gateway;
+                    gateway = nullptr;
+                    host.clear();
+                }
+                int flags = fcntl(conn, F_GETFL, 0);
+                fcntl(conn, F_SETFL, flags | O_NONBLOCK);
+                gateway = new ClusterLink(conn);
+                ev.events = EPOLLIN;
+                ev.data.fd = conn;
+                epoll_ctl(epoll_fd, EPOLL_CTL_ADD, conn, &ev);
+                std::cout << "[RoomServer] Gateway connected." << std::endl;
+            } else if (gateway && fd == gateway->fd()) {
+                if (!gateway->receive([&host](const ClusterFrame& hdr, const char* payload) {
+                        handle_command(host, hdr, payload);
+                    })) {
+                    lost = true;
+                }
+            }
+        }
+
+        now = get_current_ms();
+        if (!lost && now - last_tick_time >= TICK_MS) {
+            host.update();
+            last_tick_time = now;
+            tick_us_sum += host.tick_cost_us();
+            tick_samples++;
+
+            if (gateway && now - last_report_time >= LOAD_REPORT_MS) {
+                ClusterLoad load;
+                load.rooms = host.room_count();
+                load.players = host.player_count();
+                load.tick_us = tick_samples ? (int)(tick_us_sum / tick_samples) : 0;
+                gateway->send(EVT_LOAD, 0, 0, &load, sizeof(load));
+                last_report_time = now;
+                tick_us_sum = 0;
+                tick_samples = 0;
+            }
+        }
+
+        // 本轮产生的所有帧一次写出
+        if (gateway && (lost || !gateway->flush())) {
+            std::cout << "[RoomServer] Gateway disconnected, dropping all rooms." << std::endl;
+            epoll_ctl(epoll_fd, EPOLL_CTL_DEL, gateway->fd(), NULL);
+            delete gateway;
+            gateway = nullptr;
+            host.clear();
+        }
+    }
+
+    close(listen_fd);
+    return 0;
+}
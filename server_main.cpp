@@ -4,18 +4,27 @@
 #include <netinet/tcp.h> 
 #include <unistd.h>
 #include <fcntl.h>
-#include <sys/epoll.h>
 #include <cstring>
 #include <chrono> 
 #include <map>
+#include <algorithm>
 #include <thread> 
+#include <deque>
 
 #include "protocol.h"
 #include "user_manager.h"
 #include "room_manager.h"
+#include "auth_service.h"
+#include "net_io.h"
+#include "shm_transport.h"
+#include "udp_server.h"
+#include "io_backend.h"
+#include "reactor_pool.h"
+#include "latency_monitor.h"
+#include "idle_reaper.h"
+#include "admission_control.h"
 
 #define PORT 8888
-#define MAX_EVENTS 1000
 
 // 获取当前毫秒时间戳
 static long long get_current_ms() {
@@ -27,8 +36,33 @@ static long long get_current_ms() {
 struct ClientBuffer {
     char data[10240];
     int len;
+    unsigned int gen;     // [新增] 连接代号，fd 被复用后旧的认证结果据此丢弃
+    bool auth_pending;    // [新增] 登录/注册结果未返回前，暂停解析后续包以保持顺序
+    bool logged_in;       // [新增] 登录成功后才允许申请 UDP 通道
+    bool queued;          // [新增] 已在低优先级待解析队列里
 };
 std::map<int, ClientBuffer> client_buffers;
+static unsigned int next_conn_gen = 1;
+
+// [修改] 主循环的 I/O 后端 (epoll 或 io_uring)
+static IoBackend* io = nullptr;
+
+// [新增] 共享内存连接：c2s eventfd -> 连接 fd
+static std::map<int, int> shm_wake_owner;
+
+// [新增] 战斗流量的 UDP 通道 (与 TCP 同端口号)
+static UdpServer udp_server;
+
+// [新增] 各连接的 PING/PONG 延迟测量与统计
+static LatencyMonitor* latency = nullptr;
+
+// [新增] 握手/登录/空闲超时的连接回收
+static IdleReaper* reaper = nullptr;
+
+// [新增] 准入控制与过载保护；大厅/登录阶段的连接攒到逻辑帧之后再解析 (已登录的优先)
+static AdmissionControl* admission = nullptr;
+static std::deque<int> deferred_lobby, deferred_login;
+static int auth_outstanding = 0; // 已提交、结果还没回来的认证请求
 
 // 设置非阻塞
 int setNonBlocking(int sockfd) {
@@ -36,174 +70,562 @@ int setNonBlocking(int sockfd) {
     return fcntl(sockfd, F_SETFL, flags | O_NONBLOCK);
 }
 
-// 后台数据持久化线程函数
+// 后台数据持久化线程函数：每秒批量刷一次注册日志，每 30 秒压缩一次快照
 void data_persistence_thread(UserManager* um) {
+    int ticks = 0;
     while (true) {
-        std::this_thread::sleep_for(std::chrono::seconds(30));
-        um->save_db();
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        um->flush_journal();
+        if (++ticks % 30 == 0) um->save_db();
+    }
+}
+
+// [新增] Unix socket 连接申请改走共享内存环
+static void upgrade_to_shm(int fd) {
+    TransportShmPacket resp;
+    memset(&resp, 0, sizeof(resp));
+    resp.type = TYPE_TRANSPORT_SHM;
+    resp.result = RET_FAIL_DUP;
+
+    sockaddr_storage sa;
+    socklen_t sa_len = sizeof(sa);
+    bool is_unix = getsockname(fd, (sockaddr*)&sa, &sa_len) == 0 && sa.ss_family == AF_UNIX;
+    ShmChannel* ch = (is_unix && !net_shm_of(fd)) ? ShmChannel::create(SHM_RING_BYTES) : nullptr;
+    if (!ch) {
+        net_send(fd, &resp, sizeof(resp)); // 只有同机的 Unix socket 连接才能传 fd
+        return;
+    }
+
+    resp.result = RET_SUCCESS;
+    resp.ring_bytes = SHM_RING_BYTES;
+    int fds[3] = { ch->mem_fd, ch->efd_c2s, ch->efd_s2c };
+    // 对端拿到 fd 之前环一定是空的，先宣布睡眠，对端第一次写入就会唤醒
+    // (放在发送之后的话，对端抢先写入时没人去读)
+    ch->prepare_wait();
+    // 带 fd 的这条直接 sendmsg，不经过 I/O 后端；升级请求是连接上的第一个包，前面没有排队的数据
+    if (!send_with_fds(fd, &resp, sizeof(resp), fds, 3)) {
+        delete ch;
+        return;
+    }
+
+    net_attach_shm(fd, ch);
+    io->add_watch(ch->wait_fd());
+    shm_wake_owner[ch->wait_fd()] = fd;
+    std::cout << "[Server] Connection " << fd << " switched to shared-memory rings." << std::endl;
+}
+
+// [新增] 已登录的连接申请 UDP 通道：下发 conn_id/token，客户端发 HELLO 后切换
+static void offer_udp(int fd) {
+    TransportUdpPacket resp;
+    memset(&resp, 0, sizeof(resp));
+    resp.type = TYPE_TRANSPORT_UDP;
+    resp.result = RET_FAIL_DUP;
+    if (client_buffers[fd].logged_in && udp_server.offer(fd, resp.conn_id, resp.token)) {
+        resp.result = RET_SUCCESS;
+        resp.port = udp_server.port();
+    }
+    net_send(fd, &resp, sizeof(resp));
+}
+
+// [新增] UDP 上收齐的消息：输入和可靠消息都是整数个 GamePacket
+static void on_udp_message(int fd, const char* data, size_t len, RoomManager& room_mgr) {
+    auto it = client_buffers.find(fd);
+    if (it == client_buffers.end() || !it->second.logged_in) return;
+    long long now = get_current_ms();
+    reaper->on_data(fd, now); // 战斗输入只走 UDP 时 TCP 上可能一直没数据
+    for (size_t off = 0; off + sizeof(GamePacket) <= len; off += sizeof(GamePacket)) {
+        GamePacket pkt;
+        memcpy(&pkt, data + off, sizeof(pkt));
+        if (admission->check(fd, ADMIT_CLASS_GAME, now) != ADMIT_PASS) continue;
+        if (pkt.type == TYPE_MOVE || pkt.type == TYPE_ATTACK || pkt.type == TYPE_SPELL ||
+            pkt.type == TYPE_SELECT || pkt.type == TYPE_BUY_ITEM ||
+            pkt.type == TYPE_SKILL_U || pkt.type == TYPE_SKILL_I) {
+            room_mgr.handle_game_packet(fd, pkt);
+        }
+    }
+}
+
+// [新增] 包的优先级分类
+static int packet_class(int type) {
+    if (type == TYPE_LOGIN_REQ || type == TYPE_REG_REQ) return ADMIT_CLASS_LOGIN;
+    if (type == TYPE_PONG || type == TYPE_MOVE || type == TYPE_ATTACK || type == TYPE_SPELL ||
+        type == TYPE_SELECT || type == TYPE_BUY_ITEM || type == TYPE_SKILL_U || type == TYPE_SKILL_I ||
+        type == TYPE_LOCKSTEP_DESYNC || type == TYPE_LOCKSTEP_READY) return ADMIT_CLASS_GAME;
+    return ADMIT_CLASS_LOBBY;
+}
+
+// [新增] 过载时的拒绝应答：登录/注册回失败码，其余大厅请求回 TYPE_SERVER_BUSY
+static void reply_busy(int fd, int type) {
+    if (type == TYPE_LOGIN_REQ || type == TYPE_REG_REQ) {
+        LoginResponsePacket resp;
+        memset(&resp, 0, sizeof(resp));
+        resp.type = (type == TYPE_LOGIN_REQ ? TYPE_LOGIN_RESP : TYPE_REG_RESP);
+        resp.result = RET_FAIL_BUSY;
+        net_send(fd, &resp, sizeof(resp));
+    } else {
+        int t = TYPE_SERVER_BUSY;
+        net_send(fd, &t, sizeof(t));
+    }
+}
+
+// 解析并分发连接缓冲区里的完整包；遇到登录/注册时暂停，等认证结果回来再继续
+static void process_client_buffer(int fd, RoomManager& room_mgr, AuthService& auth) {
+    ClientBuffer& buf_obj = client_buffers[fd];
+    int ptr = 0;
+    while (!buf_obj.auth_pending && buf_obj.len - ptr >= 4) {
+        int type = *(int*)(buf_obj.data + ptr);
+        size_t pkt_len = 0;
+
+        // 根据类型判定包长度
+        if (type == TYPE_LOGIN_REQ || type == TYPE_REG_REQ) pkt_len = sizeof(LoginPacket);
+        else if (type == TYPE_TRANSPORT_SHM || type == TYPE_TRANSPORT_UDP) pkt_len = sizeof(int);
+        else if (type == TYPE_ROOM_LIST_REQ || type == TYPE_MATCH_REQ || 
+                 type == TYPE_CREATE_ROOM || type == TYPE_LEAVE_ROOM || type == TYPE_GAME_START) pkt_len = sizeof(int);
+        else if (type == TYPE_JOIN_ROOM || type == TYPE_ROOM_UPDATE) pkt_len = sizeof(RoomControlPacket);
+        else if (type == TYPE_ROOM_PAGE_REQ) pkt_len = sizeof(RoomPageRequest);
+        else if (type == TYPE_SPECTATE) pkt_len = sizeof(SpectatePacket);
+        else if (type == TYPE_PONG) pkt_len = sizeof(PingPacket);
+        else if (type == TYPE_MOVE || type == TYPE_ATTACK || type == TYPE_SPELL || 
+                 type == TYPE_SELECT || type == TYPE_BUY_ITEM || 
+                 type == TYPE_SKILL_U || type == TYPE_SKILL_I || type == TYPE_LOCKSTEP_DESYNC ||
+                 type == TYPE_LOCKSTEP_READY) pkt_len = sizeof(GamePacket);
+
+        // 长度非法或数据不足，跳出循环等待后续数据
+        if (pkt_len == 0) { 
+            buf_obj.len = 0; // 发生未知错误，重置缓冲区
+            ptr = 0;
+            break; 
+        } 
+        if (buf_obj.len - ptr < (int)pkt_len) break; 
+
+        void* pdata = buf_obj.data + ptr;
+
+        // [新增] 限速/过载检查：超速的直接丢弃，过载时大厅和登录请求回"忙"
+        int verdict = admission->check(fd, packet_class(type), get_current_ms());
+        if (verdict != ADMIT_PASS) {
+            if (verdict == ADMIT_SHED) reply_busy(fd, type);
+            ptr += pkt_len;
+            continue;
+        }
+
+        // 分发处理
+        if ((type == TYPE_LOGIN_REQ || type == TYPE_REG_REQ) && auth_outstanding >= ADMIT_MAX_AUTH_QUEUE) {
+            // [新增] 认证线程积压太多，不再排队
+            admission->count_rejected_login();
+            reply_busy(fd, type);
+        }
+        else if (type == TYPE_LOGIN_REQ || type == TYPE_REG_REQ) {
+            // [修改] 交给认证线程池，结果回到主循环后再回包并继续解析
+            LoginPacket* pkt = (LoginPacket*)pdata;
+            AuthRequest req;
+            memset(&req, 0, sizeof(req));
+            req.fd = fd;
+            req.gen = buf_obj.gen;
+            req.type = type;
+            memcpy(req.username, pkt->username, sizeof(req.username));
+            memcpy(req.password, pkt->password, sizeof(req.password));
+            auth.submit(req);
+            auth_outstanding++;
+            buf_obj.auth_pending = true;
+        }
+        else if (type == TYPE_TRANSPORT_SHM) {
+            upgrade_to_shm(fd);
+        }
+        else if (type == TYPE_TRANSPORT_UDP) {
+            offer_udp(fd);
+        }
+        else if (type == TYPE_SPECTATE) {
+            room_mgr.handle_spectate(fd, *(SpectatePacket*)pdata);
+        }
+        else if (type == TYPE_PONG) {
+            long long now = get_current_ms();
+            latency->on_pong(fd, *(PingPacket*)pdata, now);
+            reaper->on_heartbeat(fd, now);
+        }
+        else if (type >= 20 && type <= 29) {
+            // 大厅与房间控制 (TYPE_JOIN_ROOM 会在这里被处理)
+            if (type == TYPE_ROOM_UPDATE) {
+                room_mgr.handle_room_control(fd, *(RoomControlPacket*)pdata); 
+            }
+            else {
+                // 修正点：直接传递 pdata，RoomManager 内部会按照 RoomControlPacket 解析
+                room_mgr.handle_lobby_packet(fd, type, pdata);
+            }
+        }
+        else {
+            // 游戏内逻辑
+            room_mgr.handle_game_packet(fd, *(GamePacket*)pdata);
+        }
+
+        ptr += pkt_len;
+    }
+
+    // 移动剩余数据
+    if (ptr > 0) {
+        if (ptr < buf_obj.len) memmove(buf_obj.data, buf_obj.data + ptr, buf_obj.len - ptr);
+        buf_obj.len -= ptr;
+    }
+}
+
+// 收到的字节追加进连接缓冲区并解析
+// [修改] 后端一次交来的数据可能比缓冲区大，分段追加
+// [修改] 在房间里的连接立即解析；大厅/登录阶段的连接先排队，逻辑帧之后按剩余时间处理
+static void on_client_bytes(int fd, const char* data, int n, RoomManager& room_mgr, AuthService& auth) {
+    ClientBuffer& buf_obj = client_buffers[fd];
+    if (n > 0) reaper->on_data(fd, get_current_ms());
+    bool urgent = room_mgr.room_of(fd) != 0;
+    while (n > 0) {
+        if (buf_obj.len == (int)sizeof(buf_obj.data)) {
+            if (!urgent) process_client_buffer(fd, room_mgr, auth); // 排队的连接攒满了，先解析腾地方
+            if (buf_obj.len == (int)sizeof(buf_obj.data)) {
+                // 简单处理缓冲区溢出
+                buf_obj.len = 0;
+            }
+        }
+        int take = std::min(n, (int)sizeof(buf_obj.data) - buf_obj.len);
+        memcpy(buf_obj.data + buf_obj.len, data, take);
+        buf_obj.len += take;
+        data += take;
+        n -= take;
+
+        if (urgent) process_client_buffer(fd, room_mgr, auth);
+    }
+    if (!urgent && !buf_obj.queued) {
+        buf_obj.queued = true;
+        (admission->authed(fd) ? deferred_lobby : deferred_login).push_back(fd);
     }
 }
 
-int main() {
-    int server_fd = socket(AF_INET, SOCK_STREAM, 0);
-    if (server_fd < 0) {
-        perror("socket failed");
-        return -1;
+// [新增] 解析排队中的连接，直到 deadline (至少处理一条，免得一直饿着)；没轮到的留到下一轮
+static void process_deferred(long long deadline, RoomManager& room_mgr, AuthService& auth) {
+    bool first = true;
+    for (std::deque<int>* q : { &deferred_lobby, &deferred_login }) {
+        while (!q->empty() && (first || get_current_ms() < deadline)) {
+            int fd = q->front();
+            q->pop_front();
+            auto it = client_buffers.find(fd);
+            if (it == client_buffers.end() || !it->second.queued) continue; // 已断开
+            it->second.queued = false;
+            process_client_buffer(fd, room_mgr, auth);
+            first = false;
+        }
+    }
+}
+
+static void accept_client(int client_fd) {
+    // [新增] 过载或握手中的连接太多：回一个忙就关掉
+    if (!admission->admit_connection()) {
+        LoginResponsePacket resp;
+        memset(&resp, 0, sizeof(resp));
+        resp.type = TYPE_LOGIN_RESP;
+        resp.result = RET_FAIL_BUSY;
+        write(client_fd, &resp, sizeof(resp));
+        close(client_fd);
+        admission->count_rejected_connection();
+        return;
+    }
+    admission->add(client_fd, get_current_ms());
+    io->add_stream(client_fd);
+    client_buffers[client_fd] = {{0}, 0, next_conn_gen++, false, false, false};
+    reaper->add(client_fd, get_current_ms());
+    std::cout << "[Server] New connection: " << client_fd << std::endl;
+}
+
+// 登录/注册结果回包；登录还要在主循环标记在线 (与断线处理同一线程)
+static void finish_auth(int fd, ClientBuffer& buf_obj, int type, int result, const char* username, UserManager& user_mgr) {
+    int ret = result;
+    if (type == TYPE_LOGIN_REQ && ret == RET_SUCCESS) ret = user_mgr.mark_online(fd, username);
+    if (type == TYPE_LOGIN_REQ && ret == RET_SUCCESS) buf_obj.logged_in = true;
+    if (ret == RET_SUCCESS) {
+        reaper->on_authed(fd);
+        admission->on_authed(fd);
+    }
+
+    LoginResponsePacket resp; 
+    memset(&resp, 0, sizeof(resp));
+    resp.type = (type == TYPE_LOGIN_REQ ? TYPE_LOGIN_RESP : TYPE_REG_RESP);
+    resp.result = ret; 
+    resp.user_id = fd; 
+    net_send(fd, &resp, sizeof(resp));
+}
+
+// [新增] 认证完成：回包，然后继续解析该连接暂停期间积压的包
+static void on_auth_done(RoomManager& room_mgr, UserManager& user_mgr, AuthService& auth) {
+    static std::vector<AuthResult> auth_results;
+    auth_results.clear();
+    auth.drain(auth_results);
+    auth_outstanding -= (int)auth_results.size();
+    for (const AuthResult& r : auth_results) {
+        auto it = client_buffers.find(r.fd);
+        if (it == client_buffers.end() || it->second.gen != r.gen) continue; // 连接已断开
+
+        finish_auth(r.fd, it->second, r.type, r.result, r.username, user_mgr);
+        it->second.auth_pending = false;
+        process_client_buffer(r.fd, room_mgr, auth);
+    }
+}
+
+// [新增] 前端 reactor 交过来的连接：登录已在前端校验过的，这里标记在线并回包，再接着处理后续字节
+static void on_handoff(RoomManager& room_mgr, UserManager& user_mgr, AuthService& auth, ReactorPool& reactors) {
+    static std::vector<ConnHandoff> handoffs;
+    handoffs.clear();
+    reactors.drain(handoffs);
+    for (const ConnHandoff& h : handoffs) {
+        ClientBuffer& buf_obj = client_buffers[h.fd];
+        buf_obj = {{0}, 0, next_conn_gen++, false, false, false};
+        io->add_stream(h.fd);
+        reaper->add(h.fd, get_current_ms(), h.accepted_ms); // 登录超时接着 reactor 那边的算，不重新计时
+        admission->add(h.fd, get_current_ms());
+        std::cout << "[Server] New connection: " << h.fd << " (from reactor)" << std::endl;
+        if (h.authed) finish_auth(h.fd, buf_obj, TYPE_LOGIN_REQ, RET_SUCCESS, h.username, user_mgr);
+        on_client_bytes(h.fd, h.pending.data(), (int)h.pending.size(), room_mgr, auth);
+    }
+}
+
+// [新增] 共享内存连接有新数据：读空环，再宣布进入睡眠 (期间又来数据就继续读)
+static void on_shm_wakeup(int fd, RoomManager& room_mgr, AuthService& auth) {
+    ShmChannel* ch = net_shm_of(fd);
+    ch->ack_wakeup();
+    char recv_buf[2048];
+    do {
+        ssize_t n_read;
+        while ((n_read = net_recv(fd, recv_buf, sizeof(recv_buf))) > 0) {
+            on_client_bytes(fd, recv_buf, (int)n_read, room_mgr, auth);
+        }
+    } while (!ch->prepare_wait());
+
+    // [新增] 对端改坏了共享内存里的游标：关掉 Unix socket 的读端，由 I/O 后端按断开走正常清理
+    if (ch->broken()) {
+        std::cout << "[Server] Connection " << fd << " corrupted its shared-memory ring, closing." << std::endl;
+        shutdown(fd, SHUT_RDWR);
+    }
+}
+
+static void on_client_closed(int fd, RoomManager& room_mgr, UserManager& user_mgr) {
+    std::cout << "[Server] Client disconnected: " << fd << std::endl;
+    io->remove(fd);
+    ShmChannel* ch = net_shm_of(fd);
+    if (ch) {
+        io->remove(ch->wait_fd());
+        shm_wake_owner.erase(ch->wait_fd());
+    }
+    udp_server.drop(fd);
+    latency->remove(fd);
+    reaper->remove(fd);
+    admission->remove(fd);
+    net_close(fd); // 共享内存通道随连接一起释放
+    client_buffers.erase(fd);
+    room_mgr.on_player_disconnect(fd);
+    user_mgr.logout_user(fd);
+}
+
+// 用法: ./server [--room-node 地址]... [--unix 路径] [--udp-sim 丢包%/延迟ms/抖动ms] [--io epoll|uring] [--reactors N] [--lockstep]
+// 不带参数时所有房间在本进程内运行；带上房间服务器地址时本进程只做网关 (连接/登录/大厅/匹配)，
+// 房间按负载分到各个 room_server 进程，例如:
+//   ./room_server unix:/tmp/moba_room1.sock &
+//   ./room_server unix:/tmp/moba_room2.sock &
+//   ./server --room-node unix:/tmp/moba_room1.sock --room-node unix:/tmp/moba_room2.sock
+// --unix 额外监听一个 Unix socket，同机的机器人/网关可以从这里接入，并可再升级为共享内存通道
+// --udp-sim 给服务器发出的 UDP 数据报加上丢包/延迟/抖动，例如 --udp-sim 5/60/20
+// --io 选择主循环的 I/O 后端，默认 epoll；uring 在内核不支持时自动退回 epoll
+// --reactors N 起 N 个接入线程分担 accept 和登录校验，登录后的连接交回主循环
+// --lockstep 本进程里的房间对支持的客户端改用帧同步 (只发输入)；集群部署时加在 room_server 上
+int main(int argc, char** argv) {
+    std::vector<std::string> room_nodes;
+    const char* unix_path = nullptr;
+    const char* io_name = "epoll";
+    int n_reactors = 0;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--room-node") == 0) room_nodes.push_back(argv[++i]);
+        else if (strcmp(argv[i], "--unix") == 0) unix_path = argv[++i];
+        else if (strcmp(argv[i], "--io") == 0) io_name = argv[++i];
+        else if (strcmp(argv[i], "--reactors") == 0) n_reactors = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--udp-sim") == 0) {
+            if (!udp_server.sim.parse(argv[++i])) {
+                std::cerr << "bad --udp-sim, expected loss/latency/jitter" << std::endl;
+                return -1;
+            }
+        }
+    }
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--lockstep") == 0) GameRoom::set_lockstep_enabled(true);
     }
 
-    int opt = 1; 
-    setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    // [修改] 开了前端 reactor 时，TCP 端口由各 reactor 自己的 SO_REUSEPORT socket 监听
+    int server_fd = -1;
+    if (n_reactors <= 0) {
+        server_fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (server_fd < 0) {
+            perror("socket failed");
+            return -1;
+        }
+
+        int opt = 1; 
+        setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
     
-    int flag = 1;
-    setsockopt(server_fd, IPPROTO_TCP, TCP_NODELAY, (char *)&flag, sizeof(int));
+        int flag = 1;
+        setsockopt(server_fd, IPPROTO_TCP, TCP_NODELAY, (char *)&flag, sizeof(int));
     
-    sockaddr_in address;
-    memset(&address, 0, sizeof(address));
-    address.sin_family = AF_INET;
-    address.sin_addr.s_addr = INADDR_ANY;
-    address.sin_port = htons(PORT);
+        sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = INADDR_ANY;
+        address.sin_port = htons(PORT);
 
-    if (bind(server_fd, (struct sockaddr*)&address, sizeof(address)) < 0) {
-        perror("bind failed");
-        return -1;
+        if (bind(server_fd, (struct sockaddr*)&address, sizeof(address)) < 0) {
+            perror("bind failed");
+            return -1;
+        }
+
+        if (listen(server_fd, 1024) < 0) {
+            perror("listen failed");
+            return -1;
+        }
     }
 
-    if (listen(server_fd, 1024) < 0) {
-        perror("listen failed");
-        return -1;
+    int unix_fd = -1;
+    if (unix_path) {
+        unix_fd = unix_listen(unix_path);
+        if (unix_fd < 0) {
+            perror("unix listen failed");
+            return -1;
+        }
     }
 
     UserManager user_mgr;
-    RoomManager room_mgr(&user_mgr);
+    RoomManager room_mgr(&user_mgr, room_nodes);
+
+    latency = new LatencyMonitor(get_current_ms());
+    latency->room_of = [&](int fd) { return room_mgr.room_of(fd); };
+    reaper = new IdleReaper(get_current_ms());
+    std::vector<int> expired;
+
+    // [新增] 登录/注册工作线程，完成后经 eventfd 通知主循环
+    AuthService auth(&user_mgr, AUTH_WORKERS);
+
+    // [新增] 前端接入线程
+    ReactorPool reactors(&user_mgr);
+    if (n_reactors > 0 && !reactors.start(PORT, n_reactors)) return -1;
 
     // 启动后台持久化线程
     std::thread bg_saver(data_persistence_thread, &user_mgr);
     bg_saver.detach(); 
     std::cout << "[Server] Background persistence thread started." << std::endl;
 
-    int epoll_fd = epoll_create1(0);
-    epoll_event ev, events[MAX_EVENTS];
-    ev.events = EPOLLIN;
-    ev.data.fd = server_fd;
-    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, server_fd, &ev);
+    // [修改] 所有 fd 交给 I/O 后端；客户端数据由后端读出后回调，其它 fd 只通知可读
+    io = create_io_backend(io_name);
+    std::cout << "[Server] I/O backend: " << io->name() << std::endl;
+    set_net_stream_writer([](int fd, const void* buf, size_t len) { return io->send(fd, buf, len); });
+    set_net_stream_backlog([](int fd) { return io->queued_bytes(fd); });
+    room_mgr.on_node_closing = [](int fd) { io->remove(fd); };
+
+    IoHandlers handlers;
+    handlers.on_accept = [](int listen_fd, int fd) {
+        (void)listen_fd;
+        accept_client(fd);
+    };
+    handlers.on_data = [&](int fd, const char* data, int len) {
+        on_client_bytes(fd, data, len, room_mgr, auth);
+    };
+    handlers.on_closed = [&](int fd) {
+        on_client_closed(fd, room_mgr, user_mgr);
+    };
+    handlers.on_readable = [&](int fd) {
+        if (fd == auth.event_fd()) {
+            on_auth_done(room_mgr, user_mgr, auth);
+        } else if (fd == reactors.event_fd()) {
+            on_handoff(room_mgr, user_mgr, auth, reactors);
+        } else if (fd == udp_server.fd()) {
+            // [新增] UDP 数据报：更新确认状态，收齐的输入/可靠消息交给房间
+            udp_server.on_readable([&](int cfd, int kind, const char* data, size_t len) {
+                (void)kind;
+                on_udp_message(cfd, data, len, room_mgr);
+            });
+        } else if (room_mgr.is_node_fd(fd)) {
+            // [新增] 房间服务器回来的事件 / 发给玩家的数据 (断开时经 on_node_closing 注销后随节点关闭)
+            room_mgr.on_node_readable(fd);
+        } else {
+            auto it = shm_wake_owner.find(fd);
+            if (it != shm_wake_owner.end()) on_shm_wakeup(it->second, room_mgr, auth);
+        }
+    };
+    io->set_handlers(handlers);
+
+    if (server_fd >= 0) io->add_listener(server_fd);
+    if (unix_fd >= 0) {
+        io->add_listener(unix_fd);
+        std::cout << "[Server] Also listening on unix:" << unix_path << std::endl;
+    }
+    io->add_watch(auth.event_fd());
+    if (reactors.size() > 0) io->add_watch(reactors.event_fd());
+    if (udp_server.open(PORT)) {
+        io->add_watch(udp_server.fd());
+        std::cout << "[Server] UDP game channel on port " << PORT;
+        if (udp_server.sim.active()) {
+            std::cout << " (simulating " << udp_server.sim.loss_pct << "% loss, " << udp_server.sim.latency_ms
+                      << "+-" << udp_server.sim.jitter_ms << "ms)";
+        }
+        std::cout << std::endl;
+    } else {
+        std::cout << "[Server] UDP port unavailable, game traffic stays on TCP." << std::endl;
+    }
+    for (int node_fd : room_mgr.node_fds()) io->add_watch(node_fd);
 
     std::cout << "[Server] Listening on port " << PORT << "..." << std::endl;
 
     const int TICK_MS = 33; // 约30FPS
     long long last_tick_time = get_current_ms();
+    admission = new AdmissionControl(TICK_MS, last_tick_time);
 
     while (true) {
         long long now = get_current_ms();
         long long elapsed = now - last_tick_time;
         int wait_ms = TICK_MS - (int)elapsed;
         if (wait_ms < 0) wait_ms = 0; 
+        int sim_wait = udp_server.next_wakeup_ms(); // 模拟延迟的数据报要按时发出
+        if (sim_wait >= 0 && sim_wait < wait_ms) wait_ms = sim_wait;
         
-        int n = epoll_wait(epoll_fd, events, MAX_EVENTS, wait_ms);
-
-        for (int i = 0; i < n; i++) {
-            if (events[i].data.fd == server_fd) {
-                sockaddr_in client_addr; 
-                socklen_t len = sizeof(client_addr);
-                int client_fd = accept(server_fd, (struct sockaddr*)&client_addr, &len);
-                if (client_fd >= 0) {
-                    setNonBlocking(client_fd);
-                    ev.events = EPOLLIN | EPOLLET; 
-                    ev.data.fd = client_fd;
-                    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client_fd, &ev);
-                    client_buffers[client_fd] = {{0}, 0};
-                    std::cout << "[Server] New connection: " << client_fd << std::endl;
-                }
-            } else {
-                int fd = events[i].data.fd;
-                char recv_buf[2048];
-                int n_read = read(fd, recv_buf, sizeof(recv_buf));
-                
-                if (n_read <= 0) {
-                    if (n_read < 0 && errno == EAGAIN) continue;
-                    std::cout << "[Server] Client disconnected: " << fd << std::endl;
-                    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
-                    close(fd);
-                    client_buffers.erase(fd);
-                    room_mgr.on_player_disconnect(fd);
-                    user_mgr.logout_user(fd);
-                } else {
-                    ClientBuffer& buf_obj = client_buffers[fd];
-                    if (buf_obj.len + n_read > 10240) { 
-                        // 简单处理缓冲区溢出
-                        buf_obj.len = 0; 
-                    } 
-                    memcpy(buf_obj.data + buf_obj.len, recv_buf, n_read);
-                    buf_obj.len += n_read;
-
-                    int ptr = 0;
-                    while (buf_obj.len - ptr >= 4) {
-                        int type = *(int*)(buf_obj.data + ptr);
-                        size_t pkt_len = 0;
-
-                        // 根据类型判定包长度
-                        if (type == TYPE_LOGIN_REQ || type == TYPE_REG_REQ) pkt_len = sizeof(LoginPacket);
-                        else if (type == TYPE_ROOM_LIST_REQ || type == TYPE_MATCH_REQ || 
-                                 type == TYPE_CREATE_ROOM || type == TYPE_LEAVE_ROOM || type == TYPE_GAME_START) pkt_len = sizeof(int);
-                        else if (type == TYPE_JOIN_ROOM || type == TYPE_ROOM_UPDATE) pkt_len = sizeof(RoomControlPacket);
-                        else if (type == TYPE_MOVE || type == TYPE_ATTACK || type == TYPE_SPELL || 
-                                 type == TYPE_SELECT || type == TYPE_BUY_ITEM || 
-                                 type == TYPE_SKILL_U || type == TYPE_SKILL_I) pkt_len = sizeof(GamePacket);
-
-                        // 长度非法或数据不足，跳出循环等待后续数据
-                        if (pkt_len == 0) { 
-                            buf_obj.len = 0; // 发生未知错误，重置缓冲区
-                            break; 
-                        } 
-                        if (buf_obj.len - ptr < (int)pkt_len) break; 
-
-                        void* pdata = buf_obj.data + ptr;
-
-                        // 分发处理
-                        if (type == TYPE_LOGIN_REQ || type == TYPE_REG_REQ) {
-                            LoginPacket* pkt = (LoginPacket*)pdata;
-                            LoginResponsePacket resp; 
-                            memset(&resp, 0, sizeof(resp));
-                            resp.type = (type == TYPE_LOGIN_REQ ? TYPE_LOGIN_RESP : TYPE_REG_RESP);
-                            int ret = (type == TYPE_REG_REQ) ? user_mgr.register_user(pkt->username, pkt->password) : user_mgr.login_user(fd, pkt->username, pkt->password);
-                            resp.result = ret; 
-                            resp.user_id = fd; 
-                            write(fd, &resp, sizeof(resp));
-                        }
-                        else if (type >= 20 && type <= 29) {
-                            // 大厅与房间控制 (TYPE_JOIN_ROOM 会在这里被处理)
-                            if (type == TYPE_ROOM_UPDATE) {
-                                room_mgr.handle_room_control(fd, *(RoomControlPacket*)pdata); 
-                            }
-                            else {
-                                // 修正点：直接传递 pdata，RoomManager 内部会按照 RoomControlPacket 解析
-                                room_mgr.handle_lobby_packet(fd, type, pdata);
-                            }
-                        }
-                        else {
-                            // 游戏内逻辑
-                            room_mgr.handle_game_packet(fd, *(GamePacket*)pdata);
-                        }
-
-                        ptr += pkt_len;
-                    }
-
-                    // 移动剩余数据
-                    if (ptr > 0) {
-                        if (ptr < buf_obj.len) memmove(buf_obj.data, buf_obj.data + ptr, buf_obj.len - ptr);
-                        buf_obj.len -= ptr;
-                    }
-                }
-            }
-        }
+        io->poll(wait_ms);
+
+        // 本轮转发给房间服务器的输入立即写出，不等到下一帧
+        room_mgr.flush_nodes();
 
         // 逻辑帧更新
         now = get_current_ms();
         if (now - last_tick_time >= TICK_MS) {
+            long long late = now - last_tick_time - TICK_MS;
             room_mgr.update_all();
+            admission->on_tick(late, get_current_ms() - now, now);
+            if (reactors.size() > 0) {
+                // [新增] reactor 的 accept/登录也按同一个过载状态拒绝，握手中的连接数两边合计，拒绝数计入同一份统计
+                unsigned long long rejected, throttled, shed;
+                reactors.set_admission(admission->overloaded(), admission->pending_conns());
+                admission->set_reactor_pending(reactors.pending());
+                reactors.take_counts(rejected, throttled, shed);
+                admission->count_rejected_connection(rejected);
+                admission->count_dropped(ADMIT_CLASS_LOGIN, throttled, shed);
+            }
             last_tick_time = now;
         }
+
+        // [新增] 对局之外的连接：用本帧剩下的时间解析
+        process_deferred(last_tick_time + TICK_MS, room_mgr, auth);
+        now = get_current_ms();
+
+        // [新增] 到时间的连接发 PING，每个统计周期打印一次延迟分布
+        latency->update(now);
+
+        // [新增] 超时的连接按正常断线处理 (退出房间、下线)
+        expired.clear();
+        reaper->collect(now, expired);
+        for (int fd : expired) on_client_closed(fd, room_mgr, user_mgr);
+
+        // 本帧的快照/可靠消息/ack 写成数据报 (超出速率预算的快照在这里被跳过)
+        udp_server.flush();
+
+        // uring: 本轮攒下的连接发送在下一次 poll 时和等待一起提交，这里不用单独进内核
     }
     
-    close(server_fd);
+    if (server_fd >= 0) close(server_fd);
     return 0;
 }
\ No newline at end of file
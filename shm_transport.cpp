@@ -0,0 +1,242 @@
+#include "shm_transport.h"
+#include "protocol.h"
+#include <cstring>
+#include <new>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// 每个方向: [头部][数据]，两个方向依次排列
+static size_t ring_span(size_t ring_bytes) {
+    return sizeof(ShmRingHeader) + ring_bytes;
+}
+
+ShmChannel::ShmChannel()
+    : mem_fd(-1), efd_c2s(-1), efd_s2c(-1), map_bytes(0), server_side(false), ring_cap(0), corrupt(false), base(nullptr),
+      in_hdr(nullptr), in_data(nullptr), out_hdr(nullptr), out_data(nullptr) {}
+
+ShmChannel::~ShmChannel() {
+    if (base) munmap(base, map_bytes);
+    if (mem_fd >= 0) close(mem_fd);
+    if (efd_c2s >= 0) close(efd_c2s);
+    if (efd_s2c >= 0) close(efd_s2c);
+}
+
+bool ShmChannel::map(size_t ring_bytes, bool server) {
+    map_bytes = ring_span(ring_bytes) * 2;
+    void* p = mmap(nullptr, map_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, mem_fd, 0);
+    if (p == MAP_FAILED) { base = nullptr; return false; }
+    base = (char*)p;
+    ring_cap = ring_bytes;
+
+    ShmRingHeader* c2s = (ShmRingHeader*)base;
+    ShmRingHeader* s2c = (ShmRingHeader*)(base + ring_span(ring_bytes));
+    server_side = server;
+    in_hdr = server ? c2s : s2c;
+    out_hdr = server ? s2c : c2s;
+    in_data = (char*)in_hdr + sizeof(ShmRingHeader);
+    out_data = (char*)out_hdr + sizeof(ShmRingHeader);
+    return true;
+}
+
+ShmChannel* ShmChannel::create(size_t ring_bytes) {
+    if (ring_bytes == 0 || (ring_bytes & (ring_bytes - 1)) != 0) return nullptr;
+
+    ShmChannel* ch = new ShmChannel();
+    ch->mem_fd = memfd_create("moba_conn", MFD_CLOEXEC);
+    ch->efd_c2s = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    ch->efd_s2c = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (ch->mem_fd < 0 || ch->efd_c2s < 0 || ch->efd_s2c < 0 ||
+        ftruncate(ch->mem_fd, ring_span(ring_bytes) * 2) < 0 || !ch->map(ring_bytes, true)) {
+        delete ch;
+        return nullptr;
+    }
+
+    // 新建的 memfd 内容全为 0，只需在原地构造头部
+    for (ShmRingHeader* h : { ch->in_hdr, ch->out_hdr }) {
+        new (h) ShmRingHeader();
+        h->head.store(0);
+        h->tail.store(0);
+        h->sleeping.store(0);
+        h->capacity = (uint32_t)ring_bytes;
+    }
+    return ch;
+}
+
+ShmChannel* ShmChannel::attach(int mem_fd, int efd_c2s, int efd_s2c) {
+    ShmChannel* ch = new ShmChannel();
+    ch->mem_fd = mem_fd;
+    ch->efd_c2s = efd_c2s;
+    ch->efd_s2c = efd_s2c;
+
+    // 先只映射头部取出容量，再映射整块
+    void* p = mmap(nullptr, sizeof(ShmRingHeader), PROT_READ, MAP_SHARED, mem_fd, 0);
+    if (p == MAP_FAILED) { delete ch; return nullptr; }
+    size_t ring_bytes = ((ShmRingHeader*)p)->capacity;
+    munmap(p, sizeof(ShmRingHeader));
+
+    if (ring_bytes == 0 || (ring_bytes & (ring_bytes - 1)) != 0 || !ch->map(ring_bytes, false)) {
+        delete ch;
+        return nullptr;
+    }
+    return ch;
+}
+
+size_t ShmChannel::write(const void* data, size_t len) {
+    uint64_t head = out_hdr->head.load(std::memory_order_relaxed);
+    uint64_t tail = out_hdr->tail.load(std::memory_order_acquire);
+    size_t cap = ring_cap;
+    uint64_t used = head - tail;
+    if (corrupt || used > cap) { corrupt = true; return 0; }
+    size_t space = cap - (size_t)used;
+    if (len > space || len == 0) return 0;
+
+    size_t pos = (size_t)(head & (cap - 1));
+    size_t first = (len < cap - pos) ? len : cap - pos;
+    memcpy(out_data + pos, data, first);
+    memcpy(out_data, (const char*)data + first, len - first);
+    out_hdr->head.store(head + len, std::memory_order_seq_cst);
+
+    // 对端已宣布要睡眠才发 eventfd；忙着消费时不产生任何系统调用
+    if (out_hdr->sleeping.exchange(0, std::memory_order_seq_cst) != 0) {
+        uint64_t one = 1;
+        ssize_t r = ::write(peer_fd(), &one, sizeof(one));
+        (void)r;
+    }
+    return len;
+}
+
+size_t ShmChannel::read(void* buf, size_t len) {
+    uint64_t tail = in_hdr->tail.load(std::memory_order_relaxed);
+    uint64_t head = in_hdr->head.load(std::memory_order_acquire);
+    size_t cap = ring_cap;
+    uint64_t avail = head - tail;
+    if (corrupt || avail > cap) { corrupt = true; return 0; } // 对端写的 head 不可信
+    if (len > avail) len = (size_t)avail;
+    if (len == 0) return 0;
+
+    size_t pos = (size_t)(tail & (cap - 1));
+    size_t first = (len < cap - pos) ? len : cap - pos;
+    memcpy(buf, in_data + pos, first);
+    memcpy((char*)buf + first, in_data, len - first);
+    in_hdr->tail.store(tail + len, std::memory_order_release);
+    return len;
+}
+
+// 与 write 中的 "写 head -> 交换 sleeping" 配对 (都用 seq_cst)，保证不会丢唤醒
+bool ShmChannel::prepare_wait() {
+    if (corrupt) return true; // 环已不可用，别再循环读
+    in_hdr->sleeping.store(1, std::memory_order_seq_cst);
+    if (in_hdr->head.load(std::memory_order_seq_cst) != in_hdr->tail.load(std::memory_order_relaxed)) {
+        in_hdr->sleeping.store(0, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+void ShmChannel::ack_wakeup() {
+    uint64_t v;
+    ssize_t r = ::read(wait_fd(), &v, sizeof(v));
+    (void)r;
+}
+
+// =========================================
+// Unix socket / 文件描述符传递
+// =========================================
+
+int unix_listen(const char* path) {
+    sockaddr_un sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(sa.sun_path)) return -1;
+    strcpy(sa.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path); // 清理上次异常退出留下的 socket 文件
+    if (bind(fd, (sockaddr*)&sa, sizeof(sa)) < 0 || listen(fd, 1024) < 0) {
+        close(fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    return fd;
+}
+
+int unix_connect(const char* path) {
+    sockaddr_un sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(sa.sun_path)) return -1;
+    strcpy(sa.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (connect(fd, (sockaddr*)&sa, sizeof(sa)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool send_with_fds(int sock, const void* data, size_t len, const int* fds, int nfds) {
+    iovec iov = { (void*)data, len };
+    char ctrl[CMSG_SPACE(sizeof(int) * 4)];
+    memset(ctrl, 0, sizeof(ctrl));
+
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    if (nfds > 0) {
+        msg.msg_control = ctrl;
+        msg.msg_controllen = CMSG_SPACE(sizeof(int) * nfds);
+        cmsghdr* cm = CMSG_FIRSTHDR(&msg);
+        cm->cmsg_level = SOL_SOCKET;
+        cm->cmsg_type = SCM_RIGHTS;
+        cm->cmsg_len = CMSG_LEN(sizeof(int) * nfds);
+        memcpy(CMSG_DATA(cm), fds, sizeof(int) * nfds);
+    }
+    return sendmsg(sock, &msg, MSG_NOSIGNAL) == (ssize_t)len;
+}
+
+ssize_t recv_with_fds(int sock, void* data, size_t len, int* fds, int max_fds, int* nfds) {
+    iovec iov = { data, len };
+    char ctrl[CMSG_SPACE(sizeof(int) * 4)];
+
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctrl;
+    msg.msg_controllen = sizeof(ctrl);
+
+    ssize_t n = recvmsg(sock, &msg, MSG_WAITALL | MSG_CMSG_CLOEXEC);
+    *nfds = 0;
+    for (cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+        if (cm->cmsg_level != SOL_SOCKET || cm->cmsg_type != SCM_RIGHTS) continue;
+        int count = (cm->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        for (int i = 0; i < count; i++) {
+            int fd;
+            memcpy(&fd, CMSG_DATA(cm) + i * sizeof(int), sizeof(int));
+            if (*nfds < max_fds) fds[(*nfds)++] = fd;
+            else close(fd);
+        }
+    }
+    return n;
+}
+
+ShmChannel* shm_upgrade(int unix_sock) {
+    int type = TYPE_TRANSPORT_SHM;
+    if (::write(unix_sock, &type, sizeof(type)) != sizeof(type)) return nullptr;
+
+    TransportShmPacket resp;
+    int fds[3];
+    int nfds = 0;
+    ssize_t n = recv_with_fds(unix_sock, &resp, sizeof(resp), fds, 3, &nfds);
+    if (n != sizeof(resp) || resp.type != TYPE_TRANSPORT_SHM || resp.result != RET_SUCCESS || nfds != 3) {
+        for (int i = 0; i < nfds; i++) close(fds[i]);
+        return nullptr;
+    }
+    return ShmChannel::attach(fds[0], fds[1], fds[2]);
+}
@@ -0,0 +1,85 @@
+#ifndef SHM_TRANSPORT_H
+#define SHM_TRANSPORT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <sys/types.h>
+
+// ==========================================
+// 共享内存传输 (同机的压测机器人 / 网关用)
+// 每个连接一对单生产者单消费者字节环 (c2s / s2c)，语义与 TCP 字节流相同，
+// 协议解析代码不用改。数据不经过内核，只有对端睡着时才用 eventfd 叫醒它。
+//
+// 建立方式：客户端先连 Unix socket，发 TYPE_TRANSPORT_SHM，服务器回包时
+// 用 SCM_RIGHTS 带上 memfd 和两个 eventfd；之后 Unix socket 只用来探测断开。
+// ==========================================
+
+#define SHM_RING_BYTES (1 << 20)   // 每个方向 1MB (必须是 2 的幂)
+
+// 环头部：生产者和消费者的游标放在不同的缓存行，避免来回失效
+// 两端都能写整个头部：游标和 capacity 都不可信，只能在本端私有的环大小范围内使用
+struct ShmRingHeader {
+    alignas(64) std::atomic<uint64_t> head;     // 生产者写到的位置 (单调递增)
+    alignas(64) std::atomic<uint64_t> tail;     // 消费者读到的位置
+    alignas(64) std::atomic<uint32_t> sleeping; // 消费者准备睡眠，生产者写完要发 eventfd
+    uint32_t capacity;
+};
+
+class ShmChannel {
+public:
+    // 服务器侧：新建共享内存和 eventfd
+    static ShmChannel* create(size_t ring_bytes);
+    // 客户端侧：用收到的 fd 映射同一块内存 (接管这些 fd)
+    static ShmChannel* attach(int mem_fd, int efd_c2s, int efd_s2c);
+    ~ShmChannel();
+
+    // 写入发送环：整段放得下才写，否则整段丢弃并返回 0。
+    // 调用方每次交来的都是完整的包，只写一半会让对端从半个包开始解析，后面全部错位
+    size_t write(const void* data, size_t len);
+    // 从接收环读出最多 len 字节
+    size_t read(void* buf, size_t len);
+
+    // 本端准备阻塞等待前调用：返回 false 表示期间又来了数据，应继续读而不是睡
+    bool prepare_wait();
+    // 本端被唤醒后清掉 eventfd 计数
+    void ack_wakeup();
+
+    int wait_fd() const { return server_side ? efd_c2s : efd_s2c; } // 本端等待的 eventfd
+
+    // 发现对端写坏了游标 (未读/未确认的字节超过整个环)：之后读写都返回 0，调用方应断开连接
+    bool broken() const { return corrupt; }
+
+    int mem_fd;
+    int efd_c2s;  // 客户端写入后通知服务器
+    int efd_s2c;  // 服务器写入后通知客户端
+    size_t map_bytes;
+
+private:
+    ShmChannel();
+
+    bool server_side;
+    size_t ring_cap;  // 环大小，映射时定下、只用这一份：共享内存里的 capacity 对端可以随便改
+    bool corrupt;
+    char* base;
+    ShmRingHeader* in_hdr;
+    char* in_data;
+    ShmRingHeader* out_hdr;
+    char* out_data;
+
+    bool map(size_t ring_bytes, bool server);
+    int peer_fd() const { return server_side ? efd_s2c : efd_c2s; }
+};
+
+// === Unix socket 辅助 ===
+int unix_listen(const char* path);   // 非阻塞监听 socket，失败返回 -1
+int unix_connect(const char* path);  // 阻塞连接，失败返回 -1
+
+// 随数据一起传递 / 接收文件描述符 (SCM_RIGHTS)
+bool send_with_fds(int sock, const void* data, size_t len, const int* fds, int nfds);
+ssize_t recv_with_fds(int sock, void* data, size_t len, int* fds, int max_fds, int* nfds);
+
+// 客户端：在已连接的 Unix socket 上申请共享内存通道 (阻塞)，失败返回 nullptr
+ShmChannel* shm_upgrade(int unix_sock);
+
+#endif
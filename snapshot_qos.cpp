@@ -0,0 +1,60 @@
+#include "snapshot_qos.h"
+#include <cstdlib>
+
+// 各等级视野外实体的发送间隔 (帧)
+static const int QOS_FAR_PERIOD[QOS_MAX_LEVEL + 1] = { 1, 2, 4, 4 };
+
+SnapshotQos::SnapshotQos() {
+    reset();
+}
+
+void SnapshotQos::reset() {
+    last_tick = 0;
+    interval_x8 = QOS_TICK_MS * 8;
+    overrun = false;
+    ticks = 0;
+}
+
+bool SnapshotQos::on_tick(long long now) {
+    if (last_tick != 0) {
+        int interval = (int)(now - last_tick);
+        interval_x8 += interval - interval_x8 / 8;
+    }
+    last_tick = now;
+    ticks++;
+
+    int avg = interval_x8 / 8;
+    if (!overrun && avg * 100 > QOS_TICK_MS * QOS_OVERRUN_PCT) overrun = true;
+    else if (overrun && avg * 100 < QOS_TICK_MS * QOS_HEADROOM_PCT) overrun = false;
+    return ticks % QOS_SAMPLE_TICKS == 0;
+}
+
+void SnapshotQos::adjust(int& level, int& calm, size_t backlog) const {
+    if (overrun || backlog > QOS_BACKLOG_HIGH) {
+        if (level < QOS_MAX_LEVEL) level++;
+        calm = 0;
+    } else if (level > 0 && backlog < QOS_BACKLOG_LOW && interval_x8 / 8 * 100 < QOS_TICK_MS * QOS_HEADROOM_PCT) {
+        if (++calm >= QOS_RECOVER_SAMPLES) {
+            level--;
+            calm = 0;
+        }
+    } else {
+        calm = 0;
+    }
+}
+
+bool SnapshotQos::filter(const GamePacket* frame, size_t n, int level, int phase, int hx, int hy,
+                         std::pmr::vector<GamePacket>& out) const {
+    if (level >= 3 && phase % 2 != 0) return false;
+    bool full = phase % QOS_FAR_PERIOD[level] == 0;
+
+    for (size_t i = 0; i < n; i++) {
+        const GamePacket& pkt = frame[i];
+        bool near = abs(pkt.x - hx) <= QOS_NEAR_CELLS && abs(pkt.y - hy) <= QOS_NEAR_CELLS;
+        if (pkt.type == TYPE_UPDATE && !full && !near) continue;
+        if (pkt.type == TYPE_EFFECT && level >= 2 && !near) continue;
+        out.push_back(pkt);
+        if (pkt.type == TYPE_FRAME && !full) out.back().id = level; // 部分帧
+    }
+    return true;
+}
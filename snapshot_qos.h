@@ -0,0 +1,55 @@
+#ifndef SNAPSHOT_QOS_H
+#define SNAPSHOT_QOS_H
+
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+#include "protocol.h"
+
+// 降级参数
+#define QOS_MAX_LEVEL        3
+#define QOS_TICK_MS          33          // 期望的帧间隔 (同主循环)
+#define QOS_OVERRUN_PCT      130         // 帧间隔平均超过期望的 130%：房间在落后于真实时间
+#define QOS_HEADROOM_PCT     110         // 回到 110% 以内才算有余量
+#define QOS_BACKLOG_HIGH     (64 * 1024) // 发送队列积压超过这么多字节，该客户端降一级
+#define QOS_BACKLOG_LOW      (8 * 1024)  // 低于这么多才考虑恢复
+#define QOS_SAMPLE_TICKS     8           // 每隔几帧采样一次 (查发送队列要一次系统调用)
+#define QOS_RECOVER_SAMPLES  4           // 连续几次采样都有余量才升一级
+#define QOS_NEAR_CELLS       40          // 离本人英雄这么多格以内的算视野内，不降频
+
+// --------------------------------------------------------
+// 快照降级 (每个房间一份)
+// 帧间隔变长 (主循环跟不上) 或某个客户端的发送队列积压时，逐级给客户端降级：
+//   1 级：视野外的实体隔帧才发
+//   2 级：视野外的实体每 4 帧发一次，视野外的特效不发
+//   3 级：在 2 级基础上整帧隔帧发 (帧率减半)
+// 恢复时每次只升一级。降级的帧在 TYPE_FRAME 的 id 里标上等级，客户端把没出现的实体沿用上一帧。
+// --------------------------------------------------------
+class SnapshotQos {
+public:
+    SnapshotQos();
+
+    void reset();
+
+    // 每次广播前调用 (now 为真实的单调时间，不是房间的逻辑时钟)：更新帧间隔均值；返回本帧是否要采样各客户端
+    bool on_tick(long long now);
+
+    // 采样帧里按客户端的发送队列积压 (字节) 和房间是否落后，调整它的等级
+    void adjust(int& level, int& calm, size_t backlog) const;
+
+    // 从整帧里挑出这个客户端本帧要收的包 (hx/hy 为其英雄位置，phase 错开各客户端的完整帧)；
+    // 返回 false 表示本帧整个跳过
+    bool filter(const GamePacket* frame, size_t n, int level, int phase, int hx, int hy,
+                std::pmr::vector<GamePacket>& out) const;
+
+    int tick() const { return ticks; }
+    bool behind() const { return overrun; }
+
+private:
+    long long last_tick;
+    int interval_x8;  // 帧间隔的滑动平均，x8 定点
+    bool overrun;
+    int ticks;
+};
+
+#endif
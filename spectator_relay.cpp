@@ -0,0 +1,121 @@
+#include "spectator_relay.h"
+#include "net_io.h"
+#include <algorithm>
+#include <cstring>
+
+SpectatorRelay::SpectatorRelay() {}
+
+bool SpectatorRelay::add(int fd, int room_id, int delay_sec, long long now) {
+    Feed& feed = feeds[room_id];
+    bool first = feed.viewers.empty();
+
+    Viewer v;
+    v.room_id = room_id;
+    v.delay_ms = delay_sec * 1000;
+    // 历史里已经有 (别的延迟观众留下的) 帧时，从 "now - 延迟" 那一帧接着看，否则从下一帧开始
+    v.next_seq = feed.base_seq + feed.history.size();
+    for (size_t i = 0; i < feed.history.size(); i++) {
+        if (feed.history[i].time >= now - v.delay_ms) {
+            v.next_seq = feed.base_seq + i;
+            break;
+        }
+    }
+    viewers[fd] = v;
+    feed.viewers.push_back(fd);
+    feed.max_delay_ms = std::max(feed.max_delay_ms, v.delay_ms);
+    return first;
+}
+
+int SpectatorRelay::remove(int fd, bool* unwatched) {
+    *unwatched = false;
+    auto vit = viewers.find(fd);
+    if (vit == viewers.end()) return 0;
+    int room_id = vit->second.room_id;
+    viewers.erase(vit);
+
+    auto fit = feeds.find(room_id);
+    if (fit == feeds.end()) return room_id;
+    Feed& feed = fit->second;
+    feed.viewers.erase(std::remove(feed.viewers.begin(), feed.viewers.end(), fd), feed.viewers.end());
+    if (feed.viewers.empty()) {
+        feeds.erase(fit);
+        *unwatched = true;
+        return room_id;
+    }
+
+    feed.max_delay_ms = 0;
+    for (int v : feed.viewers) feed.max_delay_ms = std::max(feed.max_delay_ms, viewers[v].delay_ms);
+    trim(feed);
+    return room_id;
+}
+
+void SpectatorRelay::close_room(int room_id, std::vector<int>& out) {
+    auto fit = feeds.find(room_id);
+    if (fit == feeds.end()) return;
+    for (int fd : fit->second.viewers) {
+        viewers.erase(fd);
+        out.push_back(fd);
+    }
+    feeds.erase(fit);
+}
+
+int SpectatorRelay::viewer_count(int room_id) const {
+    auto fit = feeds.find(room_id);
+    return fit == feeds.end() ? 0 : (int)fit->second.viewers.size();
+}
+
+void SpectatorRelay::publish(int room_id, const char* data, int len, long long now) {
+    auto fit = feeds.find(room_id);
+    if (fit == feeds.end() || len <= 0) return; // 关闭观战后在途的帧
+    Feed& feed = fit->second;
+
+    // 超出上限时丢最旧的帧，落后的延迟观众会跳过这些帧
+    if (feed.history.size() >= SPECTATE_HISTORY_MAX) {
+        feed.history.pop_front();
+        feed.base_seq++;
+    }
+    Entry e;
+    e.time = now;
+    e.frame = std::make_shared<const std::vector<char>>(data, data + len);
+    feed.history.push_back(std::move(e));
+
+    pump(feed, now);
+    trim(feed);
+}
+
+void SpectatorRelay::flush(long long now) {
+    for (auto& pair : feeds) {
+        if (pair.second.max_delay_ms == 0) continue; // 实时观众在 publish 里已经发完
+        pump(pair.second, now);
+        trim(pair.second);
+    }
+}
+
+// 给每个观众发出所有已到期的帧。帧是快照，可以丢；结算包必须送到
+void SpectatorRelay::pump(Feed& feed, long long now) {
+    unsigned long long end_seq = feed.base_seq + feed.history.size();
+    for (int fd : feed.viewers) {
+        Viewer& v = viewers[fd];
+        if (v.next_seq < feed.base_seq) v.next_seq = feed.base_seq;
+        while (v.next_seq < end_seq) {
+            const Entry& e = feed.history[v.next_seq - feed.base_seq];
+            if (e.time + v.delay_ms > now) break;
+
+            const std::vector<char>& buf = *e.frame;
+            int type = 0;
+            memcpy(&type, buf.data(), std::min(sizeof(type), buf.size()));
+            net_send(fd, buf.data(), buf.size(), type == TYPE_GAME_OVER ? NET_RELIABLE : NET_SNAPSHOT);
+            v.next_seq++;
+        }
+    }
+}
+
+// 所有观众都已发过的帧出队
+void SpectatorRelay::trim(Feed& feed) {
+    unsigned long long min_seq = feed.base_seq + feed.history.size();
+    for (int fd : feed.viewers) min_seq = std::min(min_seq, viewers[fd].next_seq);
+    while (feed.base_seq < min_seq && !feed.history.empty()) {
+        feed.history.pop_front();
+        feed.base_seq++;
+    }
+}
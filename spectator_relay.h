@@ -0,0 +1,67 @@
+#ifndef SPECTATOR_RELAY_H
+#define SPECTATOR_RELAY_H
+
+#include <deque>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include "protocol.h"
+
+#define SPECTATE_FRAME_RATE    30  // 与主循环帧率一致，用来估算历史帧上限
+#define SPECTATE_HISTORY_MAX   (SPECTATE_MAX_DELAY_SEC * SPECTATE_FRAME_RATE + SPECTATE_FRAME_RATE)
+
+// 一帧编码好的数据，所有观众共用同一份 (只读、引用计数)
+typedef std::shared_ptr<const std::vector<char>> SharedFrame;
+
+// --------------------------------------------------------
+// 观战中继
+// 房间每帧把编码好的整帧交出来一次 (只在有人观战时)，这里复制成一份 SharedFrame，
+// 再分发给该房间的所有观众 —— 房间的帧耗时与观众人数无关。
+// 延迟观看：每个房间一条按帧序号排列的历史队列，观众只记自己的读游标，
+// 到点才发；所有游标都越过的帧立刻出队，没有延迟观众时队列里最多只留当前一帧。
+// --------------------------------------------------------
+class SpectatorRelay {
+public:
+    SpectatorRelay();
+
+    // 开始观战；返回 true 表示该房间刚从无人观看变为有人观看 (调用方据此打开房间输出)
+    bool add(int fd, int room_id, int delay_sec, long long now);
+    // 停止观战；返回原来观看的房间 (没在观战返回 0)，*unwatched 表示该房间因此没人看了
+    int remove(int fd, bool* unwatched);
+    // 房间关闭：丢弃历史，把原来的观众放进 out
+    void close_room(int room_id, std::vector<int>& out);
+
+    bool is_watching(int fd) const { return viewers.count(fd) > 0; }
+    int viewer_count(int room_id) const;
+
+    // 房间产出一帧
+    void publish(int room_id, const char* data, int len, long long now);
+    // 每帧调用：把延迟观众到期的帧发出去
+    void flush(long long now);
+
+private:
+    struct Entry {
+        long long time;
+        SharedFrame frame;
+    };
+    struct Feed {
+        std::deque<Entry> history;
+        unsigned long long base_seq;  // history.front() 的帧序号
+        std::vector<int> viewers;
+        int max_delay_ms;
+        Feed() : base_seq(0), max_delay_ms(0) {}
+    };
+    struct Viewer {
+        int room_id;
+        int delay_ms;
+        unsigned long long next_seq;  // 下一帧要发的序号
+    };
+
+    std::unordered_map<int, Feed> feeds;     // room_id -> 该房间的观战数据
+    std::unordered_map<int, Viewer> viewers; // fd -> 观众
+
+    void pump(Feed& feed, long long now);
+    void trim(Feed& feed);
+};
+
+#endif
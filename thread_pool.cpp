@@ -0,0 +1,105 @@
+#include "thread_pool.h"
+#include <algorithm>
+
+WorkStealingPool::WorkStealingPool(int n_workers) : queued(0), stopping(false) {
+    if (n_workers < 0) n_workers = 0;
+    for (int i = 0; i < n_workers; i++) queues.emplace_back(new WorkerQueue());
+    for (int i = 0; i < n_workers; i++) threads.emplace_back(&WorkStealingPool::worker_loop, this, i);
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mtx);
+        stopping = true;
+    }
+    cv.notify_all();
+    for (auto& t : threads) t.join();
+}
+
+WorkStealingPool& WorkStealingPool::instance() {
+    static WorkStealingPool pool((int)std::thread::hardware_concurrency() - 1);
+    return pool;
+}
+
+bool WorkStealingPool::try_pop(int idx, Task& out) {
+    WorkerQueue& q = *queues[idx];
+    std::lock_guard<std::mutex> lock(q.mtx);
+    if (q.tasks.empty()) return false;
+    out = q.tasks.back();
+    q.tasks.pop_back();
+    queued--;
+    return true;
+}
+
+bool WorkStealingPool::try_steal(int thief, Task& out) {
+    int n = (int)queues.size();
+    for (int k = 1; k <= n; k++) {
+        int victim = (thief + k) % n;
+        if (victim == thief) continue;
+        WorkerQueue& q = *queues[victim];
+        std::lock_guard<std::mutex> lock(q.mtx);
+        if (q.tasks.empty()) continue;
+        out = q.tasks.front();
+        q.tasks.pop_front();
+        queued--;
+        return true;
+    }
+    return false;
+}
+
+void WorkStealingPool::run_task(const Task& t) {
+    (*t.fn)(t.begin, t.end);
+    t.pending->fetch_sub(1, std::memory_order_release);
+}
+
+void WorkStealingPool::worker_loop(int idx) {
+    while (true) {
+        Task t;
+        if (try_pop(idx, t) || try_steal(idx, t)) {
+            run_task(t);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleep_mtx);
+        cv.wait(lock, [this] { return stopping || queued.load() > 0; });
+        if (stopping) return;
+    }
+}
+
+void WorkStealingPool::parallel_for(int n, int grain, const std::function<void(int, int)>& fn) {
+    if (n <= 0) return;
+    if (grain < 1) grain = 1;
+
+    // 没有工作线程或任务太小，直接在当前线程跑
+    if (threads.empty() || n <= grain) {
+        fn(0, n);
+        return;
+    }
+
+    std::atomic<int> pending(0);
+    int chunks = (n + grain - 1) / grain;
+    pending.store(chunks);
+
+    // 轮流分发到各工作线程队列
+    int w = 0;
+    for (int begin = 0; begin < n; begin += grain) {
+        Task t = { &fn, begin, std::min(begin + grain, n), &pending };
+        WorkerQueue& q = *queues[w];
+        {
+            std::lock_guard<std::mutex> lock(q.mtx);
+            q.tasks.push_back(t);
+        }
+        queued++;
+        w = (w + 1) % (int)queues.size();
+    }
+    {
+        std::lock_guard<std::mutex> lock(sleep_mtx);
+    }
+    cv.notify_all();
+
+    // 调用线程也去偷任务，直到本批次全部完成
+    while (pending.load(std::memory_order_acquire) > 0) {
+        Task t;
+        if (try_steal(-1, t)) run_task(t);
+        else std::this_thread::yield();
+    }
+}
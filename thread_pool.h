@@ -0,0 +1,57 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+// --------------------------------------------------------
+// 工作窃取线程池
+// 每个工作线程有自己的任务队列，自己从队尾取，空闲时从别人队头偷。
+// 目前只提供 parallel_for：调用线程也参与执行，返回时所有分块均已完成。
+// --------------------------------------------------------
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(int n_workers);
+    ~WorkStealingPool();
+
+    // 把 [0, n) 按 grain 切块，并行执行 fn(begin, end)
+    void parallel_for(int n, int grain, const std::function<void(int, int)>& fn);
+
+    int worker_count() const { return (int)threads.size(); }
+
+    // 全局共享实例 (线程数 = 核数 - 1，调用线程补上最后一个核)
+    static WorkStealingPool& instance();
+
+private:
+    struct Task {
+        const std::function<void(int, int)>* fn;
+        int begin, end;
+        std::atomic<int>* pending; // 所属批次剩余分块数
+    };
+
+    struct WorkerQueue {
+        std::mutex mtx;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> threads;
+
+    std::mutex sleep_mtx;
+    std::condition_variable cv;
+    std::atomic<int> queued;    // 所有队列中尚未被取走的任务数
+    bool stopping;
+
+    bool try_pop(int idx, Task& out);
+    bool try_steal(int thief, Task& out);
+    void run_task(const Task& t);
+    void worker_loop(int idx);
+};
+
+#endif
@@ -0,0 +1,74 @@
+#include "timer_wheel.h"
+
+TimerWheel::TimerWheel() : current(0), count(0) {}
+
+void TimerWheel::reset(long long now) {
+    for (int l = 0; l < TIMER_WHEEL_LEVELS; l++)
+        for (int s = 0; s < TIMER_WHEEL_SLOTS; s++) slots[l][s].clear();
+    overdue.clear();
+    current = now / TIMER_WHEEL_RES_MS;
+    count = 0;
+}
+
+void TimerWheel::schedule(long long due, int kind, int id) {
+    TimerEvent ev = { kind, id, due };
+    place(ev);
+    count++;
+}
+
+// 按剩余刻度数放入对应层：差值越大放得越高，逐层下沉
+void TimerWheel::place(const TimerEvent& ev) {
+    long long expires = (ev.due + TIMER_WHEEL_RES_MS - 1) / TIMER_WHEEL_RES_MS;
+    long long delta = expires - current;
+    if (delta <= 0) {
+        overdue.push_back(ev);
+        return;
+    }
+
+    for (int l = 0; l < TIMER_WHEEL_LEVELS; l++) {
+        long long span = 1LL << (TIMER_WHEEL_BITS * (l + 1));
+        if (delta < span || l == TIMER_WHEEL_LEVELS - 1) {
+            if (delta >= span) expires = current + span - 1; // 超出量程，先挂在最高层末尾
+            int idx = (int)((expires >> (TIMER_WHEEL_BITS * l)) & (TIMER_WHEEL_SLOTS - 1));
+            slots[l][idx].push_back(ev);
+            return;
+        }
+    }
+}
+
+// 把高层当前格里的事件重新按剩余时间分配到低层
+void TimerWheel::cascade(int level) {
+    int idx = (int)((current >> (TIMER_WHEEL_BITS * level)) & (TIMER_WHEEL_SLOTS - 1));
+    std::vector<TimerEvent> moving;
+    moving.swap(slots[level][idx]);
+    for (const auto& ev : moving) place(ev);
+    // 归还容量，避免下一圈重新分配
+    moving.clear();
+    if (slots[level][idx].empty()) slots[level][idx].swap(moving);
+}
+
+void TimerWheel::advance(long long now, std::vector<TimerEvent>& out) {
+    long long target = now / TIMER_WHEEL_RES_MS;
+
+    while (true) {
+        if (!overdue.empty()) {
+            for (const auto& ev : overdue) out.push_back(ev);
+            count -= overdue.size();
+            overdue.clear();
+        }
+        if (current >= target) break;
+
+        current++;
+
+        // 低层转完一圈时，从高到低依次下沉
+        for (int l = TIMER_WHEEL_LEVELS - 1; l >= 1; l--) {
+            long long mask = (1LL << (TIMER_WHEEL_BITS * l)) - 1;
+            if ((current & mask) == 0) cascade(l);
+        }
+
+        std::vector<TimerEvent>& slot = slots[0][current & (TIMER_WHEEL_SLOTS - 1)];
+        for (const auto& ev : slot) out.push_back(ev);
+        count -= slot.size();
+        slot.clear();
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <vector>
+
+// 时间轮参数：最底层一格 10ms，每层 64 格，4 层约覆盖 46 小时
+#define TIMER_WHEEL_RES_MS  10
+#define TIMER_WHEEL_BITS    6
+#define TIMER_WHEEL_SLOTS   (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_LEVELS  4
+
+// 到期事件：kind 区分实体类型，id 为实体 ID，due 为预定的唤醒时间 (毫秒)
+struct TimerEvent {
+    int kind;
+    int id;
+    long long due;
+};
+
+// --------------------------------------------------------
+// 分层时间轮
+// 不支持取消：实体自己记录"期望的唤醒时间"，到期时对不上的事件直接丢弃即可。
+// --------------------------------------------------------
+class TimerWheel {
+public:
+    TimerWheel();
+
+    // 清空所有定时器，并把当前时间设为 now
+    void reset(long long now);
+
+    // 预约在 due 时刻唤醒 (已过期的会在下一次 advance 时立即触发)
+    void schedule(long long due, int kind, int id);
+
+    // 推进到 now，把到期事件追加到 out
+    void advance(long long now, std::vector<TimerEvent>& out);
+
+    int size() const { return count; }
+
+private:
+    std::vector<TimerEvent> slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+    std::vector<TimerEvent> overdue; // 预约时已经过期的事件
+    long long current;               // 当前刻度 (单位: TIMER_WHEEL_RES_MS)
+    int count;
+
+    void place(const TimerEvent& ev);
+    void cascade(int level);
+};
+
+#endif
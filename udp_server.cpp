@@ -0,0 +1,143 @@
+#include "udp_server.h"
+#include "net_io.h"
+#include <iostream>
+#include <random>
+#include <cstring>
+#include <unistd.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+
+UdpServer::UdpServer() : sock(-1), bound_port(0), next_conn_id(1) {}
+
+UdpServer::~UdpServer() {
+    for (auto& pair : conns) {
+        if (pair.second.bound) net_detach_udp(pair.second.tcp_fd);
+        delete pair.second.session;
+    }
+    if (sock >= 0) close(sock);
+}
+
+bool UdpServer::open(int port) {
+    sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0) return false;
+
+    sockaddr_in sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    sa.sin_addr.s_addr = INADDR_ANY;
+    sa.sin_port = htons(port);
+    if (bind(sock, (sockaddr*)&sa, sizeof(sa)) < 0) {
+        close(sock);
+        sock = -1;
+        return false;
+    }
+    int buf_bytes = 4 * 1024 * 1024;
+    setsockopt(sock, SOL_SOCKET, SO_SNDBUF, &buf_bytes, sizeof(buf_bytes));
+    setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &buf_bytes, sizeof(buf_bytes));
+    fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+    bound_port = port;
+    return true;
+}
+
+bool UdpServer::offer(int tcp_fd, unsigned int& conn_id, unsigned int& token) {
+    if (sock < 0) return false;
+    static std::mt19937 rng(std::random_device{}());
+
+    drop(tcp_fd); // 重复申请：旧会话作废
+    conn_id = next_conn_id++;
+    token = rng();
+
+    Conn& c = conns[conn_id];
+    c.tcp_fd = tcp_fd;
+    c.bound = false;
+    memset(&c.addr, 0, sizeof(c.addr));
+    c.addr_len = 0;
+    Conn* cp = &c; // unordered_map 的元素地址在扩容后不变
+    c.session = new UdpSession(conn_id, token, [this, cp](const char* data, size_t len) {
+        if (cp->addr_len > 0) sim.send(sock, data, len, (const sockaddr*)&cp->addr, cp->addr_len);
+    });
+    conn_of_fd[tcp_fd] = conn_id;
+    return true;
+}
+
+void UdpServer::drop(int tcp_fd) {
+    auto it = conn_of_fd.find(tcp_fd);
+    if (it == conn_of_fd.end()) return;
+    auto cit = conns.find(it->second);
+    if (cit != conns.end()) {
+        UdpSession* s = cit->second.session;
+        if (cit->second.bound) {
+            net_detach_udp(tcp_fd);
+            std::cout << "[UDP] Conn " << cit->first << " closed: rtt " << s->rtt_ms() << "ms, loss "
+                      << s->loss_permille() / 10.0 << "%, snapshots " << s->snapshots_sent() << " sent / "
+                      << s->snapshots_skipped() << " skipped, " << s->retransmits() << " retransmits" << std::endl;
+        }
+        delete s;
+        conns.erase(cit);
+    }
+    conn_of_fd.erase(it);
+}
+
+void UdpServer::on_readable(const Deliver& deliver) {
+    char buf[2048];
+    long long now = udp_now_ms();
+    while (true) {
+        sockaddr_storage from;
+        socklen_t from_len = sizeof(from);
+        ssize_t n = recvfrom(sock, buf, sizeof(buf), 0, (sockaddr*)&from, &from_len);
+        if (n < 0) break; // EAGAIN
+        if (n < (ssize_t)sizeof(UdpPacketHeader)) continue;
+
+        UdpPacketHeader hdr;
+        memcpy(&hdr, buf, sizeof(hdr));
+        auto it = conns.find(hdr.conn_id);
+        if (it == conns.end()) continue;
+        Conn& c = it->second;
+        int tcp_fd = c.tcp_fd;
+        if (!c.session->on_datagram(buf, n, now, [&](int kind, const char* data, size_t len) {
+                deliver(tcp_fd, kind, data, len);
+            })) {
+            continue; // token 不对
+        }
+
+        // 通过校验才记地址；客户端换了端口 (NAT 重绑定) 也跟着换
+        if (c.addr_len != from_len || memcmp(&c.addr, &from, from_len) != 0) {
+            memcpy(&c.addr, &from, from_len);
+            c.addr_len = from_len;
+        }
+        if (!c.bound) {
+            c.bound = true;
+            net_attach_udp(tcp_fd, c.session);
+            std::cout << "[UDP] Connection " << tcp_fd << " bound to UDP conn " << it->first << std::endl;
+        }
+    }
+}
+
+void UdpServer::flush() {
+    long long now = udp_now_ms();
+    for (auto& pair : conns) {
+        Conn& c = pair.second;
+        if (!c.bound) continue;
+        if (now - c.session->last_recv_ms() > UDP_TIMEOUT_MS) {
+            c.bound = false;
+            net_detach_udp(c.tcp_fd);
+            // 还没确认的开局/结算等可靠消息按原顺序改走 TCP，排在退回之后的新流量前面
+            std::vector<std::string> unacked;
+            c.session->take_unacked_reliable(unacked);
+            for (const std::string& m : unacked) net_send(c.tcp_fd, m.data(), m.size());
+            std::cout << "[UDP] Conn " << pair.first << " timed out, falling back to TCP";
+            if (!unacked.empty()) std::cout << " (" << unacked.size() << " reliable messages resent)";
+            std::cout << std::endl;
+            continue;
+        }
+        c.session->flush(now);
+    }
+    sim.pump();
+}
+
+int UdpServer::next_wakeup_ms() const {
+    long long due = sim.next_due();
+    if (due < 0) return -1;
+    long long wait = due - udp_now_ms();
+    return wait < 0 ? 0 : (int)wait;
+}
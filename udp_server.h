@@ -0,0 +1,55 @@
+#ifndef UDP_SERVER_H
+#define UDP_SERVER_H
+
+#include <unordered_map>
+#include <functional>
+#include "udp_transport.h"
+
+// --------------------------------------------------------
+// 服务器侧 UDP 通道：一个 UDP socket 服务所有连接
+// 流程: TCP 上收到 TYPE_TRANSPORT_UDP -> offer() 分配 conn_id/token ->
+//       客户端发 HELLO -> 记下对端地址，net_io 把该连接的战斗流量切到 UDP。
+// 长时间收不到数据报就退回 TCP，客户端恢复发送后自动重新接上。
+// --------------------------------------------------------
+class UdpServer {
+public:
+    typedef std::function<void(int fd, int kind, const char* data, size_t len)> Deliver;
+
+    UdpServer();
+    ~UdpServer();
+
+    bool open(int port);
+    int fd() const { return sock; }
+    int port() const { return bound_port; }
+
+    // 为已登录的 TCP 连接分配会话，填好应答包
+    bool offer(int tcp_fd, unsigned int& conn_id, unsigned int& token);
+    // TCP 连接断开时调用
+    void drop(int tcp_fd);
+
+    // 读空 socket，各会话收齐的消息交给 deliver
+    void on_readable(const Deliver& deliver);
+    // 每轮主循环调用：刷新会话、发出到期的模拟延迟包、超时退回 TCP
+    void flush();
+    // 距下一次必须调用 flush 的毫秒数 (没有待发的延迟包时返回 -1)
+    int next_wakeup_ms() const;
+
+    UdpLinkSim sim;
+
+private:
+    struct Conn {
+        int tcp_fd;
+        bool bound;               // 已收到数据报并切换到 UDP
+        sockaddr_storage addr;
+        socklen_t addr_len;
+        UdpSession* session;
+    };
+
+    int sock;
+    int bound_port;
+    unsigned int next_conn_id;
+    std::unordered_map<unsigned int, Conn> conns;
+    std::unordered_map<int, unsigned int> conn_of_fd;
+};
+
+#endif
@@ -0,0 +1,420 @@
+#include "udp_transport.h"
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <chrono>
+
+long long udp_now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 序号比较 (允许回绕)
+static inline bool seq_newer(uint32_t a, uint32_t b) {
+    return (int32_t)(a - b) > 0;
+}
+
+// =========================================
+// UdpLinkSim
+// =========================================
+
+UdpLinkSim::UdpLinkSim() : loss_pct(0), latency_ms(0), jitter_ms(0) {}
+
+bool UdpLinkSim::parse(const char* spec) {
+    int loss = 0, lat = 0, jit = 0;
+    if (sscanf(spec, "%d/%d/%d", &loss, &lat, &jit) < 1) return false;
+    if (loss < 0 || loss > 100 || lat < 0 || jit < 0) return false;
+    loss_pct = loss;
+    latency_ms = lat;
+    jitter_ms = jit;
+    return true;
+}
+
+void UdpLinkSim::send(int sock, const char* data, size_t len, const sockaddr* addr, socklen_t addr_len) {
+    if (!active()) {
+        sendto(sock, data, len, MSG_DONTWAIT, addr, addr_len);
+        return;
+    }
+    if (loss_pct > 0 && rand() % 100 < loss_pct) return;
+
+    int delay = latency_ms;
+    if (jitter_ms > 0) delay += rand() % (2 * jitter_ms + 1) - jitter_ms; // 抖动会造成乱序，这正是要测的
+    if (delay <= 0) {
+        sendto(sock, data, len, MSG_DONTWAIT, addr, addr_len);
+        return;
+    }
+
+    Delayed d;
+    d.sock = sock;
+    memset(&d.addr, 0, sizeof(d.addr));
+    memcpy(&d.addr, addr, addr_len);
+    d.addr_len = addr_len;
+    d.data.assign(data, len);
+    queue.emplace(udp_now_ms() + delay, std::move(d));
+}
+
+void UdpLinkSim::pump() {
+    if (queue.empty()) return;
+    long long now = udp_now_ms();
+    while (!queue.empty() && queue.begin()->first <= now) {
+        const Delayed& d = queue.begin()->second;
+        sendto(d.sock, d.data.data(), d.data.size(), MSG_DONTWAIT, (const sockaddr*)&d.addr, d.addr_len);
+        queue.erase(queue.begin());
+    }
+}
+
+long long UdpLinkSim::next_due() const {
+    return queue.empty() ? -1 : queue.begin()->first;
+}
+
+// =========================================
+// UdpSession
+// =========================================
+
+UdpSession::UdpSession(uint32_t conn_id, uint32_t token, Output output)
+    : id(conn_id), auth_token(token), output(output),
+      local_seq(1), remote_seq(0), recv_bits(0), remote_seen(false), ack_pending(false),
+      last_send(0), last_recv(0),
+      rel_next_out(1), rel_next_in(1),
+      input_next_out(1), input_acked(0), input_fresh(false), input_last_in(0), input_bits(0),
+      snap_next_out(1), snap_has_pending(false), snap_last_in(0),
+      hello_pending(false),
+      srtt(-1), rate(UDP_RATE_INIT), budget(UDP_RATE_INIT / 10.0), budget_time(0),
+      window_start(0), window_acked(0), window_lost(0), loss_ewma(0),
+      snaps_sent(0), snaps_skipped(0), resent(0) {
+    for (SentRecord& r : sent) {
+        r.seq = 0;
+        r.time = 0;
+        r.valid = r.acked = r.lost = false;
+        r.max_input = 0;
+    }
+    for (Reassembly& a : reasm) {
+        a.id = 0;
+        a.count = a.got = 0;
+        a.mask = 0;
+        a.tail_len = 0;
+    }
+}
+
+bool UdpSession::send_reliable(const void* data, size_t len) {
+    if (len > UDP_MAX_MSG) return false;
+    ReliableOut& m = rel_out[rel_next_out++];
+    m.data.assign((const char*)data, len);
+    m.last_send = 0;
+    return true;
+}
+
+void UdpSession::take_unacked_reliable(std::vector<std::string>& out) {
+    // 序号从 1 递增，连接生命周期内不会回绕，map 的顺序就是发送顺序
+    for (auto& m : rel_out) {
+        if (m.second.data.empty()) continue; // 上次退回时已取走
+        out.push_back(std::move(m.second.data));
+        m.second.data.clear();
+    }
+}
+
+bool UdpSession::send_input(const void* data, size_t len) {
+    if (len > UDP_MAX_MSG / UDP_INPUT_REDUNDANCY) return false;
+    inputs.push_back({ input_next_out++, std::string((const char*)data, len), 0 });
+    input_fresh = true;
+    return true;
+}
+
+void UdpSession::send_snapshot(const void* data, size_t len) {
+    if (snap_has_pending) snaps_skipped++; // 上一份还没来得及发，直接被新的覆盖
+    snap_pending.assign((const char*)data, len);
+    snap_has_pending = true;
+}
+
+int UdpSession::rto_ms() const {
+    if (srtt < 0) return 200;
+    int rto = (int)(srtt * 1.5) + UDP_ACK_DELAY_MS + 30;
+    if (rto < 50) rto = 50;
+    if (rto > 1000) rto = 1000;
+    return rto;
+}
+
+// ---------------- 接收 ----------------
+
+bool UdpSession::on_datagram(const char* buf, size_t len, long long now, const Deliver& deliver) {
+    if (len < sizeof(UdpPacketHeader)) return false;
+    UdpPacketHeader hdr;
+    memcpy(&hdr, buf, sizeof(hdr));
+    if (hdr.magic != UDP_MAGIC || hdr.conn_id != id || hdr.token != auth_token) return false;
+    last_recv = now;
+
+    // 数据报去重，同时维护回给对端的 ack/ack_bits
+    uint32_t seq = hdr.seq;
+    if (!remote_seen) {
+        remote_seen = true;
+        remote_seq = seq;
+        recv_bits = 0;
+    } else if (seq_newer(seq, remote_seq)) {
+        uint32_t shift = seq - remote_seq;
+        recv_bits = (shift >= 32) ? 0 : (recv_bits << shift);
+        if (shift <= 32) recv_bits |= 1u << (shift - 1);
+        remote_seq = seq;
+    } else {
+        uint32_t d = remote_seq - seq;
+        if (d == 0 || d > 32) return true;        // 重复或太旧
+        uint32_t bit = 1u << (d - 1);
+        if (recv_bits & bit) return true;
+        recv_bits |= bit;
+    }
+    ack_pending = true;
+
+    process_acks(hdr.ack, hdr.ack_bits, now);
+
+    size_t off = sizeof(hdr);
+    for (int i = 0; i < hdr.sections; i++) {
+        if (off + sizeof(UdpSectionHeader) > len) break;
+        UdpSectionHeader sec;
+        memcpy(&sec, buf + off, sizeof(sec));
+        off += sizeof(sec);
+        if (off + sec.len > len) break;
+        const char* data = buf + off;
+        off += sec.len;
+
+        if (sec.kind == UDP_SEC_RELIABLE) {
+            if (seq_newer(rel_next_in, sec.id) || rel_in.count(sec.id)) continue; // 已交付或已缓存
+            if (rel_in.size() >= 1024) continue;
+            rel_in[sec.id].assign(data, sec.len);
+            // 按序交付，缺口之后的先缓存
+            auto it = rel_in.find(rel_next_in);
+            while (it != rel_in.end()) {
+                deliver(UDP_SEC_RELIABLE, it->second.data(), it->second.size());
+                rel_in.erase(it);
+                it = rel_in.find(++rel_next_in);
+            }
+        } else if (sec.kind == UDP_SEC_INPUT) {
+            if (seq_newer(sec.id, input_last_in)) {
+                uint32_t shift = sec.id - input_last_in;
+                input_bits = (shift >= 32) ? 0 : (input_bits << shift);
+                if (shift <= 32) input_bits |= 1u << (shift - 1);
+                input_last_in = sec.id;
+            } else {
+                uint32_t d = input_last_in - sec.id;
+                if (d == 0 || d > 32 || (input_bits & (1u << (d - 1)))) continue; // 冗余副本或太旧
+                input_bits |= 1u << (d - 1);
+            }
+            deliver(UDP_SEC_INPUT, data, sec.len);
+        } else if (sec.kind == UDP_SEC_SNAPSHOT) {
+            handle_snapshot_fragment(sec, data, deliver);
+        }
+    }
+    return true;
+}
+
+void UdpSession::handle_snapshot_fragment(const UdpSectionHeader& sec, const char* data, const Deliver& deliver) {
+    if (!seq_newer(sec.id, snap_last_in)) return; // 比已交付的旧
+    if (sec.frag_count == 0 || sec.frag_count > UDP_MAX_FRAGS || sec.frag_index >= sec.frag_count) return;
+    if (sec.frag_index + 1 < sec.frag_count && sec.len != UDP_MAX_MSG) return;
+
+    // 按序号取槽位，槽里是更旧的快照就直接覆盖
+    Reassembly& a = reasm[sec.id % UDP_REASM_SLOTS];
+    if (a.count == 0 || a.id != sec.id) {
+        if (a.count != 0 && seq_newer(a.id, sec.id)) return;
+        a.id = sec.id;
+        a.count = sec.frag_count;
+        a.got = 0;
+        a.mask = 0;
+        a.tail_len = 0;
+        a.data.resize((size_t)a.count * UDP_MAX_MSG);
+    }
+    if (sec.frag_count != a.count) return;
+    uint64_t bit = 1ull << sec.frag_index;
+    if (a.mask & bit) return;
+    a.mask |= bit;
+    a.got++;
+    memcpy(&a.data[(size_t)sec.frag_index * UDP_MAX_MSG], data, sec.len);
+    if (sec.frag_index + 1 == a.count) a.tail_len = sec.len;
+
+    // 拼齐且比已交付的新才交出；更旧的未完成快照随之作废
+    if (a.got == a.count) {
+        size_t total = (size_t)(a.count - 1) * UDP_MAX_MSG + a.tail_len;
+        snap_last_in = a.id;
+        a.count = 0;
+        deliver(UDP_SEC_SNAPSHOT, a.data.data(), total);
+    }
+}
+
+void UdpSession::process_acks(uint32_t ack, uint32_t bits, long long now) {
+    for (uint32_t i = 0; i <= 32; i++) {
+        if (i > 0 && !(bits & (1u << (i - 1)))) continue;
+        uint32_t s = ack - i;
+        SentRecord& r = sent[s % UDP_SENT_RING];
+        if (r.valid && r.seq == s && !r.acked) on_packet_acked(r, now);
+    }
+}
+
+void UdpSession::on_packet_acked(SentRecord& r, long long now) {
+    r.acked = true;
+    if (!r.lost) window_acked++;
+
+    double sample = (double)(now - r.time);
+    srtt = (srtt < 0) ? sample : srtt * 0.875 + sample * 0.125;
+
+    for (uint32_t rid : r.reliable_ids) rel_out.erase(rid);
+    if (seq_newer(r.max_input, input_acked)) input_acked = r.max_input;
+}
+
+// ---------------- 拥塞控制 ----------------
+
+// 超过 2 倍 RTO 仍未确认的数据报算作丢失
+void UdpSession::detect_losses(long long now) {
+    long long limit = rto_ms() * 2;
+    for (SentRecord& r : sent) {
+        if (r.valid && !r.acked && !r.lost && now - r.time > limit) {
+            r.lost = true;
+            window_lost++;
+        }
+    }
+}
+
+// AIMD：窗口内无明显丢包就加性提速，否则乘性降速
+void UdpSession::update_rate(long long now) {
+    if (window_start == 0) window_start = now;
+    if (now - window_start < UDP_RATE_WINDOW_MS) return;
+
+    int total = window_acked + window_lost;
+    if (total > 0) {
+        int loss = window_lost * 1000 / total;
+        loss_ewma = (loss_ewma * 7 + loss) / 8;
+        if (loss > UDP_LOSS_BACKOFF * 10) rate = rate * 3 / 4;
+        else rate += UDP_RATE_STEP;
+        if (rate < UDP_RATE_MIN) rate = UDP_RATE_MIN;
+        if (rate > UDP_RATE_MAX) rate = UDP_RATE_MAX;
+    }
+    window_start = now;
+    window_acked = window_lost = 0;
+}
+
+// ---------------- 发送 ----------------
+
+UdpSession::SentRecord& UdpSession::begin_record(std::vector<char>& pkt, long long now) {
+    uint32_t seq = local_seq++;
+    SentRecord& r = sent[seq % UDP_SENT_RING];
+    if (r.valid && !r.acked && !r.lost) window_lost++; // 被挤出记录环还没确认
+    r.seq = seq;
+    r.time = now;
+    r.valid = true;
+    r.acked = r.lost = false;
+    r.max_input = input_acked;
+    r.reliable_ids.clear();
+
+    UdpPacketHeader hdr;
+    hdr.magic = UDP_MAGIC;
+    hdr.sections = 0;
+    hdr.conn_id = id;
+    hdr.token = auth_token;
+    hdr.seq = seq;
+    hdr.ack = remote_seq;
+    hdr.ack_bits = recv_bits;
+    pkt.assign((const char*)&hdr, (const char*)&hdr + sizeof(hdr));
+    return r;
+}
+
+static void append_section(std::vector<char>& pkt, int kind, uint32_t id, const char* data, size_t len,
+                           int frag_index = 0, int frag_count = 1) {
+    UdpSectionHeader sec;
+    memset(&sec, 0, sizeof(sec));
+    sec.kind = (uint8_t)kind;
+    sec.frag_index = (uint8_t)frag_index;
+    sec.frag_count = (uint8_t)frag_count;
+    sec.len = (uint16_t)len;
+    sec.id = id;
+    pkt.insert(pkt.end(), (const char*)&sec, (const char*)&sec + sizeof(sec));
+    pkt.insert(pkt.end(), data, data + len);
+}
+
+void UdpSession::emit(std::vector<char>& pkt, uint16_t sections, long long now, SentRecord& rec) {
+    ((UdpPacketHeader*)pkt.data())->sections = sections;
+    rec.time = now;
+    output(pkt.data(), pkt.size());
+    budget -= (double)pkt.size();
+    last_send = now;
+    ack_pending = false;
+}
+
+void UdpSession::flush(long long now) {
+    // 令牌桶：最多攒 100ms 的额度
+    if (budget_time != 0) {
+        budget += rate * (double)(now - budget_time) / 1000.0;
+        if (budget > rate / 10.0) budget = rate / 10.0;
+    }
+    budget_time = now;
+    detect_losses(now);
+    update_rate(now);
+
+    int rto = rto_ms();
+    auto reliable_due = [&]() {
+        for (auto& m : rel_out) if (m.second.last_send == 0 || now - m.second.last_send >= rto) return true;
+        return false;
+    };
+
+    // 1. 控制数据报：握手 / 可靠消息 / 输入 / 单独的 ack 与保活。有快照要发时 ack 由快照捎带
+    bool inputs_due = input_fresh || (!inputs.empty() && now - last_send >= UDP_ACK_DELAY_MS);
+    bool ack_due = ack_pending && !snap_has_pending && now - last_send >= UDP_ACK_DELAY_MS;
+    bool keepalive = remote_seen && !snap_has_pending && now - last_send >= UDP_KEEPALIVE_MS;
+    bool first = true;
+    std::vector<char> pkt;
+
+    while (hello_pending || inputs_due || ack_due || keepalive || reliable_due()) {
+        SentRecord& rec = begin_record(pkt, now);
+        uint16_t sections = 0;
+
+        if (hello_pending) {
+            append_section(pkt, UDP_SEC_HELLO, 0, nullptr, 0);
+            sections++;
+            hello_pending = false;
+        }
+        if (first) {
+            for (InputOut& in : inputs) {
+                if (!seq_newer(in.id, input_acked)) continue;
+                if (pkt.size() + sizeof(UdpSectionHeader) + in.data.size() > UDP_MTU) break;
+                append_section(pkt, UDP_SEC_INPUT, in.id, in.data.data(), in.data.size());
+                sections++;
+                in.sends++;
+                rec.max_input = in.id;
+            }
+        }
+        for (auto& m : rel_out) {
+            if (m.second.last_send != 0 && now - m.second.last_send < rto) continue;
+            if (pkt.size() + sizeof(UdpSectionHeader) + m.second.data.size() > UDP_MTU) continue;
+            append_section(pkt, UDP_SEC_RELIABLE, m.first, m.second.data.data(), m.second.data.size());
+            sections++;
+            if (m.second.last_send != 0) resent++;
+            m.second.last_send = now;
+            rec.reliable_ids.push_back(m.first);
+        }
+        emit(pkt, sections, now, rec);
+        first = false;
+        inputs_due = ack_due = keepalive = false;
+    }
+
+    // 发够次数或已确认的输入不再携带
+    while (!inputs.empty() && (inputs.front().sends >= UDP_INPUT_REDUNDANCY || !seq_newer(inputs.front().id, input_acked))) {
+        inputs.pop_front();
+    }
+    input_fresh = false;
+
+    // 2. 快照：额度不够就跳过这一帧 (下一帧的快照本来就包含最新状态)
+    if (snap_has_pending) {
+        snap_has_pending = false;
+        size_t len = snap_pending.size();
+        int frags = len == 0 ? 1 : (int)((len + UDP_MAX_MSG - 1) / UDP_MAX_MSG);
+        if (budget <= 0 || frags > UDP_MAX_FRAGS) {
+            snaps_skipped++;
+            return;
+        }
+        uint32_t sid = snap_next_out++;
+        for (int i = 0; i < frags; i++) {
+            size_t off = (size_t)i * UDP_MAX_MSG;
+            size_t n = (len - off < (size_t)UDP_MAX_MSG) ? len - off : (size_t)UDP_MAX_MSG;
+            SentRecord& rec = begin_record(pkt, now);
+            append_section(pkt, UDP_SEC_SNAPSHOT, sid, snap_pending.data() + off, n, i, frags);
+            emit(pkt, 1, now, rec);
+        }
+        snaps_sent++;
+    }
+}
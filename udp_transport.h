@@ -0,0 +1,215 @@
+#ifndef UDP_TRANSPORT_H
+#define UDP_TRANSPORT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <map>
+#include <deque>
+#include <vector>
+#include <functional>
+#include <sys/socket.h>
+
+// ==========================================
+// 游戏内 UDP 通道 (服务器和客户端共用)
+// TCP 登录后协商，只承载战斗流量，大厅仍走 TCP：
+//   - 快照 (一帧的 UPDATE/EFFECT + FRAME)：不可靠、按序号只取最新，大包切片重组
+//   - 可靠有序消息：开局/结算 (s2c)，选人/购买/技能 (c2s)，丢了按 RTO 重传
+//   - 输入 (移动/攻击)：不可靠，但每条在后续几个数据报里冗余携带
+// 每个数据报头部都带 ack + 32 位 ack_bits，确认随输入/快照顺带发回，没有可捎带的数据时才单独回 ack。
+// 发送端按确认情况估算 RTT 与丢包率，AIMD 调整发送速率，超出预算的快照直接跳过。
+// ==========================================
+
+#define UDP_MAGIC              0x4D42      // "MB"
+#define UDP_MTU                1200        // 单个数据报上限，避免 IP 分片
+#define UDP_MAX_FRAGS          64          // 单个快照最多切片数
+#define UDP_REASM_SLOTS        4           // 同时在拼的快照数 (抖动会让相邻快照的切片交错到达)
+#define UDP_SENT_RING          256         // 记录最近发出的数据报，用于确认/丢包统计
+#define UDP_INPUT_REDUNDANCY   3           // 每条输入最多随几个数据报发送
+#define UDP_ACK_DELAY_MS       15          // 收到数据后最迟多久回一个数据报 (没东西可捎带时)
+#define UDP_KEEPALIVE_MS       250
+#define UDP_TIMEOUT_MS         5000        // 这么久收不到对端数据，退回 TCP
+#define UDP_RATE_INIT          (1024 * 1024)       // 字节/秒
+#define UDP_RATE_MIN           (128 * 1024)
+#define UDP_RATE_MAX           (16 * 1024 * 1024)
+#define UDP_RATE_STEP          (64 * 1024)         // 每个评估窗口无丢包时的加性增长
+#define UDP_RATE_WINDOW_MS     250
+#define UDP_LOSS_BACKOFF       2           // 窗口内丢包率超过 2% 时乘性降速
+
+// 段类型
+#define UDP_SEC_HELLO      1   // 客户端绑定地址用，无负载
+#define UDP_SEC_RELIABLE   2   // id = 可靠消息序号
+#define UDP_SEC_SNAPSHOT   3   // id = 快照序号，frag_index/frag_count 切片
+#define UDP_SEC_INPUT      4   // id = 输入序号
+
+struct UdpPacketHeader {
+    uint16_t magic;
+    uint16_t sections;
+    uint32_t conn_id;
+    uint32_t token;     // 协商时经 TCP 下发，每个数据报都带上，防止伪造源地址
+    uint32_t seq;       // 数据报序号
+    uint32_t ack;       // 收到的对端最大数据报序号
+    uint32_t ack_bits;  // 第 i 位: ack-1-i 是否收到
+};
+
+struct UdpSectionHeader {
+    uint8_t kind;
+    uint8_t frag_index;
+    uint8_t frag_count;
+    uint8_t reserved;
+    uint16_t len;
+    uint16_t reserved2;
+    uint32_t id;
+};
+
+#define UDP_MAX_MSG  (UDP_MTU - (int)sizeof(UdpPacketHeader) - (int)sizeof(UdpSectionHeader))
+
+// --------------------------------------------------------
+// 丢包/延迟模拟器：在本机回环上复现弱网
+// 格式 "丢包%/延迟ms/抖动ms"，例如 "5/60/20"
+// --------------------------------------------------------
+class UdpLinkSim {
+public:
+    UdpLinkSim();
+    bool parse(const char* spec);
+    bool active() const { return loss_pct > 0 || latency_ms > 0 || jitter_ms > 0; }
+
+    void send(int sock, const char* data, size_t len, const sockaddr* addr, socklen_t addr_len);
+    void pump(); // 发出已到期的延迟包
+    long long next_due() const; // 下一个延迟包的发送时刻，没有返回 -1
+
+    int loss_pct;
+    int latency_ms;
+    int jitter_ms;
+
+private:
+    struct Delayed {
+        int sock;
+        sockaddr_storage addr;
+        socklen_t addr_len;
+        std::string data;
+    };
+    std::multimap<long long, Delayed> queue;
+};
+
+// --------------------------------------------------------
+// 单个连接的可靠性状态机，不关心 socket，数据报经 output 发出
+// --------------------------------------------------------
+class UdpSession {
+public:
+    typedef std::function<void(const char* data, size_t len)> Output;
+    typedef std::function<void(int kind, const char* data, size_t len)> Deliver;
+
+    UdpSession(uint32_t conn_id, uint32_t token, Output output);
+
+    bool send_reliable(const void* data, size_t len); // 超过 UDP_MAX_MSG 返回 false
+    bool send_input(const void* data, size_t len);
+    void send_snapshot(const void* data, size_t len); // 只保留最新一份，flush 时按预算决定发不发
+    void send_hello() { hello_pending = true; }
+    // 退回 TCP 时取出还没确认的可靠消息 (按序号)，由调用方改走 TCP 重发。
+    // 原位置留空消息占住序号，通道恢复后对端照常按序收下 (空消息不交付任何包)
+    void take_unacked_reliable(std::vector<std::string>& out);
+
+    // 校验并处理一个数据报，收齐的消息经 deliver 交出；返回 false 表示不是本会话的包
+    bool on_datagram(const char* buf, size_t len, long long now, const Deliver& deliver);
+    void flush(long long now);
+
+    uint32_t conn_id() const { return id; }
+    uint32_t token() const { return auth_token; }
+    long long last_recv_ms() const { return last_recv; }
+    bool has_received() const { return last_recv > 0; }
+
+    int rtt_ms() const { return srtt < 0 ? 0 : (int)srtt; }
+    int loss_permille() const { return loss_ewma; }
+    int send_rate() const { return rate; }
+    unsigned snapshots_sent() const { return snaps_sent; }
+    unsigned snapshots_skipped() const { return snaps_skipped; }
+    unsigned retransmits() const { return resent; }
+
+private:
+    struct SentRecord {
+        uint32_t seq;
+        long long time;
+        bool valid, acked, lost;
+        uint32_t max_input;
+        std::vector<uint32_t> reliable_ids;
+    };
+    struct ReliableOut {
+        std::string data;
+        long long last_send; // 0 = 还没发过
+    };
+    struct InputOut {
+        uint32_t id;
+        std::string data;
+        int sends;
+    };
+    struct Reassembly {
+        uint32_t id;
+        int count, got;   // count == 0 表示空闲
+        uint64_t mask;
+        std::string data;
+        size_t tail_len;
+    };
+
+    uint32_t id;
+    uint32_t auth_token;
+    Output output;
+
+    // 数据报序号与确认
+    uint32_t local_seq;
+    uint32_t remote_seq;
+    uint32_t recv_bits;
+    bool remote_seen;
+    bool ack_pending;
+    long long last_send;
+    long long last_recv;
+    SentRecord sent[UDP_SENT_RING];
+
+    // 可靠有序
+    uint32_t rel_next_out;
+    std::map<uint32_t, ReliableOut> rel_out;
+    uint32_t rel_next_in;
+    std::map<uint32_t, std::string> rel_in;
+
+    // 输入
+    uint32_t input_next_out;
+    uint32_t input_acked;
+    std::deque<InputOut> inputs;
+    bool input_fresh;
+    uint32_t input_last_in;
+    uint32_t input_bits;  // 第 i 位: input_last_in-1-i 是否已交付 (乱序晚到的输入照样交付一次)
+
+    // 快照
+    uint32_t snap_next_out;
+    std::string snap_pending;
+    bool snap_has_pending;
+    uint32_t snap_last_in;
+    Reassembly reasm[UDP_REASM_SLOTS];
+
+    bool hello_pending;
+
+    // 拥塞控制
+    double srtt;
+    int rate;
+    double budget;
+    long long budget_time;
+    long long window_start;
+    int window_acked, window_lost;
+    int loss_ewma; // 千分比
+
+    unsigned snaps_sent, snaps_skipped, resent;
+
+    void process_acks(uint32_t ack, uint32_t bits, long long now);
+    void on_packet_acked(SentRecord& r, long long now);
+    void detect_losses(long long now);
+    void update_rate(long long now);
+    int rto_ms() const;
+
+    void emit(std::vector<char>& pkt, uint16_t sections, long long now, SentRecord& rec);
+    SentRecord& begin_record(std::vector<char>& pkt, long long now);
+    void handle_snapshot_fragment(const UdpSectionHeader& sec, const char* data, const Deliver& deliver);
+};
+
+long long udp_now_ms();
+
+#endif
@@ -0,0 +1,446 @@
+#include "uring_backend.h"
+
+#ifdef MOBA_HAVE_URING
+
+#include <iostream>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+
+static inline unsigned load_acquire(const unsigned* p) { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+static inline void store_release(unsigned* p, unsigned v) { __atomic_store_n(p, v, __ATOMIC_RELEASE); }
+
+// user_data: [op 8 位][gen 24 位][fd 32 位]
+uint64_t UringBackend::make_data(int op, uint32_t gen, int fd) {
+    return ((uint64_t)op << 56) | ((uint64_t)(gen & 0xFFFFFF) << 32) | (uint32_t)fd;
+}
+
+UringBackend::UringBackend()
+    : ring_fd(-1), sq_entries(0), cq_entries(0), sq_ptr(nullptr), sq_len(0), cq_ptr(nullptr), cq_len(0),
+      sqes(nullptr), sqes_len(0), to_submit(0), defer_taskrun(false),
+      use_buf_ring(false), buf_ring(nullptr), buf_ring_len(0), buf_base(nullptr), buf_tail(0), next_gen(1) {}
+
+UringBackend* UringBackend::create() {
+    UringBackend* b = new UringBackend();
+    if (!b->init()) {
+        delete b;
+        return nullptr;
+    }
+    return b;
+}
+
+UringBackend::~UringBackend() {
+    if (ring_fd >= 0) close(ring_fd); // 内核随之取消所有请求
+    if (sqes) munmap(sqes, sqes_len);
+    if (sq_ptr) munmap(sq_ptr, sq_len);
+    if (buf_ring) munmap(buf_ring, buf_ring_len);
+    if (buf_base) munmap(buf_base, (size_t)URING_BUF_COUNT * URING_BUF_SIZE);
+}
+
+bool UringBackend::init() {
+    io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    // 只有主线程提交，完成事件也只在 io_uring_enter 时处理，省掉内核里的跨线程唤醒
+    p.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL | IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+    p.cq_entries = URING_ENTRIES * 4;
+    ring_fd = (int)syscall(__NR_io_uring_setup, URING_ENTRIES, &p);
+    defer_taskrun = true;
+    if (ring_fd < 0) {
+        memset(&p, 0, sizeof(p));
+        p.flags = IORING_SETUP_CQSIZE;
+        p.cq_entries = URING_ENTRIES * 4;
+        ring_fd = (int)syscall(__NR_io_uring_setup, URING_ENTRIES, &p);
+        defer_taskrun = false;
+    }
+    if (ring_fd < 0) return false;
+
+    unsigned need = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG;
+    if ((p.features & need) != need) return false;
+
+    sq_entries = p.sq_entries;
+    cq_entries = p.cq_entries;
+    sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cq_len = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    if (cq_len > sq_len) sq_len = cq_len; // SQ/CQ 共用一次映射
+    sq_ptr = mmap(nullptr, sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+    if (sq_ptr == MAP_FAILED) { sq_ptr = nullptr; return false; }
+    cq_ptr = sq_ptr;
+
+    sqes_len = p.sq_entries * sizeof(io_uring_sqe);
+    void* s = mmap(nullptr, sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+    if (s == MAP_FAILED) return false;
+    sqes = (io_uring_sqe*)s;
+
+    char* sq = (char*)sq_ptr;
+    sq_head = (unsigned*)(sq + p.sq_off.head);
+    sq_tail = (unsigned*)(sq + p.sq_off.tail);
+    sq_mask = (unsigned*)(sq + p.sq_off.ring_mask);
+    sq_array = (unsigned*)(sq + p.sq_off.array);
+    char* cq = (char*)cq_ptr;
+    cq_head = (unsigned*)(cq + p.cq_off.head);
+    cq_tail = (unsigned*)(cq + p.cq_off.tail);
+    cq_mask = (unsigned*)(cq + p.cq_off.ring_mask);
+    cqes = (io_uring_cqe*)(cq + p.cq_off.cqes);
+
+    // 接收缓冲环：内核收数据时自己挑一个缓冲，连接再多也不用每个预留接收缓冲
+    buf_ring_len = URING_BUF_COUNT * sizeof(io_uring_buf);
+    void* r = mmap(nullptr, buf_ring_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (r == MAP_FAILED) return false;
+    buf_ring = (io_uring_buf_ring*)r;
+    memset(buf_ring, 0, buf_ring_len);
+    void* base = mmap(nullptr, (size_t)URING_BUF_COUNT * URING_BUF_SIZE, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) return false;
+    buf_base = (char*)base;
+
+    io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)buf_ring;
+    reg.ring_entries = URING_BUF_COUNT;
+    reg.bgid = URING_BUF_GROUP;
+    use_buf_ring = syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) == 0;
+
+    buf_tail = 0;
+    if (use_buf_ring) {
+        for (unsigned i = 0; i < URING_BUF_COUNT; i++) recycle_buffer(i);
+        if (!probe_buf_ring()) {
+            // 有的内核注册成功却取不到缓冲 (recv 一直 ENOBUFS)，退回逐个提供缓冲的老接口
+            syscall(__NR_io_uring_register, ring_fd, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+            use_buf_ring = false;
+        }
+    }
+    if (!use_buf_ring) {
+        io_uring_sqe* sqe = get_sqe();
+        sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+        sqe->fd = URING_BUF_COUNT;
+        sqe->addr = (uint64_t)(uintptr_t)buf_base;
+        sqe->len = URING_BUF_SIZE;
+        sqe->buf_group = URING_BUF_GROUP;
+        sqe->off = 0;
+        sqe->user_data = make_data(OP_PROVIDE, 0, 0);
+        enter(to_submit, 0, -1);
+        std::cout << "[IO] Buffer ring unusable on this kernel, using provided buffers." << std::endl;
+    }
+    return true;
+}
+
+// 用一对本地 socket 收一个字节，确认内核真的能从缓冲环里取到缓冲
+bool UringBackend::probe_buf_ring() {
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv) < 0) return false;
+    bool ok = false;
+    if (write(sv[1], "x", 1) == 1) {
+        io_uring_sqe* sqe = get_sqe();
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = sv[0];
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = URING_BUF_GROUP;
+        sqe->user_data = make_data(OP_PROBE, 0, sv[0]);
+        if (enter(to_submit, 1, 1000) >= 0) {
+            unsigned head = *cq_head;
+            if (head != load_acquire(cq_tail)) {
+                io_uring_cqe cqe = cqes[head & *cq_mask];
+                store_release(cq_head, head + 1);
+                ok = cqe.res == 1 && (cqe.flags & IORING_CQE_F_BUFFER);
+                if (ok) recycle_buffer(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+            }
+        }
+    }
+    close(sv[0]);
+    close(sv[1]);
+    return ok;
+}
+
+void UringBackend::recycle_buffer(unsigned bid) {
+    if (!use_buf_ring) {
+        // 老接口：每还一个缓冲一条 SQE，跟本轮其它请求一起提交
+        io_uring_sqe* sqe = get_sqe();
+        if (!sqe) return;
+        sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+        sqe->fd = 1;
+        sqe->addr = (uint64_t)(uintptr_t)(buf_base + (size_t)bid * URING_BUF_SIZE);
+        sqe->len = URING_BUF_SIZE;
+        sqe->buf_group = URING_BUF_GROUP;
+        sqe->off = bid;
+        sqe->user_data = make_data(OP_PROVIDE, 0, 0);
+        return;
+    }
+    io_uring_buf& b = buf_ring->bufs[buf_tail & (URING_BUF_COUNT - 1)];
+    b.addr = (uint64_t)(uintptr_t)(buf_base + (size_t)bid * URING_BUF_SIZE);
+    b.len = URING_BUF_SIZE;
+    b.bid = (unsigned short)bid;
+    buf_tail++;
+    __atomic_store_n(&buf_ring->tail, buf_tail, __ATOMIC_RELEASE);
+}
+
+io_uring_sqe* UringBackend::get_sqe() {
+    unsigned tail = *sq_tail;
+    if (tail - load_acquire(sq_head) >= sq_entries) {
+        enter(to_submit, 0, -1); // SQ 满了，先交给内核
+        if (tail - load_acquire(sq_head) >= sq_entries) return nullptr;
+    }
+    unsigned idx = tail & *sq_mask;
+    io_uring_sqe* sqe = &sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    sq_array[idx] = idx;
+    store_release(sq_tail, tail + 1);
+    to_submit++;
+    return sqe;
+}
+
+int UringBackend::enter(unsigned submit, unsigned min_complete, int timeout_ms) {
+    unsigned flags = 0;
+    if (min_complete > 0 || defer_taskrun) flags |= IORING_ENTER_GETEVENTS;
+
+    int ret;
+    if (min_complete > 0 && timeout_ms >= 0) {
+        __kernel_timespec ts;
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (long long)(timeout_ms % 1000) * 1000000;
+        io_uring_getevents_arg arg;
+        memset(&arg, 0, sizeof(arg));
+        arg.sigmask_sz = _NSIG / 8;
+        arg.ts = (uint64_t)(uintptr_t)&ts;
+        ret = (int)syscall(__NR_io_uring_enter, ring_fd, submit, min_complete, flags | IORING_ENTER_EXT_ARG,
+                           &arg, sizeof(arg));
+    } else {
+        ret = (int)syscall(__NR_io_uring_enter, ring_fd, submit, min_complete, flags, nullptr, 0);
+    }
+    if (ret >= 0) to_submit -= ((unsigned)ret < to_submit) ? (unsigned)ret : to_submit;
+    return ret;
+}
+
+void UringBackend::arm(int fd, FdState& st) {
+    io_uring_sqe* sqe = get_sqe();
+    if (!sqe) return;
+    sqe->fd = fd;
+    if (st.kind == FD_LISTENER) {
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+        sqe->accept_flags = SOCK_NONBLOCK;
+        sqe->user_data = make_data(OP_ACCEPT, st.gen, fd);
+    } else if (st.kind == FD_STREAM) {
+        sqe->opcode = IORING_OP_RECV;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = URING_BUF_GROUP;
+        sqe->user_data = make_data(OP_RECV, st.gen, fd);
+    } else {
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->poll32_events = POLLIN;
+        sqe->len = IORING_POLL_ADD_MULTI;
+        sqe->user_data = make_data(OP_POLL, st.gen, fd);
+    }
+}
+
+void UringBackend::add_listener(int fd) {
+    FdState& st = fds[fd];
+    st = FdState();
+    st.kind = FD_LISTENER;
+    st.gen = next_gen++;
+    arm(fd, st);
+}
+
+void UringBackend::add_stream(int fd) {
+    FdState& st = fds[fd];
+    st = FdState();
+    st.kind = FD_STREAM;
+    st.gen = next_gen++;
+    arm(fd, st);
+}
+
+void UringBackend::add_watch(int fd) {
+    FdState& st = fds[fd];
+    st = FdState();
+    st.kind = FD_WATCH;
+    st.gen = next_gen++;
+    arm(fd, st);
+}
+
+// 取消该 fd 上所有请求，并立即提交：按 fd 取消要在 close 之前解析出文件
+void UringBackend::remove(int fd) {
+    auto it = fds.find(fd);
+    if (it == fds.end()) return;
+    fds.erase(it);
+
+    io_uring_sqe* sqe = get_sqe();
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = fd;
+    sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+    sqe->user_data = make_data(OP_CANCEL, 0, fd);
+    enter(to_submit, 0, -1);
+}
+
+ssize_t UringBackend::send(int fd, const void* buf, size_t len) {
+    auto it = fds.find(fd);
+    if (it == fds.end() || it->second.kind != FD_STREAM) return write(fd, buf, len);
+    FdState& st = it->second;
+    if (st.pending.size() + len > URING_MAX_PENDING) {
+        errno = EAGAIN;
+        return -1;
+    }
+    st.pending.append((const char*)buf, len);
+    if (!st.queued) {
+        st.queued = true;
+        dirty.push_back(fd);
+    }
+    return (ssize_t)len;
+}
+
+// 本轮攒下的 + 在飞缓冲里还没发出去的
+size_t UringBackend::queued_bytes(int fd) const {
+    auto it = fds.find(fd);
+    if (it == fds.end()) return 0;
+    const FdState& st = it->second;
+    size_t n = st.pending.size();
+    if (st.sending) {
+        auto bit = inflight.find(make_data(OP_SEND, st.gen, fd));
+        if (bit != inflight.end() && bit->second.size() > st.sent_off) n += bit->second.size() - st.sent_off;
+    }
+    return n;
+}
+
+// 发送缓冲按 user_data 存放，连接被移除后也要等内核用完 (完成事件回来) 才释放
+void UringBackend::queue_send(int fd, FdState& st) {
+    uint64_t data = make_data(OP_SEND, st.gen, fd);
+    std::string& buf = inflight[data];
+    buf.swap(st.pending);
+    st.pending.clear();
+    st.sent_off = 0;
+
+    io_uring_sqe* sqe = get_sqe();
+    if (!sqe) { inflight.erase(data); return; }
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)buf.data();
+    sqe->len = (unsigned)buf.size();
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = data;
+    st.sending = true;
+}
+
+void UringBackend::prepare_sends() {
+    for (int fd : dirty) {
+        auto it = fds.find(fd);
+        if (it == fds.end()) continue;
+        FdState& st = it->second;
+        st.queued = false;
+        if (!st.sending && !st.pending.empty()) queue_send(fd, st);
+    }
+    dirty.clear();
+}
+
+void UringBackend::flush() {
+    prepare_sends();
+    if (to_submit > 0) enter(to_submit, 0, -1);
+}
+
+void UringBackend::poll(int timeout_ms) {
+    prepare_sends();
+    // 有完成事件没处理就不睡
+    bool ready = load_acquire(cq_tail) != *cq_head;
+    if (to_submit > 0 || !ready || defer_taskrun) {
+        enter(to_submit, ready ? 0 : 1, timeout_ms);
+    }
+    reap();
+}
+
+void UringBackend::reap() {
+    while (true) {
+        unsigned head = *cq_head;
+        if (head == load_acquire(cq_tail)) break;
+        io_uring_cqe cqe = cqes[head & *cq_mask];
+        store_release(cq_head, head + 1); // 先让出槽位，处理过程中可能又提交新请求
+        handle_cqe(cqe);
+    }
+}
+
+void UringBackend::handle_cqe(const io_uring_cqe& cqe) {
+    int op = (int)(cqe.user_data >> 56);
+    uint32_t gen = (uint32_t)(cqe.user_data >> 32) & 0xFFFFFF;
+    int fd = (int)(uint32_t)cqe.user_data;
+    bool more = (cqe.flags & IORING_CQE_F_MORE) != 0;
+    int bid = (cqe.flags & IORING_CQE_F_BUFFER) ? (int)(cqe.flags >> IORING_CQE_BUFFER_SHIFT) : -1;
+
+    // fd 已移除或被新连接复用：旧请求的结果一律丢弃
+    auto live = [&]() -> FdState* {
+        auto it = fds.find(fd);
+        return (it != fds.end() && it->second.gen == gen) ? &it->second : nullptr;
+    };
+
+    switch (op) {
+        case OP_ACCEPT:
+            if (cqe.res >= 0) {
+                if (live()) handlers.on_accept(fd, cqe.res);
+                else close(cqe.res);
+            }
+            if (!more) { FdState* st = live(); if (st) arm(fd, *st); }
+            break;
+
+        case OP_RECV:
+            if (cqe.res > 0 && bid >= 0) {
+                if (live()) handlers.on_data(fd, buf_base + (size_t)bid * URING_BUF_SIZE, cqe.res);
+                recycle_buffer(bid);
+                if (!more) { FdState* st = live(); if (st) arm(fd, *st); }
+            } else {
+                if (bid >= 0) recycle_buffer(bid);
+                if (cqe.res == -ENOBUFS) {
+                    // 缓冲一时用光：已经还回去了，重新挂上即可
+                    FdState* st = live();
+                    if (st && !more) arm(fd, *st);
+                } else if (!more && live()) {
+                    handlers.on_closed(fd);
+                }
+            }
+            break;
+
+        case OP_POLL:
+            if (cqe.res >= 0 && live()) handlers.on_readable(fd);
+            if (!more) { FdState* st = live(); if (st) arm(fd, *st); }
+            break;
+
+        case OP_SEND: {
+            auto bit = inflight.find(cqe.user_data);
+            FdState* st = live();
+            if (!st || bit == inflight.end()) {
+                if (bit != inflight.end()) inflight.erase(bit);
+                break;
+            }
+            std::string& buf = bit->second;
+            if (cqe.res > 0) st->sent_off += cqe.res;
+            bool retry = (cqe.res == -EAGAIN || cqe.res == -EINTR);
+            if ((cqe.res > 0 || retry) && st->sent_off < buf.size()) {
+                // 只发出一部分：同一个缓冲接着发剩下的
+                io_uring_sqe* sqe = get_sqe();
+                if (sqe) {
+                    sqe->opcode = IORING_OP_SEND;
+                    sqe->fd = fd;
+                    sqe->addr = (uint64_t)(uintptr_t)(buf.data() + st->sent_off);
+                    sqe->len = (unsigned)(buf.size() - st->sent_off);
+                    sqe->msg_flags = MSG_NOSIGNAL;
+                    sqe->user_data = cqe.user_data;
+                    break;
+                }
+            }
+            // 发完或出错 (连接快断了，由接收那边报告关闭)
+            inflight.erase(bit);
+            st->sending = false;
+            if (!st->pending.empty() && !st->queued) {
+                st->queued = true;
+                dirty.push_back(fd);
+            }
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef URING_BACKEND_H
+#define URING_BACKEND_H
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define MOBA_HAVE_URING 1
+#endif
+
+#ifdef MOBA_HAVE_URING
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <linux/io_uring.h>
+#include "io_backend.h"
+
+#define URING_ENTRIES       4096
+#define URING_BUF_COUNT     1024         // 提供给内核的接收缓冲个数 (2 的幂)
+#define URING_BUF_SIZE      4096
+#define URING_BUF_GROUP     1
+#define URING_MAX_PENDING   (4 * 1024 * 1024) // 单个连接积压超过这个值就丢弃新数据，同 socket 写满
+
+// --------------------------------------------------------
+// io_uring 后端 (直接用系统调用，不依赖 liburing)
+// - 监听 socket: 一个多发 accept 请求
+// - 客户端连接: 一个多发 recv 请求，数据落在内核从缓冲环里挑的缓冲上，处理完立刻还回去
+// - 其它 fd: 多发 poll
+// - 发送: 同一连接一轮内的多次 send 拼成一个缓冲，每个连接同时只有一个 SEND 在飞
+// 每轮 poll 只进一次内核：提交所有排队的 SQE 并等待完成事件
+// --------------------------------------------------------
+class UringBackend : public IoBackend {
+public:
+    // 内核不支持 (或被禁用) 时返回 nullptr
+    static UringBackend* create();
+    ~UringBackend();
+    const char* name() const override { return "uring"; }
+
+    void add_listener(int fd) override;
+    void add_stream(int fd) override;
+    void add_watch(int fd) override;
+    void remove(int fd) override;
+
+    void poll(int timeout_ms) override;
+
+    ssize_t send(int fd, const void* buf, size_t len) override;
+    void flush() override;
+    size_t queued_bytes(int fd) const override;
+
+private:
+    enum { FD_LISTENER, FD_STREAM, FD_WATCH };
+    enum { OP_ACCEPT = 1, OP_RECV, OP_POLL, OP_SEND, OP_CANCEL, OP_PROVIDE, OP_PROBE };
+
+    struct FdState {
+        int kind;
+        uint32_t gen;        // fd 被复用后，旧请求的完成事件据此丢弃
+        std::string pending; // 本轮攒下的待发数据
+        size_t sent_off;     // 在飞缓冲已发出的字节数
+        bool sending;
+        bool queued;         // 已在 dirty 列表里
+        FdState() : kind(FD_STREAM), gen(0), sent_off(0), sending(false), queued(false) {}
+    };
+
+    UringBackend();
+    bool init();
+    bool probe_buf_ring();
+
+    int ring_fd;
+    unsigned sq_entries, cq_entries;
+    void* sq_ptr; size_t sq_len;
+    void* cq_ptr; size_t cq_len;
+    io_uring_sqe* sqes; size_t sqes_len;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    io_uring_cqe* cqes;
+    unsigned to_submit;
+    bool defer_taskrun;
+
+    // 接收缓冲环 (不可用时用 IORING_OP_PROVIDE_BUFFERS 逐个还缓冲)
+    bool use_buf_ring;
+    io_uring_buf_ring* buf_ring;
+    size_t buf_ring_len;
+    char* buf_base;
+    unsigned short buf_tail;
+
+    uint32_t next_gen;
+    std::unordered_map<int, FdState> fds;
+    std::vector<int> dirty; // 有待发数据的连接
+    std::unordered_map<uint64_t, std::string> inflight; // 在飞的发送缓冲 (按 user_data)，内核用完才释放
+
+    io_uring_sqe* get_sqe();
+    int enter(unsigned submit, unsigned min_complete, int timeout_ms);
+    void recycle_buffer(unsigned bid);
+    static uint64_t make_data(int op, uint32_t gen, int fd);
+
+    void arm(int fd, FdState& st);
+    void queue_send(int fd, FdState& st);
+    void prepare_sends();
+    void handle_cqe(const io_uring_cqe& cqe);
+    void reap();
+};
+
+#endif
+#endif
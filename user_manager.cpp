@@ -1,116 +1,338 @@
 #include "user_manager.h"
 #include "protocol.h"
-#include <sstream>
+#include <cerrno>
+#include <cstdlib>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
-UserManager::UserManager(const std::string& filename) : db_file(filename) {
+UserManager::UserManager(const std::string& filename) : db_file(filename), online_count(0), journal_fd(-1) {
+    journal_file = db_file + ".journal";
+    online_slots.reset(new std::atomic<const std::string*>[ONLINE_FD_SLOTS]);
+    for (int i = 0; i < ONLINE_FD_SLOTS; i++) online_slots[i].store(nullptr, std::memory_order_relaxed);
     load_db();
 }
 
+UserManager::UserShard& UserManager::shard_of(const std::string& username) {
+    return shards[std::hash<std::string>()(username) % USER_SHARDS];
+}
+
 UserManager::~UserManager() {
+    flush_journal();
     save_db();
+    if (journal_fd >= 0) close(journal_fd);
+}
+
+// 解析 "username password [rating]" 格式的行，追加到 out (旧格式没有匹配分)
+static void parse_user_lines(const char* data, size_t len, std::vector<UserData>& out) {
+    size_t pos = 0;
+    while (pos < len) {
+        size_t end = pos;
+        while (end < len && data[end] != '\n') end++;
+
+        // 按空白切出前三个字段
+        size_t i = pos;
+        std::string fields[3];
+        for (int f = 0; f < 3; f++) {
+            while (i < end && (data[i] == ' ' || data[i] == '\t' || data[i] == '\r')) i++;
+            size_t start = i;
+            while (i < end && data[i] != ' ' && data[i] != '\t' && data[i] != '\r') i++;
+            fields[f].assign(data + start, i - start);
+        }
+        if (!fields[0].empty() && !fields[1].empty()) {
+            UserData d; d.username = fields[0]; d.password = fields[1];
+            d.rating = fields[2].empty() ? DEFAULT_RATING : atoi(fields[2].c_str());
+            out.push_back(d);
+        }
+        pos = end + 1;
+    }
+}
+
+// mmap 整个文件并解析，文件不存在返回 false
+static bool load_user_file(const std::string& path, std::vector<UserData>& out) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            madvise(data, st.st_size, MADV_SEQUENTIAL);
+            parse_user_lines((const char*)data, st.st_size, out);
+            munmap(data, st.st_size);
+        }
+    }
+    close(fd);
+    return true;
+}
+
+static void append_user_line(std::string& buf, const UserData& d) {
+    buf += d.username;
+    buf += ' ';
+    buf += d.password;
+    buf += ' ';
+    buf += std::to_string(d.rating);
+    buf += '\n';
+}
+
+static bool write_all(int fd, const std::string& buf) {
+    size_t off = 0;
+    while (off < buf.size()) {
+        ssize_t n = write(fd, buf.data() + off, buf.size() - off);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        off += n;
+    }
+    return true;
 }
 
 void UserManager::load_db() {
-    std::lock_guard<std::mutex> lock(mtx); // [新增] 加锁
-    std::ifstream in(db_file);
-    if (!in.is_open()) {
+    std::lock_guard<std::mutex> lock(mtx); // [新增] 加锁 (构造期间，分片无需加锁)
+
+    // 1. 快照
+    std::shared_ptr<std::vector<UserData>> base = std::make_shared<std::vector<UserData>>();
+    if (!load_user_file(db_file, *base)) {
         std::cout << "[UserManager] No user db found, creating new one." << std::endl;
-        return;
     }
-    
-    std::string line, u, p;
-    while (std::getline(in, line)) {
-        if (line.empty()) continue;
-        std::stringstream ss(line);
-        ss >> u >> p;
-        if (!u.empty() && !p.empty()) {
-            UserData d; d.username = u; d.password = p;
-            all_users[u] = d;
-        }
+    size_t total = 0;
+    for (const auto& d : *base) {
+        if (shard_of(d.username).users.emplace(d.username, d).second) total++;
+    }
+    snapshot_base = base;
+
+    // 2. 重放日志 (上次压缩之后的注册与改分，后出现的覆盖前面的)
+    std::vector<UserData> journal;
+    load_user_file(journal_file, journal);
+    for (const auto& d : journal) {
+        auto res = shard_of(d.username).users.emplace(d.username, d);
+        if (res.second) total++;
+        else res.first->second = d;
+        new_users.push_back(d);
+    }
+    std::cout << "[UserManager] Loaded " << total << " users ("
+              << new_users.size() << " journal records)." << std::endl;
+
+    journal_fd = open(journal_file.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (journal_fd < 0) perror("[UserManager] open journal failed");
+}
+
+void UserManager::flush_journal() {
+    std::lock_guard<std::mutex> io_lock(journal_mtx);
+
+    std::string batch;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        batch.swap(pending_journal);
+    }
+    if (batch.empty() || journal_fd < 0) return;
+
+    // 一批注册只做一次 write + fdatasync，且不持有 mtx
+    if (!write_all(journal_fd, batch) || fdatasync(journal_fd) != 0) {
+        perror("[UserManager] journal flush failed");
     }
-    std::cout << "[UserManager] Loaded " << all_users.size() << " users." << std::endl;
-    in.close();
 }
 
 void UserManager::save_db() {
-    std::lock_guard<std::mutex> lock(mtx); // [新增] 加锁
-    std::ofstream out(db_file);
-    for (auto& pair : all_users) {
-        out << pair.second.username << " " << pair.second.password << "\n";
+    std::lock_guard<std::mutex> io_lock(journal_mtx);
+
+    // 1. 锁内只取快照指针，并把增量整体换出 (O(1))，之后的注册进入新的 new_users
+    std::shared_ptr<const std::vector<UserData>> base;
+    std::vector<UserData> delta;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (new_users.empty()) return; // 自上次快照以来没有变化
+        base = snapshot_base;
+        delta.swap(new_users);
+    }
+
+    // 2. 锁外生成新快照：写临时文件 -> fsync -> rename
+    std::shared_ptr<std::vector<UserData>> merged = std::make_shared<std::vector<UserData>>();
+    merged->reserve(base->size() + delta.size());
+    merged->insert(merged->end(), base->begin(), base->end());
+    std::unordered_map<std::string, size_t> index;
+    index.reserve(merged->size());
+    for (size_t i = 0; i < merged->size(); i++) index[(*merged)[i].username] = i;
+    for (const auto& d : delta) {
+        auto it = index.find(d.username);
+        if (it != index.end()) { (*merged)[it->second] = d; continue; } // 改分覆盖旧记录
+        index[d.username] = merged->size();
+        merged->push_back(d);
+    }
+
+    std::string buf;
+    buf.reserve(merged->size() * 24);
+    for (const auto& d : *merged) append_user_line(buf, d);
+
+    std::string tmp_file = db_file + ".tmp";
+    int fd = open(tmp_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    bool ok = (fd >= 0) && write_all(fd, buf) && fsync(fd) == 0;
+    if (fd >= 0) close(fd);
+    if (!ok || rename(tmp_file.c_str(), db_file.c_str()) != 0) {
+        perror("[UserManager] write snapshot failed");
+        unlink(tmp_file.c_str());
+        // 失败：把增量放回去，下次再试 (日志里仍有这些记录)
+        std::lock_guard<std::mutex> lock(mtx);
+        delta.insert(delta.end(), new_users.begin(), new_users.end());
+        new_users.swap(delta);
+        return;
+    }
+
+    // 3. 新快照生效；压缩期间新注册的 (new_users) 留在日志里
+    std::string rest;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        snapshot_base = merged;
+        for (const auto& d : new_users) append_user_line(rest, d);
+        pending_journal.clear(); // 已包含在 rest 中
+    }
+
+    // 4. 截断日志，只保留快照之后的记录 (崩溃时重放重复记录也无妨)
+    if (journal_fd >= 0) {
+        if (ftruncate(journal_fd, 0) != 0 || !write_all(journal_fd, rest) || fdatasync(journal_fd) != 0) {
+            perror("[UserManager] journal truncate failed");
+        }
     }
-    out.close();
     // std::cout << "[Persist] Data saved to disk." << std::endl; 
 }
 
 int UserManager::register_user(const std::string& username, const std::string& password) {
-    std::lock_guard<std::mutex> lock(mtx); // [新增] 加锁
-    if (all_users.count(username)) {
+    UserShard& shard = shard_of(username);
+    std::lock_guard<std::mutex> shard_lock(shard.mtx);
+    if (shard.users.count(username)) {
         return RET_FAIL_DUP; // 用户名已存在
     }
     
     UserData d; 
     d.username = username; 
     d.password = password;
-    all_users[username] = d;
-    
-    // save_db(); // [修改] 去掉立即保存，交由后台线程处理
+    d.rating = DEFAULT_RATING;
+    shard.users.emplace(username, d);
+
+    // [修改] 只追加日志记录，由后台线程批量刷盘
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        new_users.push_back(d);
+        append_user_line(pending_journal, d);
+    }
     std::cout << "[UserManager] New user registered: " << username << std::endl;
     return RET_SUCCESS;
 }
 
+int UserManager::get_rating(const std::string& username) {
+    UserShard& shard = shard_of(username);
+    std::lock_guard<std::mutex> shard_lock(shard.mtx);
+    auto it = shard.users.find(username);
+    return (it != shard.users.end()) ? it->second.rating : DEFAULT_RATING;
+}
+
+void UserManager::set_rating(const std::string& username, int rating) {
+    UserShard& shard = shard_of(username);
+    std::lock_guard<std::mutex> shard_lock(shard.mtx);
+    auto it = shard.users.find(username);
+    if (it == shard.users.end()) return;
+    it->second.rating = rating;
+
+    std::lock_guard<std::mutex> lock(mtx);
+    new_users.push_back(it->second);
+    append_user_line(pending_journal, it->second);
+}
+
 int UserManager::login_user(int fd, const std::string& username, const std::string& password) {
-    std::lock_guard<std::mutex> lock(mtx); // [新增] 加锁
-    
-    if (all_users.count(username) == 0) {
+    int ret = check_password(username, password);
+    if (ret != RET_SUCCESS) return ret;
+    return mark_online(fd, username);
+}
+
+int UserManager::check_password(const std::string& username, const std::string& password) {
+    // 只锁该用户名所在的分片
+    UserShard& shard = shard_of(username);
+    std::lock_guard<std::mutex> shard_lock(shard.mtx);
+    auto it = shard.users.find(username);
+    if (it == shard.users.end()) {
         return RET_FAIL_NONAME;
     }
-    
-    if (all_users[username].password != password) {
+    if (it->second.password != password) {
         return RET_FAIL_PWD;
     }
+    return RET_SUCCESS;
+}
 
-    // [修改] 必须在锁内直接检查，不能调用 public 的 is_online()，否则会死锁
-    bool already_online = false;
-    for(auto& pair : online_users) {
-        if(pair.second == username) {
-            already_online = true;
-            break;
-        }
+int UserManager::mark_online(int fd, const std::string& username) {
+    // 1. 取账号里的用户名 (节点地址稳定，账号不会被删除)
+    const std::string* name_ref = nullptr;
+    {
+        UserShard& shard = shard_of(username);
+        std::lock_guard<std::mutex> shard_lock(shard.mtx);
+        auto it = shard.users.find(username);
+        if (it == shard.users.end()) return RET_FAIL_NONAME;
+        name_ref = &it->second.username;
     }
 
-    if (already_online) {
-        return RET_FAIL_DUP;
+    // 2. 在线索引：O(1) 检查重复登录
+    {
+        std::lock_guard<std::mutex> lock(online_mtx);
+        if (online_by_name.count(username)) {
+            return RET_FAIL_DUP;
+        }
+        // 同一连接换个账号再登录：先摘掉旧账号的在线记录，否则旧账号一直算在线
+        const std::string* prev = nullptr;
+        if (fd >= 0 && fd < ONLINE_FD_SLOTS) {
+            prev = online_slots[fd].load(std::memory_order_relaxed);
+        } else {
+            auto it = online_overflow.find(fd);
+            if (it != online_overflow.end()) prev = it->second;
+        }
+        if (prev) {
+            online_by_name.erase(*prev);
+            online_count--;
+        }
+
+        online_by_name[username] = fd;
+        if (fd >= 0 && fd < ONLINE_FD_SLOTS) online_slots[fd].store(name_ref, std::memory_order_release);
+        else online_overflow[fd] = name_ref;
+        online_count++;
     }
 
-    // 登录成功，记录在线状态
-    online_users[fd] = username;
     std::cout << "[UserManager] User login: " << username << " (fd: " << fd << ")" << std::endl;
     return RET_SUCCESS;
 }
 
 void UserManager::logout_user(int fd) {
-    std::lock_guard<std::mutex> lock(mtx); // [新增] 加锁
-    if (online_users.count(fd)) {
-        std::cout << "[UserManager] User logout: " << online_users[fd] << std::endl;
-        online_users.erase(fd);
+    const std::string* name_ref = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(online_mtx);
+        if (fd >= 0 && fd < ONLINE_FD_SLOTS) {
+            name_ref = online_slots[fd].exchange(nullptr, std::memory_order_acq_rel);
+        } else {
+            auto it = online_overflow.find(fd);
+            if (it != online_overflow.end()) { name_ref = it->second; online_overflow.erase(it); }
+        }
+        if (!name_ref) return;
+        online_by_name.erase(*name_ref);
+        online_count--;
     }
+    std::cout << "[UserManager] User logout: " << *name_ref << std::endl;
 }
 
 bool UserManager::is_online(const std::string& username) {
-    std::lock_guard<std::mutex> lock(mtx); // [新增] 加锁
-    for(auto& pair : online_users) {
-        if(pair.second == username) return true;
-    }
-    return false;
+    std::lock_guard<std::mutex> lock(online_mtx);
+    return online_by_name.count(username) > 0;
 }
 
 std::string UserManager::get_username(int fd) {
-    std::lock_guard<std::mutex> lock(mtx); // [新增] 加锁
-    if (online_users.count(fd)) return online_users[fd];
-    return "";
+    if (fd >= 0 && fd < ONLINE_FD_SLOTS) {
+        const std::string* name_ref = online_slots[fd].load(std::memory_order_acquire);
+        return name_ref ? *name_ref : "";
+    }
+    std::lock_guard<std::mutex> lock(online_mtx);
+    auto it = online_overflow.find(fd);
+    return (it != online_overflow.end()) ? *it->second : "";
 }
 
 int UserManager::get_online_count() {
-    std::lock_guard<std::mutex> lock(mtx); // [新增] 加锁
-    return online_users.size();
-}
\ No newline at end of file
+    return online_count.load(std::memory_order_relaxed);
+}
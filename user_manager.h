@@ -7,25 +7,63 @@
 #include <iostream>
 #include <vector>
 #include <mutex> // [新增] 引入互斥锁
+#include <memory>
+#include <atomic>
+#include <unordered_map>
+
+// [新增] 账号索引分片数 (按用户名哈希)，登录风暴时各分片互不争用
+#define USER_SHARDS        16
+// [新增] fd -> 用户名 的无锁槽位数，超出的 fd 走加锁的后备表
+#define ONLINE_FD_SLOTS    65536
+
+#define DEFAULT_RATING     1000  // [新增] 新账号的初始匹配分
 
 // 简单的用户结构
 struct UserData {
     std::string username;
     std::string password;
+    int rating;   // [新增] 匹配分 (Elo)，对局结束后更新
     // 可以在这里扩展战绩：int wins; int loses;
 };
 
+// --------------------------------------------------------
+// 持久化：快照 (users.txt) + 只追加的日志 (users.txt.journal)，每行 "用户名 密码 匹配分"
+// 注册/改分只在内存里追加一行日志，后台线程批量 write + fdatasync；
+// 定期压缩时在锁外把"上次快照 + 新注册"写成新快照 (tmp + rename)，再截断日志。
+// 启动时 mmap 读入快照，再重放日志尾部 (同一用户后出现的记录覆盖前面的)。
+// --------------------------------------------------------
 class UserManager {
 private:
     std::string db_file;
-    // 数据库: username -> UserData
-    std::map<std::string, UserData> all_users;
-    
-    // 在线列表: fd -> username
-    std::map<int, std::string> online_users;
+    std::string journal_file;
+
+    // [修改] 数据库: 按用户名哈希分片，每片独立加锁
+    // 账号只增不删，unordered_map 的节点地址稳定，可以长期持有 UserData 指针
+    struct UserShard {
+        std::mutex mtx;
+        std::unordered_map<std::string, UserData> users;
+    };
+    UserShard shards[USER_SHARDS];
+    UserShard& shard_of(const std::string& username);
+
+    // [修改] 在线索引
+    // online_by_name: username -> fd，O(1) 判断重复登录 (由 online_mtx 保护)
+    // online_slots:   fd -> 账号里的用户名指针，get_username 无锁读取
+    std::mutex online_mtx;
+    std::unordered_map<std::string, int> online_by_name;
+    std::unique_ptr<std::atomic<const std::string*>[]> online_slots;
+    std::map<int, const std::string*> online_overflow; // fd >= ONLINE_FD_SLOTS 时使用 (由 online_mtx 保护)
+    std::atomic<int> online_count;
 
-    // [新增] 互斥锁，保护 all_users 和 online_users 的并发访问
+    // [修改] 互斥锁，只保护下面的持久化状态；加锁顺序：分片锁 -> mtx
     std::mutex mtx;
+    std::shared_ptr<const std::vector<UserData>> snapshot_base; // 上次快照的内容，只读，压缩时在锁外使用
+    std::vector<UserData> new_users;     // 上次快照之后新注册或改过分的记录
+    std::string pending_journal;         // 尚未写入日志文件的记录
+
+    // 日志文件 I/O 串行化 (刷盘与压缩互斥)，不与 mtx 同时长时间持有
+    std::mutex journal_mtx;
+    int journal_fd;
 
     void load_db();
 
@@ -33,7 +71,10 @@ public:
     UserManager(const std::string& filename = "users.txt");
     ~UserManager();
 
-    // [修改] 移到 public，供后台线程调用
+    // [新增] 把积攒的注册记录批量追加到日志并 fdatasync (后台线程每秒调用)
+    void flush_journal();
+
+    // [修改] 压缩：写出新快照并截断日志 (后台线程定期调用，不阻塞登录)
     void save_db();
 
     // 注册: 返回 RET_SUCCESS 或 RET_FAIL_DUP
@@ -42,13 +83,23 @@ public:
     // 登录: 返回 RET_SUCCESS, RET_FAIL_PWD, RET_FAIL_NONAME
     int login_user(int fd, const std::string& username, const std::string& password);
 
+    // [新增] 登录拆成两步，校验可在工作线程做，标记在线在主循环做
+    // 校验账号密码: 返回 RET_SUCCESS, RET_FAIL_PWD, RET_FAIL_NONAME
+    int check_password(const std::string& username, const std::string& password);
+    // 标记在线: 返回 RET_SUCCESS, RET_FAIL_DUP (已在别处登录), RET_FAIL_NONAME
+    int mark_online(int fd, const std::string& username);
+
     // 处理断线
     void logout_user(int fd);
 
     // 检查是否在线
     bool is_online(const std::string& username);
 
-    // 通过FD获取用户名
+    // [新增] 匹配分读写 (改分会写入日志)
+    int get_rating(const std::string& username);
+    void set_rating(const std::string& username, int rating);
+
+    // 通过FD获取用户名 (无锁，可在任意线程调用)
     std::string get_username(int fd);
     
     // 获取当前在线人数